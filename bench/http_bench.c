@@ -0,0 +1,243 @@
+#define _GNU_SOURCE // strcasestr
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define BENCH_BUFFER_SIZE (64 * 1024)
+#define BENCH_BUCKET_US 10
+#define BENCH_BUCKETS 10000 // 100ms, slower responses land in the last bucket
+
+typedef struct {
+    const char* host;
+    const char* port;
+    const char* path;
+    int duration;
+    size_t connections;
+} BenchConfig;
+
+typedef struct {
+    pthread_t thread;
+    const BenchConfig* config;
+    size_t requests;
+    size_t errors;
+    unsigned long long bytes;
+    unsigned long long latency_sum;        // microseconds
+    unsigned long long buckets[BENCH_BUCKETS];
+} BenchThread;
+
+static unsigned long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static int connect_server(const BenchConfig* config) {
+    struct addrinfo hints;
+    struct addrinfo* res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(config->host, config->port, &hints, &res) != 0) {
+        return -1;
+    }
+
+    int socket_fd = -1;
+    for (struct addrinfo* ptr = res; ptr != NULL; ptr = ptr->ai_next) {
+        socket_fd = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
+        if (socket_fd == -1) continue;
+        if (connect(socket_fd, ptr->ai_addr, ptr->ai_addrlen) == 0) break;
+        close(socket_fd);
+        socket_fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (socket_fd != -1) {
+        int yes = 1;
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+    return socket_fd;
+}
+
+/*
+ * Function: read_response
+ *
+ * -----------------------
+ *
+ *  Reads one response, using Content-Length to find its end.
+ *
+ *  socket_fd: connected socket.
+ *  buffer: scratch buffer of BENCH_BUFFER_SIZE bytes.
+ *  closing: set when the server announced it closes the connection.
+ *
+ *  returns: response size. if failed or closed (-1).
+ */
+static ssize_t read_response(int socket_fd, char* buffer, int* closing) {
+    size_t size = 0;
+    size_t header_size = 0;
+    size_t content_length = 0;
+
+    while (1) {
+        if (header_size == 0) {
+            ssize_t received = recv(socket_fd, buffer + size, BENCH_BUFFER_SIZE - size - 1, 0);
+            if (received <= 0) return -1;
+            size += received;
+            buffer[size] = '\0';
+
+            char* header_end = strstr(buffer, "\r\n\r\n");
+            if (header_end == NULL) {
+                if (size == BENCH_BUFFER_SIZE - 1) return -1;
+                continue;
+            }
+            header_size = header_end - buffer + 4;
+            char* field = strcasestr(buffer, "\r\nContent-Length:");
+            if (field != NULL && field < header_end) {
+                content_length = strtoull(field + 17, NULL, 10);
+            }
+            field = strcasestr(buffer, "\r\nConnection: close");
+            *closing = field != NULL && field < header_end;
+        } else {
+            // body bytes are counted, not kept
+            size_t chunk = BENCH_BUFFER_SIZE;
+            if (header_size + content_length - size < chunk) chunk = header_size + content_length - size;
+            ssize_t received = recv(socket_fd, buffer, chunk, 0);
+            if (received <= 0) return -1;
+            size += received;
+        }
+
+        if (header_size > 0 && size >= header_size + content_length) {
+            return size;
+        }
+    }
+}
+
+static void* run_bench_thread(void* arg) {
+    BenchThread* bench = (BenchThread*) arg;
+    const BenchConfig* config = bench->config;
+
+    char request[1024];
+    int request_size = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n",
+                                config->path, config->host);
+    char* buffer = malloc(BENCH_BUFFER_SIZE);
+    if (buffer == NULL) return NULL;
+
+    unsigned long long deadline = now_us() + (unsigned long long) config->duration * 1000000ULL;
+    int socket_fd = -1;
+    while (now_us() < deadline) {
+        if (socket_fd == -1 && (socket_fd = connect_server(config)) == -1) {
+            bench->errors++;
+            usleep(1000);
+            continue;
+        }
+
+        unsigned long long start = now_us();
+        ssize_t received = -1;
+        int closing = 0;
+        if (send(socket_fd, request, request_size, MSG_NOSIGNAL) == request_size) {
+            received = read_response(socket_fd, buffer, &closing);
+        }
+        if (received == -1 || closing) {
+            // the last response of a keep-alive connection is still counted
+            if (received == -1) bench->errors++;
+            close(socket_fd);
+            socket_fd = -1;
+            if (received == -1) continue;
+        }
+
+        unsigned long long latency = now_us() - start;
+        size_t bucket = latency / BENCH_BUCKET_US;
+        bench->buckets[bucket < BENCH_BUCKETS ? bucket : BENCH_BUCKETS - 1]++;
+        bench->latency_sum += latency;
+        bench->bytes += received;
+        bench->requests++;
+    }
+
+    if (socket_fd != -1) close(socket_fd);
+    free(buffer);
+    return NULL;
+}
+
+static void print_bench_usage(const char* program) {
+    printf("USAGE: %s [options] host port\n", program);
+    printf("\t-c N\tconcurrent keep-alive connections (default: 16)\n");
+    printf("\t-d S\tduration in seconds (default: 5)\n");
+    printf("\t-p PATH\trequested path (default: /)\n");
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config = {NULL, NULL, "/", 5, 16};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            config.connections = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            config.duration = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            config.path = argv[++i];
+        } else if (config.host == NULL) {
+            config.host = argv[i];
+        } else if (config.port == NULL) {
+            config.port = argv[i];
+        } else {
+            print_bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.host == NULL || config.port == NULL || config.connections == 0 || config.duration <= 0) {
+        print_bench_usage(argv[0]);
+        return 1;
+    }
+
+    BenchThread* threads = calloc(config.connections, sizeof(BenchThread));
+    if (threads == NULL) {
+        return 1;
+    }
+
+    size_t started = 0;
+    for (; started < config.connections; started++) {
+        threads[started].config = &config;
+        if (pthread_create(&threads[started].thread, NULL, run_bench_thread, &threads[started]) != 0) break;
+    }
+
+    BenchThread total;
+    memset(&total, 0, sizeof(total));
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i].thread, NULL);
+        total.requests += threads[i].requests;
+        total.errors += threads[i].errors;
+        total.bytes += threads[i].bytes;
+        total.latency_sum += threads[i].latency_sum;
+        for (size_t j = 0; j < BENCH_BUCKETS; j++) total.buckets[j] += threads[i].buckets[j];
+    }
+
+    unsigned long long percentiles[3] = {0};
+    const double ranks[3] = {0.5, 0.99, 0.999};
+    for (int p = 0; p < 3; p++) {
+        unsigned long long seen = 0;
+        unsigned long long target = (unsigned long long) (total.requests * ranks[p]);
+        for (size_t j = 0; j < BENCH_BUCKETS; j++) {
+            seen += total.buckets[j];
+            if (seen > target) {
+                percentiles[p] = (j + 1) * BENCH_BUCKET_US;
+                break;
+            }
+        }
+    }
+
+    printf("%zu connections, %d s, GET %s\n", started, config.duration, config.path);
+    printf("requests: %zu (%.0f req/s), errors: %zu, %.1f MB/s\n", total.requests,
+           (double) total.requests / config.duration, total.errors,
+           (double) total.bytes / config.duration / (1024 * 1024));
+    printf("latency: mean %.0f us, p50 %llu us, p99 %llu us, p99.9 %llu us\n",
+           total.requests > 0 ? (double) total.latency_sum / total.requests : 0.0,
+           percentiles[0], percentiles[1], percentiles[2]);
+
+    free(threads);
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "../include/connection.h"
+#include "../include/request.h"
+#include "../include/router.h"
+#include "../include/file_manager.h"
+#include "../include/slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REQUEST_BENCH_ROUNDS 20000
+
+// Every heap allocation of the process passes through here, also those
+// made inside libc, so the counts include stdio and strdup.
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static size_t allocations;
+
+void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef struct {
+    const char* name;
+    const char* raw;
+} BenchRequest;
+
+static const BenchRequest REQUESTS[] = {
+    {"static file", "GET /style.css HTTP/1.1\r\nHost: localhost\r\nAccept: text/css,*/*;q=0.1\r\n"
+                    "Accept-Encoding: gzip, deflate, br\r\nConnection: keep-alive\r\n\r\n"},
+    {"directory index", "GET /posts/ HTTP/1.1\r\nHost: localhost\r\nAccept: text/html\r\n\r\n"},
+    {"route handler", "GET / HTTP/1.1\r\nHost: localhost\r\nAccept: text/html\r\n\r\n"},
+    {"not found", "GET /missing.png HTTP/1.1\r\nHost: localhost\r\n\r\n"},
+};
+
+// parse, route and serialize into an output queue, the response is dropped instead of sent
+static void bench_request(const BenchRequest* request, List* routes, HashTable* file_table) {
+    size_t size = strlen(request->raw);
+    char* copy = __libc_malloc(size + 1);
+    SlabPool segments;
+    BufferPool buffers;
+    init_slab_pool(&segments, sizeof(OutputSegment), NULL);
+    init_buffer_pool(&buffers, OUTPUT_BUFFER_SIZE, NULL);
+    OutputQueue output;
+    init_output_queue(&output, &segments, &buffers);
+    // the request's arena starts in a block like the connection's
+    static char arena_block[REQUEST_ARENA_SIZE];
+    Arena arena;
+    init_arena(&arena, arena_block, sizeof(arena_block));
+    HTTPRequest req;
+    memset(&req, 0, sizeof(req));
+    req.arena = &arena;
+    // refreshed per round like the worker does per loop pass
+    DateCache date = {0};
+
+    size_t response_bytes = 0;
+    size_t counted = 0;
+    double start = 0;
+    // the first round fills the pools and is not counted
+    for (int round = 0; round <= REQUEST_BENCH_ROUNDS; round++) {
+        if (round == 1) {
+            counted = allocations;
+            start = now_ns();
+        }
+        update_date_cache(&date, time(NULL));
+        memcpy(copy, request->raw, size + 1);
+        HTTPParser parser;
+        init_http_parser(&parser);
+        if (parse_header(&parser, &req, copy, size) != 1) {
+            fprintf(stderr, "%s did not parse\n", request->name);
+            exit(1);
+        }
+
+        ResponseWriter writer = {&output, 1, 5, 100, 16 * 1024, 1, NULL, NULL, &date, 0};
+        router(routes, &req, &writer, file_table);
+        response_bytes = output_queue_pending(&output);
+        free_output_queue(&output);
+        free_http_req(&req);
+    }
+    double elapsed = now_ns() - start;
+    counted = allocations - counted;
+
+    printf("%-16s %8.0f ns %12.2f %14zu\n", request->name, elapsed / REQUEST_BENCH_ROUNDS,
+           (double) counted / REQUEST_BENCH_ROUNDS, response_bytes);
+    free_arena(&arena);
+    free_slab_pool(&segments);
+    free_buffer_pool(&buffers);
+    free(copy);
+}
+
+int main(void) {
+    List routes = {0, NULL, NULL};
+    Route route_arr[] = {
+        {"/", "GET", home_route_handler, 0},
+        {"/posts", "GET", posts_route_handler, 0},
+    };
+    size_t route_count = sizeof(route_arr) / sizeof(route_arr[0]);
+    FileTable file_table;
+    if (setup_routes(&routes, route_arr, route_count) < (int) route_count ||
+        init_hash_table(&file_table, FILE_TABLE_SIZE) == -1) {
+        return 1;
+    }
+    // run from the repository root, like the server
+    if (load_files(DEFAULT_SERVER_PATH, &file_table) == -1) {
+        fprintf(stderr, "unable to load %s\n", DEFAULT_SERVER_PATH);
+        return 1;
+    }
+
+    printf("%-16s %11s %12s %14s\n", "request", "time", "allocations", "response bytes");
+    for (size_t i = 0; i < sizeof(REQUESTS) / sizeof(REQUESTS[0]); i++) {
+        bench_request(&REQUESTS[i], &routes, &file_table);
+    }
+    printf("(%d rounds each, heap allocations per request)\n", REQUEST_BENCH_ROUNDS);
+
+    free_file_table(&file_table);
+    free_list(&routes);
+    return 0;
+}
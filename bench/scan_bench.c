@@ -0,0 +1,106 @@
+#include "../include/request.h"
+#include "../include/scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SCAN_BENCH_BLOCK (64 * 1024)
+#define SCAN_BENCH_ROUNDS 20000
+
+// What a browser sends with a few cookies, the common case for the parser.
+static const char BROWSER_REQUEST[] =
+    "GET /posts/post-1.html?utm_source=newsletter&utm_medium=email HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/posts/index.html\r\n"
+    "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark; consent=analytics%3Dfalse%26ads%3Dfalse; "
+    "_ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1700000000; prefs=eyJsYW5nIjoiZW4iLCJ0eiI6IlVUQyJ9\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// a field value with its CR at the very end, the scanner's best case
+static double bench_field_scan(const char* block) {
+    size_t found = 0;
+    double start = now_ns();
+    for (int round = 0; round < SCAN_BENCH_ROUNDS / 10; round++) {
+        found += scan_field_end(block, SCAN_BENCH_BLOCK);
+    }
+    double elapsed = now_ns() - start;
+    if (found != (size_t) (SCAN_BENCH_ROUNDS / 10) * (SCAN_BENCH_BLOCK - 1)) {
+        fprintf(stderr, "scan_field_end found the wrong offset\n");
+        exit(1);
+    }
+    return (double) SCAN_BENCH_BLOCK * (SCAN_BENCH_ROUNDS / 10) / elapsed;
+}
+
+// the parser terminates tokens in place, so each round parses a fresh copy
+static double bench_parse(char* copy, size_t size, int fed_bytes) {
+    double start = now_ns();
+    for (int round = 0; round < SCAN_BENCH_ROUNDS; round++) {
+        memcpy(copy, BROWSER_REQUEST, size);
+        HTTPParser parser;
+        HTTPRequest req;
+        memset(&req, 0, sizeof(req));
+        init_http_parser(&parser);
+
+        int result = 0;
+        if (fed_bytes > 0) {
+            // resumed after every few bytes, like a request trickling in
+            for (size_t received = fed_bytes; result == 0; received += fed_bytes) {
+                result = parse_header(&parser, &req, copy, received < size ? received : size);
+            }
+        } else {
+            result = parse_header(&parser, &req, copy, size);
+        }
+        if (result != 1 || req.http_header.field_count != 12) {
+            fprintf(stderr, "request did not parse\n");
+            exit(1);
+        }
+    }
+    return (now_ns() - start) / SCAN_BENCH_ROUNDS;
+}
+
+int main(void) {
+    char* block = malloc(SCAN_BENCH_BLOCK);
+    size_t size = sizeof(BROWSER_REQUEST) - 1;
+    char* copy = malloc(size + 1);
+    if (block == NULL || copy == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(block, 'a', SCAN_BENCH_BLOCK);
+    block[SCAN_BENCH_BLOCK - 1] = '\r';
+
+    printf("%-8s %14s %16s %22s\n", "scanner", "value scan", "parse request", "parse, 64 byte reads");
+    ScanLevel levels[] = {SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2};
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (set_scan_level(levels[i]) == -1) {
+            printf("%-8s %14s\n", scan_level_name(levels[i]), "unsupported");
+            continue;
+        }
+        double scan_rate = bench_field_scan(block);
+        double parse_ns = bench_parse(copy, size, 0);
+        double trickle_ns = bench_parse(copy, size, 64);
+        printf("%-8s %9.2f GB/s %13.0f ns %19.0f ns\n", scan_level_name(levels[i]), scan_rate, parse_ns, trickle_ns);
+    }
+    printf("(%zu byte request, %d rounds)\n", size, SCAN_BENCH_ROUNDS);
+
+    free(copy);
+    free(block);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+
+#define ARENA_BLOCK_SIZE 4096 // heap blocks taken once the owner's block is full
+
+typedef struct arena_block {
+    struct arena_block* next;
+} ArenaBlock;
+
+// Bump allocator for memory that lives as long as one request. Nothing is
+// freed on its own, a reset releases everything at once. The first block
+// belongs to the owner and is reused after every reset.
+typedef struct {
+    char* data;          // block being carved
+    size_t size;
+    size_t used;
+    char* initial;       // owner's block
+    size_t initial_size;
+    ArenaBlock* blocks;  // heap blocks, released by the next reset
+    size_t allocations;  // since the last reset
+    size_t heap_blocks;  // since the last reset
+} Arena;
+
+/*
+ * Function: init_arena
+ *
+ * --------------------
+ *
+ *  Initializes an empty arena carving the given block first.
+ *
+ *  arena: pointer to the arena.
+ *  initial: block owned by the caller, may be NULL.
+ *  initial_size: size of the block.
+ */
+void init_arena(Arena* arena, char* initial, size_t initial_size);
+
+/*
+ * Function: arena_alloc
+ *
+ * ---------------------
+ *
+ *  Allocates aligned memory valid until the next reset.
+ *
+ *  arena: pointer to the arena.
+ *  size: number of bytes.
+ *
+ *  returns: pointer to the memory. if failed, NULL.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/*
+ * Function: arena_strdup
+ *
+ * ----------------------
+ *
+ *  Copies a string into the arena.
+ *
+ *  arena: pointer to the arena.
+ *  str: string to copy.
+ *
+ *  returns: pointer to the copy. if failed, NULL.
+ */
+char* arena_strdup(Arena* arena, const char* str);
+
+/*
+ * Function: reset_arena
+ *
+ * ---------------------
+ *
+ *  Releases every allocation at once, keeping the owner's block.
+ *
+ *  arena: pointer to the arena.
+ */
+void reset_arena(Arena* arena);
+
+/*
+ * Function: free_arena
+ *
+ * --------------------
+ *
+ *  Frees the heap blocks, the owner's block is left to its owner.
+ *
+ *  arena: pointer to the arena.
+ */
+void free_arena(Arena* arena);
+#endif
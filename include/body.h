@@ -0,0 +1,89 @@
+#ifndef BODY_H
+#define BODY_H
+
+#include "arena.h"
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#define BODY_MEMORY_MIN 1024 // first in-memory buffer of a body of unknown length
+
+// Request body as it is received. Small bodies stay in the request's arena,
+// larger ones are written to an unlinked temp file so that memory use does
+// not depend on the upload size. The handler runs once the whole body has
+// arrived and pulls it in chunks.
+typedef struct {
+    size_t size;          // bytes received so far
+    char* data;           // in-memory body, from the arena
+    size_t capacity;
+    size_t memory_limit;  // bodies growing past this go to the spill file
+    int spilled;          // fd holds the body
+    int fd;               // unlinked temp file, valid once spilled
+    size_t read_offset;   // next byte handed out by request_body_read
+    Arena* arena;
+    const char* temp_dir; // where spill files are created
+} RequestBody;
+
+/*
+ * Function: init_request_body
+ *
+ * ---------------------------
+ *
+ *  Prepares an empty body. A declared length over the memory limit spills
+ *  right away, one within it is allocated at once.
+ *
+ *  body: pointer to the body.
+ *  arena: request arena for the in-memory part.
+ *  expected_size: declared length, 0 if unknown.
+ *  memory_limit: bytes kept in memory at most.
+ *  temp_dir: directory for the spill file.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int init_request_body(RequestBody* body, Arena* arena, size_t expected_size, size_t memory_limit,
+                      const char* temp_dir);
+
+/*
+ * Function: request_body_append
+ *
+ * -----------------------------
+ *
+ *  Stores received body bytes, moving the body to the spill file once it
+ *  outgrows the memory limit.
+ *
+ *  body: pointer to the body.
+ *  data: received bytes.
+ *  size: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int request_body_append(RequestBody* body, const char* data, size_t size);
+
+/*
+ * Function: request_body_read
+ *
+ * ---------------------------
+ *
+ *  Copies the next chunk of the body, continuing where the previous call
+ *  stopped.
+ *
+ *  body: pointer to the body.
+ *  buffer: destination.
+ *  size: space in the destination.
+ *
+ *  returns: bytes copied, 0 at the end of the body. if failed (-1).
+ */
+ssize_t request_body_read(RequestBody* body, char* buffer, size_t size);
+
+/*
+ * Function: free_request_body
+ *
+ * ---------------------------
+ *
+ *  Closes the spill file and forgets the body, its memory goes with the
+ *  arena.
+ *
+ *  body: pointer to the body.
+ */
+void free_request_body(RequestBody* body);
+#endif
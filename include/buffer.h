@@ -37,6 +37,20 @@ int init_string_buffer(StringBuffer* buffer, size_t initial_size);
 */
 ssize_t write_to_string_buffer(StringBuffer* buffer, const char* data, size_t data_size);
 
+/*
+* Function: reserve_string_buffer
+*
+* -------------------------------
+*
+*  Makes sure the buffer can take data_size more bytes (plus a NUL).
+*
+*  buffer: Pointer to the StringBuffer struct.
+*  data_size: Number of bytes that will be appended.
+*
+*  returns: If failed (-1), on success (1).
+*/
+int reserve_string_buffer(StringBuffer* buffer, size_t data_size);
+
 /*
 * Function: free_string_buffer
 *
@@ -0,0 +1,72 @@
+#ifndef CHUNKED_H
+#define CHUNKED_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#define CHUNKED_LINE_MAX 4096           // chunk size line with its extensions
+#define CHUNKED_TRAILER_MAX (16 * 1024) // every trailer field together
+
+typedef enum {
+    CHUNKED_SIZE,       // hex digits of the chunk size
+    CHUNKED_EXTENSION,  // ;name=value after the size, skipped
+    CHUNKED_SIZE_LF,
+    CHUNKED_DATA,
+    CHUNKED_DATA_CR,
+    CHUNKED_DATA_LF,
+    CHUNKED_TRAILER,    // trailer field line, or the empty line ending the body
+    CHUNKED_TRAILER_LF,
+    CHUNKED_DONE,
+} ChunkedState;
+
+// Incremental decoder of a chunked request body, resumed as bytes arrive.
+typedef struct {
+    ChunkedState state;
+    size_t chunk_size;   // bytes left in the current chunk, its size while the size line is read
+    size_t digits;       // hex digits of the current size
+    size_t line_size;    // bytes of the current size or trailer line
+    size_t trailer_size; // bytes of the trailer fields so far
+} ChunkedDecoder;
+
+/*
+ * Function: init_chunked_decoder
+ *
+ * ------------------------------
+ *
+ *  Prepares the decoder for a new body.
+ *
+ *  decoder: pointer to the decoder.
+ */
+void init_chunked_decoder(ChunkedDecoder* decoder);
+
+/*
+ * Function: chunked_decode
+ *
+ * ------------------------
+ *
+ *  Decodes the received bytes in place, the chunk data is moved to the
+ *  front of the buffer. Stops after the last chunk and its trailer, what
+ *  follows belongs to the next request.
+ *
+ *  decoder: pointer to the decoder.
+ *  data: received bytes, overwritten with the decoded ones.
+ *  size: number of received bytes.
+ *  consumed: set to the number of received bytes used up.
+ *
+ *  returns: number of decoded bytes at the front of data. if malformed (-1).
+ */
+ssize_t chunked_decode(ChunkedDecoder* decoder, char* data, size_t size, size_t* consumed);
+
+/*
+ * Function: chunked_decoder_done
+ *
+ * ------------------------------
+ *
+ *  Tells whether the last chunk and the trailer have been read.
+ *
+ *  decoder: pointer to the decoder.
+ *
+ *  returns: complete (1), more to come (0).
+ */
+int chunked_decoder_done(const ChunkedDecoder* decoder);
+#endif
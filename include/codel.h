@@ -0,0 +1,61 @@
+#ifndef CODEL_H
+#define CODEL_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// Queue delay controller in the spirit of CoDel. A standing queue is
+// detected when even the shortest delay of an interval stays above the
+// target. While it persists requests waiting longer than the target are
+// shed, otherwise only those waiting longer than a whole interval.
+typedef struct {
+    pthread_mutex_t lock;             // pool threads of several workers may share it
+    unsigned long long target;        // acceptable standing delay in ms, 0 disables shedding
+    unsigned long long interval;      // window over which the minimum delay is taken, in ms
+    unsigned long long interval_end;  // when the current window closes
+    unsigned long long min_delay;     // shortest delay seen in the current window
+    int overloaded;                   // the previous window never dropped below the target
+} CoDel;
+
+/*
+ * Function: init_codel
+ *
+ * --------------------
+ *
+ *  Initializes the controller.
+ *
+ *  codel: pointer to the controller.
+ *  target: acceptable standing delay in milliseconds, 0 never sheds.
+ *  interval: measurement window in milliseconds.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int init_codel(CoDel* codel, unsigned long long target, unsigned long long interval);
+
+/*
+ * Function: codel_should_shed
+ *
+ * ---------------------------
+ *
+ *  Records the queueing delay of a request that is about to be handled
+ *  and decides whether it should be rejected instead.
+ *
+ *  codel: pointer to the controller.
+ *  delay: milliseconds the request waited before being handled.
+ *  now: current monotonic time in milliseconds.
+ *
+ *  returns: handle the request (0), shed it (1).
+ */
+int codel_should_shed(CoDel* codel, unsigned long long delay, unsigned long long now);
+
+/*
+ * Function: free_codel
+ *
+ * --------------------
+ *
+ *  Releases the controller's lock.
+ *
+ *  codel: pointer to the controller.
+ */
+void free_codel(CoDel* codel);
+#endif
@@ -0,0 +1,104 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+#include "polls.h"
+#include "socket_options.h"
+
+#define DEFAULT_KEEP_ALIVE_TIMEOUT 5
+#define DEFAULT_HEADER_TIMEOUT 10
+#define DEFAULT_BODY_TIMEOUT 30
+#define DEFAULT_WRITE_TIMEOUT 30
+#define DEFAULT_KEEP_ALIVE_REQUESTS 100
+#define DEFAULT_ACCEPT_BATCH 64
+#define DEFAULT_MAX_CONNECTIONS 10000
+#define DEFAULT_SHED_TARGET 5     // ms
+#define DEFAULT_SHED_INTERVAL 100 // ms
+#define SHED_RETRY_AFTER "1"      // seconds, sent with shed responses
+#define DEFAULT_DRAIN_TIMEOUT 30
+#define DEFAULT_LISTEN_BACKLOG 1024 // capped by net.core.somaxconn
+#define DEFAULT_OUTPUT_HIGH_WATER (1024 * 1024) // bytes
+#define DEFAULT_SENDFILE_THRESHOLD (16 * 1024)  // bytes
+#define DEFAULT_MAX_BODY_SIZE (1024 * 1024)     // bytes
+#define DEFAULT_BODY_MEMORY_LIMIT (16 * 1024)   // bytes
+#define DEFAULT_BODY_TEMP_DIR "/tmp"
+#define MAX_LISTENERS 8
+#define LISTENER_ADDRESS_SIZE 108 // sizeof(sockaddr_un.sun_path)
+
+typedef enum {
+    LISTENER_TCP4,
+    LISTENER_TCP6, // dual-stack unless a tcp4 listener has the same port
+    LISTENER_UNIX
+} ListenerType;
+
+typedef struct {
+    ListenerType type;
+    char address[LISTENER_ADDRESS_SIZE]; // host to bind, empty for every address, socket path for unix
+    char port[6];
+    int v6only;          // IPv6 only, the IPv4 side is bound separately
+    size_t accept_batch; // connections accepted per wakeup
+    int backlog;         // listen queue length
+} ListenerConfig;
+
+typedef struct {
+    char** argv;                    // command line, executed again on reload
+    ListenerConfig listeners[MAX_LISTENERS];
+    size_t listener_count;
+    PollBackend poll_backend;
+    PollTrigger poll_trigger;
+    int keep_alive_timeout;         // idle seconds before a connection is closed
+    int header_timeout;             // seconds to receive a request's headers
+    int body_timeout;               // seconds without progress while receiving a body
+    int write_timeout;              // seconds without progress while sending a response
+    size_t max_keep_alive_requests; // requests served on one connection
+    size_t workers;                 // event loops, each on its own thread and listener
+    size_t handler_threads;         // route handlers run off the event loops, 0 runs them inline
+    size_t accept_batch;            // connections accepted per listener wakeup, unless the listener sets it
+    int backlog;                    // listen queue length, unless the listener sets it
+    size_t max_connections;         // open client connections over all workers, 0 is unlimited
+    unsigned long long shed_target;   // tolerated standing queue delay in ms, 0 never sheds
+    unsigned long long shed_interval; // window the queue delay is measured over in ms
+    int drain_timeout;              // seconds in-flight requests get after SIGTERM
+    size_t output_high_water;       // pending response bytes before a client is no longer read, 0 is unlimited
+    size_t sendfile_threshold;      // static files at least this large are sent with sendfile
+    size_t max_body_size;           // request body limit of routes without their own, 0 is unlimited
+    size_t body_memory_limit;       // request bodies over this are spilled to a temp file
+    const char* body_temp_dir;      // where spilled request bodies go
+    SocketOptions socket_options;   // applied to listeners and accepted sockets
+} ServerConfig;
+
+/*
+ * Function: init_server_config
+ *
+ * ----------------------------
+ *
+ *  Fills the config with default values.
+ *
+ *  config: pointer to the server config.
+ */
+void init_server_config(ServerConfig* config);
+
+/*
+ * Function: parse_server_config
+ *
+ * -----------------------------
+ *
+ *  Parses command line arguments into the config.
+ *
+ *  argc: number of arguments.
+ *  argv: argument list.
+ *  config: pointer to the server config.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int parse_server_config(int argc, char** argv, ServerConfig* config);
+
+/*
+ * Function: print_usage
+ *
+ * ---------------------
+ *
+ *  Prints command line usage.
+ *
+ *  program: program name.
+ */
+void print_usage(const char* program);
+#endif
@@ -0,0 +1,180 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+#include "buffer.h"
+#include "chunked.h"
+#include "output_queue.h"
+#include "request.h"
+#include "slab.h"
+#include "timer_wheel.h"
+
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define REQUEST_ARENA_SIZE (4 * 1024) // inline arena block, holds a small page and its header fields
+
+typedef enum {
+    CONNECTION_LISTENER,
+    CONNECTION_CLIENT,
+    CONNECTION_NOTIFY, // eventfd signalled by handler threads
+} ConnectionType;
+
+typedef enum {
+    CONNECTION_READING_HEADER,
+    CONNECTION_READING_BODY,
+    CONNECTION_REQUEST_READY,
+} ConnectionState;
+
+// Deadline tracked by the connection's read timer.
+typedef enum {
+    CONNECTION_DEADLINE_NONE,
+    CONNECTION_DEADLINE_IDLE,   // keep-alive, waiting for the next request
+    CONNECTION_DEADLINE_HEADER, // whole header, from its first byte
+    CONNECTION_DEADLINE_BODY,   // between two reads of the body
+    CONNECTION_DEADLINE_WRITE,  // between two sends of the response
+} ConnectionDeadline;
+
+// Kind of io_uring request made for a connection, tells its completions apart.
+typedef enum {
+    IO_OP_ACCEPT,    // multishot accept of a listener
+    IO_OP_RECV,      // receive into a buffer the kernel picks
+    IO_OP_SEND,      // send of the queued output
+    IO_OP_FILE_READ, // file range read into file_buffer, linked ahead of the send
+} IoOpType;
+
+// One request in flight, its address is the request's user data.
+typedef struct {
+    IoOpType type;
+    int active; // submitted, its last completion not seen yet
+    struct connection* conn;
+} IoOp;
+
+// Per worker free lists backing its client connections.
+typedef struct {
+    SlabPool connections; // Connection records
+    SlabPool segments;    // output segments
+    BufferPool buffers;   // request buffers and output buffers
+} ConnectionPools;
+
+typedef struct connection {
+    int fd;
+    ConnectionType type;
+    ConnectionState state;
+    StringBuffer request_buffer; // partial request, kept across wakeups
+    HTTPParser parser;           // header parse, resumed as bytes arrive
+    size_t header_size;          // request line + fields + empty line
+    size_t content_length;
+    int chunked;                  // body sent with Transfer-Encoding: chunked
+    ChunkedDecoder chunks;
+    size_t body_limit;            // largest body the route takes, 0 is unlimited
+    HTTPRequest req;
+    Arena arena;                  // request lifetime memory, starts in arena_block
+    char arena_block[REQUEST_ARENA_SIZE];
+    OutputQueue output;           // responses not yet written, in order
+    short poll_events;            // events currently requested from the poll list
+    int read_closed;              // peer shut down its side
+    int closing;                  // close once the responses are flushed
+    int busy;                     // request handed to a handler thread, not read meanwhile
+    size_t requests_served;
+    Timer read_timer;             // idle, header or body deadline
+    Timer write_timer;            // deadline while a response is pending
+    size_t deadline_request;      // requests_served when the read deadline was set
+    int read_progress;            // bytes received since the deadlines were updated
+    int write_progress;           // bytes sent since the deadlines were updated
+    size_t listener_index;        // entry in the config's listeners, listener connections only
+    IoOp input_op;                // io_uring only, accept on listeners, receive on clients
+    IoOp send_op;                 // io_uring only
+    IoOp file_op;                 // io_uring only
+    struct iovec send_iov[OUTPUT_IOV_MAX]; // memory segments of the send in flight
+    struct msghdr send_msg;
+    StringBuffer file_buffer;     // file bytes of the send in flight
+    size_t file_size;             // bytes the linked file read was asked for, 0 for memory sends
+    int file_result;              // completion of the file read, -errno if it failed
+    ConnectionPools* pools;       // owning worker's pools, NULL if malloc'd
+    struct connection* prev;
+    struct connection* next;
+} Connection;
+
+typedef struct {
+    Connection* head;
+    Connection* tail;
+    size_t size;
+} ConnectionList;
+
+/*
+ * Function: create_connection
+ *
+ * ---------------------------
+ *
+ *  Creates the state attached to a polled file descriptor.
+ *
+ *  fd: file descriptor of the socket.
+ *  type: listener or client socket.
+ *  pools: worker pools to allocate from, NULL uses malloc.
+ *
+ *  returns: pointer to the connection. if failed, NULL.
+ */
+Connection* create_connection(int fd, ConnectionType type, ConnectionPools* pools);
+
+/*
+ * Function: reset_connection_request
+ *
+ * ----------------------------------
+ *
+ *  Frees the parsed request and drops its bytes from the request buffer,
+ *  keeping any pipelined data that follows it for the next request.
+ *
+ *  conn: pointer to the connection.
+ */
+void reset_connection_request(Connection* conn);
+
+/*
+ * Function: connection_list_push
+ *
+ * ------------------------------
+ *
+ *  Appends the connection to the list.
+ *
+ *  list: pointer to the connection list.
+ *  conn: pointer to the connection.
+ */
+void connection_list_push(ConnectionList* list, Connection* conn);
+
+/*
+ * Function: connection_list_remove
+ *
+ * --------------------------------
+ *
+ *  Unlinks the connection from the list.
+ *
+ *  list: pointer to the connection list.
+ *  conn: pointer to the connection.
+ */
+void connection_list_remove(ConnectionList* list, Connection* conn);
+
+/*
+ * Function: connection_io_active
+ *
+ * ------------------------------
+ *
+ *  Tells whether an io_uring request of the connection is still in flight,
+ *  the kernel may use its memory until the request completes.
+ *
+ *  conn: pointer to the connection.
+ *
+ *  returns: in flight (1), otherwise (0).
+ */
+int connection_io_active(const Connection* conn);
+
+/*
+ * Function: free_connection
+ *
+ * -------------------------
+ *
+ *  Frees the connection state, returning pooled memory to its pools. The
+ *  socket is not closed.
+ *
+ *  conn: pointer to the connection.
+ */
+void free_connection(Connection* conn);
+#endif
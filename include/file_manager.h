@@ -1,5 +1,6 @@
 #ifndef FILE_MANAGER_H
 #define FILE_MANAGER_H
+#include "arena.h"
 #include "hash.h"
 
 #include <stdio.h>
@@ -69,13 +70,14 @@ ssize_t read_file_content(const char* path, unsigned char** buffer);
 *
 *  Converts requested path to local path.
 *
+*  arena: arena for the local path, NULL uses malloc.
 *  req_path: Requested path.
 *  req_path_size: Requested path string size.
 *  local_path: Pointer to the local path string.
 *
 *  returns: Local path string size. If failed, returns (-1).
 */
-int req_path_to_local(const char* req_path, size_t req_path_size, char** local_path);
+int req_path_to_local(Arena* arena, const char* req_path, size_t req_path_size, char** local_path);
 
 /*
  * Function: free_file_table
@@ -94,12 +96,13 @@ void free_file_table(FileTable* file_table);
 *
 * -----------------------------
 *  
-*  Sends file to client in chunks.
+*  Sends the whole file to a blocking socket with sendfile, straight from
+*  the page cache.
 *
 *  client_fd: client file discriptor.
 *  path: file path.
 *
-*  returns: Number of sent bytes.
+*  returns: Number of sent bytes. If failed, returns (-1).
 */
 ssize_t stream_file_content(int client_fd, const char* path);
 #endif
@@ -0,0 +1,79 @@
+#ifndef KNOWN_HEADERS_H
+#define KNOWN_HEADERS_H
+
+#include <stdio.h>
+
+// Request headers with a fixed slot in every parsed request. The lowercase
+// first and last characters are the inputs of the perfect hash below.
+#define HTTP_KNOWN_HEADERS(X) \
+    X(HOST,                  "Host",                  'h', 't') \
+    X(CONNECTION,            "Connection",            'c', 'n') \
+    X(CONTENT_LENGTH,        "Content-Length",        'c', 'h') \
+    X(CONTENT_TYPE,          "Content-Type",          'c', 'e') \
+    X(TRANSFER_ENCODING,     "Transfer-Encoding",     't', 'g') \
+    X(TE,                    "TE",                    't', 'e') \
+    X(TRAILER,               "Trailer",               't', 'r') \
+    X(UPGRADE,               "Upgrade",               'u', 'e') \
+    X(EXPECT,                "Expect",                'e', 't') \
+    X(KEEP_ALIVE,            "Keep-Alive",            'k', 'e') \
+    X(ACCEPT,                "Accept",                'a', 't') \
+    X(ACCEPT_ENCODING,       "Accept-Encoding",       'a', 'g') \
+    X(ACCEPT_LANGUAGE,       "Accept-Language",       'a', 'e') \
+    X(ACCEPT_CHARSET,        "Accept-Charset",        'a', 't') \
+    X(USER_AGENT,            "User-Agent",            'u', 't') \
+    X(REFERER,               "Referer",               'r', 'r') \
+    X(ORIGIN,                "Origin",                'o', 'n') \
+    X(COOKIE,                "Cookie",                'c', 'e') \
+    X(AUTHORIZATION,         "Authorization",         'a', 'n') \
+    X(RANGE,                 "Range",                 'r', 'e') \
+    X(IF_RANGE,              "If-Range",              'i', 'e') \
+    X(IF_MATCH,              "If-Match",              'i', 'h') \
+    X(IF_NONE_MATCH,         "If-None-Match",         'i', 'h') \
+    X(IF_MODIFIED_SINCE,     "If-Modified-Since",     'i', 'e') \
+    X(IF_UNMODIFIED_SINCE,   "If-Unmodified-Since",   'i', 'e') \
+    X(CACHE_CONTROL,         "Cache-Control",         'c', 'l') \
+    X(PRAGMA,                "Pragma",                'p', 'a') \
+    X(X_FORWARDED_FOR,       "X-Forwarded-For",       'x', 'r') \
+    X(X_FORWARDED_PROTO,     "X-Forwarded-Proto",     'x', 'o') \
+    X(X_REAL_IP,             "X-Real-IP",             'x', 'p') \
+    X(VIA,                   "Via",                   'v', 'a') \
+    X(DATE,                  "Date",                  'd', 'e') \
+    X(CONTENT_ENCODING,      "Content-Encoding",      'c', 'g') \
+    X(FORWARDED,             "Forwarded",             'f', 'd') \
+    X(PROXY_AUTHORIZATION,   "Proxy-Authorization",   'p', 'n')
+
+typedef enum {
+#define HTTP_HEADER_ID(id, name, first, last) HTTP_HEADER_##id,
+    HTTP_KNOWN_HEADERS(HTTP_HEADER_ID)
+#undef HTTP_HEADER_ID
+    HTTP_HEADER_COUNT,
+} HTTPHeaderId;
+
+/*
+ * Function: http_header_id
+ *
+ * ------------------------
+ *
+ *  Classifies a header name, case-insensitively, with one hash probe and
+ *  one comparison.
+ *
+ *  name: field name, not necessarily NUL terminated.
+ *  size: length of the name.
+ *
+ *  returns: id of the header. if it is not a known one (-1).
+ */
+int http_header_id(const char* name, size_t size);
+
+/*
+ * Function: http_header_name
+ *
+ * --------------------------
+ *
+ *  Returns the canonical spelling of a known header.
+ *
+ *  id: header id.
+ *
+ *  returns: header name. if the id is out of range, NULL.
+ */
+const char* http_header_name(HTTPHeaderId id);
+#endif
@@ -0,0 +1,95 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+// Environment handed to a successor started by a reload.
+#define LISTEN_FDS_ENV "HTTP_SERVER_LISTEN_FDS"   // comma separated listener descriptors
+#define PREDECESSOR_ENV "HTTP_SERVER_PREDECESSOR" // pid to stop once the successor listens
+
+/*
+ * Function: install_signal_handlers
+ *
+ * ---------------------------------
+ *
+ *  SIGTERM requests a graceful drain, SIGHUP and SIGUSR2 request a reload.
+ *  Every request is announced by writing to the given eventfds. SIGPIPE
+ *  is ignored, sendfile has no MSG_NOSIGNAL.
+ *
+ *  wake_fds: eventfds of the event loops, must outlive the handlers.
+ *  count: number of eventfds.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int install_signal_handlers(const int* wake_fds, size_t count);
+
+/*
+ * Function: remove_signal_handlers
+ *
+ * --------------------------------
+ *
+ *  Restores the default signal dispositions.
+ */
+void remove_signal_handlers(void);
+
+/*
+ * Function: drain_requested
+ *
+ * -------------------------
+ *
+ *  returns: a drain was requested (1), otherwise (0).
+ */
+int drain_requested(void);
+
+/*
+ * Function: take_reload_request
+ *
+ * -----------------------------
+ *
+ *  Consumes a pending reload request, so only one caller acts on it.
+ *
+ *  returns: a reload was pending (1), otherwise (0).
+ */
+int take_reload_request(void);
+
+/*
+ * Function: inherited_listeners
+ *
+ * -----------------------------
+ *
+ *  Reads the listener descriptors passed down by a predecessor and clears
+ *  the hand-off environment. Must run before any thread is started.
+ *
+ *  count: receives the number of descriptors.
+ *
+ *  returns: allocated descriptor list. NULL if none were inherited or failed.
+ */
+int* inherited_listeners(size_t* count);
+
+/*
+ * Function: spawn_successor
+ *
+ * -------------------------
+ *
+ *  Executes the server binary again with the listeners inherited, so the
+ *  backlog is kept while the successor starts.
+ *
+ *  argv: command line the server was started with.
+ *  listener_fds: listener descriptors to hand down, -1 entries are skipped.
+ *  count: number of descriptors.
+ *
+ *  returns: pid of the successor. if failed (-1).
+ */
+pid_t spawn_successor(char** argv, const int* listener_fds, size_t count);
+
+/*
+ * Function: notify_predecessor
+ *
+ * ----------------------------
+ *
+ *  Asks the server that handed down the listeners to drain, once this
+ *  process accepts on them.
+ */
+void notify_predecessor(void);
+#endif
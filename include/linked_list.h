@@ -2,6 +2,8 @@
 #define LINKED_LIST_H 
 #include <stdio.h>
 
+#include "arena.h"
+
 typedef struct list_node {
     size_t value_size;
     char* key;
@@ -12,6 +14,7 @@ typedef struct list_node {
 typedef struct {
     size_t size;
     ListItem* items;
+    Arena* arena; // items allocated here when set, left to the arena's reset
 } List;
 
 /*
@@ -21,9 +24,11 @@ typedef struct {
  *
  *  Creates a list item.
  *
+ *  arena: arena to allocate from, NULL uses malloc.
+ *
  *  returns: Pointer to the item.
  */
-ListItem* create_item(const char* key, const void* value, size_t value_size);
+ListItem* create_item(Arena* arena, const char* key, const void* value, size_t value_size);
 
 /*
  * Function: list_set_item
@@ -0,0 +1,55 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Intrusive node, embedded as the first member of queued structs.
+typedef struct mpsc_node {
+    struct mpsc_node* _Atomic next;
+} MpscNode;
+
+// Lock-free multi-producer single-consumer FIFO queue.
+typedef struct {
+    MpscNode* _Atomic head; // last pushed node, shared by producers
+    MpscNode* tail;         // next node to pop, consumer only
+    MpscNode stub;
+} MpscQueue;
+
+/*
+ * Function: init_mpsc_queue
+ *
+ * -------------------------
+ *
+ *  Initializes an empty queue.
+ *
+ *  queue: pointer to the queue.
+ */
+void init_mpsc_queue(MpscQueue* queue);
+
+/*
+ * Function: mpsc_queue_push
+ *
+ * -------------------------
+ *
+ *  Appends a node, safe to call from any thread.
+ *
+ *  queue: pointer to the queue.
+ *  node: pointer to the node.
+ */
+void mpsc_queue_push(MpscQueue* queue, MpscNode* node);
+
+/*
+ * Function: mpsc_queue_pop
+ *
+ * ------------------------
+ *
+ *  Removes the oldest node, only called by the consumer thread.
+ *
+ *  queue: pointer to the queue.
+ *
+ *  returns: pointer to the node. NULL if the queue is empty or a push is
+ *           still in progress.
+ */
+MpscNode* mpsc_queue_pop(MpscQueue* queue);
+#endif
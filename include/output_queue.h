@@ -0,0 +1,212 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+#include "buffer.h"
+#include "slab.h"
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define OUTPUT_BUFFER_SIZE 4096    // initial capacity of a memory segment
+#define OUTPUT_COPY_LIMIT 1024     // smaller bodies are copied, an extra segment would cost more
+#define OUTPUT_IOV_MAX 16          // segments gathered into one send
+
+typedef enum {
+    OUTPUT_SEGMENT_MEMORY, // owned bytes, responses are serialized straight into it
+    OUTPUT_SEGMENT_DATA,   // heap buffer handed over as is, never appended to
+    OUTPUT_SEGMENT_FILE,   // range of an open file, sent with sendfile
+} OutputSegmentType;
+
+typedef struct output_segment {
+    OutputSegmentType type;
+    StringBuffer buffer; // memory and data segments
+    size_t sent;         // bytes of buffer already written
+    int fd;              // file segments, closed with the segment
+    off_t offset;        // next file byte to write
+    size_t length;       // file bytes left to write
+    int pooled;          // taken from the queue's segment pool, not malloc'd
+    int sealed;          // handed to a send in flight, appending goes to a new segment
+    struct output_segment* next;
+} OutputSegment;
+
+// Bytes waiting to be written to one socket, in order. Memory segments
+// are reused once written, so a keep-alive connection allocates its
+// output buffer only once.
+typedef struct {
+    OutputSegment* head;
+    OutputSegment* tail;
+    SlabPool* segments;  // segment records, NULL uses malloc
+    BufferPool* buffers; // memory segment buffers, NULL uses malloc
+} OutputQueue;
+
+/*
+ * Function: init_output_queue
+ *
+ * ---------------------------
+ *
+ *  Initializes an empty queue. The pools are only safe to pass when the
+ *  queue is used by their owning thread alone.
+ *
+ *  queue: pointer to the output queue.
+ *  segments: pool for segment records, NULL uses malloc.
+ *  buffers: pool for memory segment buffers, NULL uses malloc.
+ */
+void init_output_queue(OutputQueue* queue, SlabPool* segments, BufferPool* buffers);
+
+/*
+ * Function: output_queue_buffer
+ *
+ * -----------------------------
+ *
+ *  Returns the buffer at the end of the queue, appending a memory segment
+ *  if the last one is a file, a handed over buffer or sealed.
+ *
+ *  queue: pointer to the output queue.
+ *
+ *  returns: pointer to the buffer. if failed, NULL.
+ */
+StringBuffer* output_queue_buffer(OutputQueue* queue);
+
+/*
+ * Function: output_queue_write
+ *
+ * ----------------------------
+ *
+ *  Copies data to the end of the queue.
+ *
+ *  queue: pointer to the output queue.
+ *  data: pointer to the data.
+ *  data_size: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int output_queue_write(OutputQueue* queue, const char* data, size_t data_size);
+
+/*
+ * Function: output_queue_take
+ *
+ * ---------------------------
+ *
+ *  Appends a heap buffer without copying it, unless it is small. The
+ *  queue frees it once written, also when appending fails.
+ *
+ *  queue: pointer to the output queue.
+ *  data: buffer allocated with malloc.
+ *  data_size: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int output_queue_take(OutputQueue* queue, char* data, size_t data_size);
+
+/*
+ * Function: output_queue_file
+ *
+ * ---------------------------
+ *
+ *  Appends a range of a file. The queue owns the descriptor from then on,
+ *  also when appending fails.
+ *
+ *  queue: pointer to the output queue.
+ *  fd: open file descriptor.
+ *  offset: first byte of the range.
+ *  length: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int output_queue_file(OutputQueue* queue, int fd, off_t offset, size_t length);
+
+/*
+ * Function: output_queue_splice
+ *
+ * -----------------------------
+ *
+ *  Moves every segment of src to the end of dst, leaving src empty.
+ *
+ *  dst: pointer to the receiving queue.
+ *  src: pointer to the queue being emptied.
+ */
+void output_queue_splice(OutputQueue* dst, OutputQueue* src);
+
+/*
+ * Function: output_queue_pending
+ *
+ * ------------------------------
+ *
+ *  Counts the bytes not yet written.
+ *
+ *  queue: pointer to the output queue.
+ *
+ *  returns: number of pending bytes.
+ */
+size_t output_queue_pending(const OutputQueue* queue);
+
+/*
+ * Function: output_queue_gather
+ *
+ * -----------------------------
+ *
+ *  Describes the unwritten bytes of the memory segments at the head of the
+ *  queue, up to the first file, without writing them. Written segments
+ *  are dropped first, so a file at the head is left at queue->head.
+ *
+ *  queue: pointer to the output queue.
+ *  iov: receives the byte ranges.
+ *  iov_max: number of entries iov holds.
+ *  size: receives the number of bytes described.
+ *
+ *  returns: number of entries filled, 0 if the head is a file or nothing is left.
+ */
+size_t output_queue_gather(OutputQueue* queue, struct iovec* iov, size_t iov_max, size_t* size);
+
+/*
+ * Function: output_queue_advance
+ *
+ * ------------------------------
+ *
+ *  Drops written bytes from the head of the queue, file ranges included.
+ *
+ *  queue: pointer to the output queue.
+ *  sent: number of bytes written.
+ */
+void output_queue_advance(OutputQueue* queue, size_t sent);
+
+/*
+ * Function: output_queue_seal
+ *
+ * ---------------------------
+ *
+ *  Stops appending to the last segment, whose bytes a send in flight may
+ *  still read. Later writes start a new segment.
+ *
+ *  queue: pointer to the output queue.
+ */
+void output_queue_seal(OutputQueue* queue);
+
+/*
+ * Function: output_queue_send
+ *
+ * ---------------------------
+ *
+ *  Writes as much of the queue as the socket takes without blocking.
+ *  Consecutive buffers go out together in one gathered send, files with
+ *  sendfile. The socket is corked meanwhile so a header shares its
+ *  segments with the file data that follows it.
+ *
+ *  queue: pointer to the output queue.
+ *  socket_fd: non-blocking socket.
+ *
+ *  returns: number of bytes sent. if failed (-1).
+ */
+ssize_t output_queue_send(OutputQueue* queue, int socket_fd);
+
+/*
+ * Function: free_output_queue
+ *
+ * ---------------------------
+ *
+ *  Frees every segment and closes their files.
+ *
+ *  queue: pointer to the output queue.
+ */
+void free_output_queue(OutputQueue* queue);
+#endif
@@ -6,10 +6,59 @@
 #include <poll.h>
 #include <sys/poll.h>
 
+#define POLL_MAX_EVENTS 512
+#define POLL_BUFFER_GROUP 0 // io_uring buffer group picked from by receive requests
+
+typedef enum {
+    POLL_BACKEND_POLL,
+    POLL_BACKEND_EPOLL,
+    POLL_BACKEND_URING, // io_uring requests, falls back to epoll when unsupported
+} PollBackend;
+
+typedef enum {
+    POLL_TRIGGER_LEVEL,
+    POLL_TRIGGER_EDGE, // epoll and io_uring only, ignored by the poll backend
+} PollTrigger;
+
+typedef struct {
+    short revents; // POLLIN, POLLOUT, POLLHUP, POLLERR
+    void* data;    // pointer registered with the fd
+} PollEvent;
+
+// Finished I/O request of the io_uring backend, see pfds_prepare.
+typedef struct {
+    void* data;     // pointer given to pfds_prepare
+    int result;     // bytes moved, the accepted fd or -errno
+    unsigned flags; // IORING_CQE_F_* bits, F_MORE while a multishot request goes on
+} PollCompletion;
+
+struct uring;
+struct uring_poll;
+struct uring_buffers;
+struct io_uring_sqe;
+
 typedef struct {
+    PollBackend backend;
+    PollTrigger trigger;
+    int epoll_fd;
     size_t size;
     size_t max_size;
-    struct pollfd* items;
+    struct pollfd* items; // poll backend only
+    void** data;          // poll backend only, parallel to items
+    PollEvent* events;    // ready events of the last pfds_wait
+    size_t event_count;
+    size_t max_events;
+    struct uring* ring;         // io_uring backend only
+    struct uring_poll** polls;  // io_uring backend only, indexed by fd
+    size_t max_polls;
+    struct uring_poll* all;     // io_uring backend only, every poll not yet released
+    struct uring_poll* unarmed; // io_uring backend only, submitted on the next wait
+    unsigned long long wait_round;
+    int completion_io;              // io_uring backend only, sockets are read and written by requests
+    struct uring_buffers* buffers;  // io_uring backend only, picked by receive requests
+    PollCompletion* completions;    // finished requests of the last pfds_wait
+    size_t completion_count;
+    size_t io_pending;              // requests whose last completion has not been seen
 } PollFd;
 
 /*
@@ -21,10 +70,12 @@ typedef struct {
  *
  *  pfds: pointer to the poll file discriptor list struct.
  *  initial_size: list's initial size.
+ *  backend: readiness backend (poll, epoll or io_uring).
+ *  trigger: level or edge triggered notifications.
  *
  *  returns: if failed (-1), on success (1).
  */
-int init_pfds(PollFd* pfds, size_t initial_size);
+int init_pfds(PollFd* pfds, size_t initial_size, PollBackend backend, PollTrigger trigger);
 
 /*
  * Function pfds_add
@@ -35,25 +86,173 @@ int init_pfds(PollFd* pfds, size_t initial_size);
  *
  *  pfds: Pointer to the Poll list.
  *  new_fd: File descriptor.
+ *  events: Requested events (POLLIN, POLLOUT).
+ *  data: Pointer returned with every ready event of the fd.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_add(PollFd* pfds, int new_fd, short events, void* data);
+
+/*
+ * Function pfds_mod
+ *
+ * -----------------
+ *
+ *  Changes the requested events of a registered file descriptor.
+ *
+ *  pfds: Pointer to the Poll list.
+ *  fd: File descriptor.
+ *  events: Requested events (POLLIN, POLLOUT).
+ *  data: Pointer returned with every ready event of the fd.
  *
  *  returns: if failed (-1), on success (1).
  */
-int pfds_add(PollFd* pfds, int new_fd);
+int pfds_mod(PollFd* pfds, int fd, short events, void* data);
+
+/*
+ * Function: pfds_unwatch
+ *
+ * ----------------------
+ *
+ *  Deletes desired polls item without closing its fd, for fds the
+ *  caller closes itself.
+ *
+ *  pfds: pointer to the polls list.
+ *  fd: file descriptor of the item.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_unwatch(PollFd* pfds, int fd);
 
 /*
  * Function: pfds_del
  *
  * ------------------
  *
- *  Deletes and closes desired polls item.
+ *  Deletes and closes desired polls item. An fd that is not in the
+ *  list is left open.
  *
  *  pfds: pointer to the polls list.
- *  index: item index.
+ *  fd: file descriptor of the item.
  *
  *  returns: if failed (-1), on success (1).
  */
-int pfds_del(PollFd* pfds, int index);
+int pfds_del(PollFd* pfds, int fd);
+
+/*
+ * Function: pfds_wait
+ *
+ * -------------------
+ *
+ *  Waits for events and stores the ready ones in pfds->events, the
+ *  finished I/O requests in pfds->completions.
+ *
+ *  pfds: pointer to the poll list.
+ *  timeout: timeout in milliseconds, (-1) waits forever.
+ *
+ *  returns: number of ready events and completions. if failed (-1).
+ */
+int pfds_wait(PollFd* pfds, int timeout);
 
+/*
+ * Function: pfds_enable_io
+ *
+ * ------------------------
+ *
+ *  Lets the io_uring backend run socket I/O as requests whose completions
+ *  pfds_wait collects in pfds->completions, next to the ready events of
+ *  the polled fds. Registers the receive buffers the kernel picks from.
+ *
+ *  pfds: pointer to the poll list.
+ *  buffer_count: number of receive buffers, a power of two.
+ *  buffer_size: bytes per receive buffer.
+ *
+ *  returns: if failed or not supported (-1), on success (1).
+ */
+int pfds_enable_io(PollFd* pfds, size_t buffer_count, size_t buffer_size);
+
+/*
+ * Function: pfds_reserve
+ *
+ * ----------------------
+ *
+ *  Makes room for count requests, so linked ones are submitted together.
+ *
+ *  pfds: pointer to the poll list.
+ *  count: number of requests.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_reserve(PollFd* pfds, unsigned count);
+
+/*
+ * Function: pfds_prepare
+ *
+ * ----------------------
+ *
+ *  Queues an I/O request, submitted with the next wait. The caller fills
+ *  in the operation, its completions are reported with data.
+ *
+ *  pfds: pointer to the poll list.
+ *  data: pointer reported with the completions, 4 byte aligned.
+ *
+ *  returns: pointer to the submission entry. if failed, NULL.
+ */
+struct io_uring_sqe* pfds_prepare(PollFd* pfds, void* data);
+
+/*
+ * Function: pfds_cancel
+ *
+ * ---------------------
+ *
+ *  Queues the cancellation of the request made with data. The request
+ *  still completes, with -ECANCELED unless it finished first.
+ *
+ *  pfds: pointer to the poll list.
+ *  data: pointer the request was prepared with.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_cancel(PollFd* pfds, void* data);
+
+/*
+ * Function: pfds_submit
+ *
+ * ---------------------
+ *
+ *  Submits the queued requests right away instead of with the next wait.
+ *
+ *  pfds: pointer to the poll list.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_submit(PollFd* pfds);
+
+/*
+ * Function: pfds_buffer
+ *
+ * ---------------------
+ *
+ *  Returns the receive buffer holding a completion's data.
+ *
+ *  pfds: pointer to the poll list.
+ *  completion: finished receive request.
+ *
+ *  returns: pointer to the data. NULL if the completion has no buffer.
+ */
+char* pfds_buffer(PollFd* pfds, const PollCompletion* completion);
+
+/*
+ * Function: pfds_release_buffer
+ *
+ * -----------------------------
+ *
+ *  Hands a completion's receive buffer back to the kernel, if it has one.
+ *
+ *  pfds: pointer to the poll list.
+ *  completion: finished receive request.
+ */
+void pfds_release_buffer(PollFd* pfds, const PollCompletion* completion);
 
 /*
  * Function: free_pfds
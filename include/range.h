@@ -0,0 +1,31 @@
+#ifndef RANGE_H
+#define RANGE_H
+
+#include <stdio.h>
+
+#define MAX_BYTE_RANGES 16 // more ranges than this and the whole file is sent instead
+
+typedef struct {
+    size_t start;
+    size_t length;
+} ByteRange;
+
+/*
+ * Function: parse_byte_ranges
+ *
+ * ---------------------------
+ *
+ *  Parses the value of a Range header against a representation of the
+ *  given size. Ranges past the end are dropped, ends past it are clamped
+ *  and suffix ranges are resolved from the end.
+ *
+ *  value: Range header value, e.g. "bytes=0-99, -500".
+ *  size: size of the representation in bytes.
+ *  ranges: receives the satisfiable ranges, in request order.
+ *  max_ranges: capacity of ranges.
+ *
+ *  returns: number of satisfiable ranges, none of them (0). if the header
+ *           is malformed or asks for too many ranges (-1), it is ignored.
+ */
+int parse_byte_ranges(const char* value, size_t size, ByteRange* ranges, size_t max_ranges);
+#endif
@@ -1,37 +1,79 @@
 #ifndef REQUEST_H
 #define REQUEST_H
+#include "body.h"
 #include "buffer.h"
+#include "known_headers.h"
 #include "linked_list.h"
+#include "output_queue.h"
 
 #include <stdio.h>
 #include <time.h>
 
 #define DATE_BUFFER_SIZE 64
+#define MAX_HEADER_FIELDS 64 // requests with more header fields are rejected
 
+// Date header line, reformatted only when the second changes.
 typedef struct {
+    time_t second; // time the line was formatted for
+    size_t size;   // 0 until the first update
+    char line[DATE_BUFFER_SIZE];
+} DateCache;
+
+// Bytes of the raw request, counted from its first byte. Parsed tokens
+// are NUL terminated in place, so a view can also be read as a string.
+typedef struct {
+    size_t offset;
     size_t size;
-    size_t max_size;
-    char** lines;
-} LineArray;
+} StringView;
 
 typedef struct {
-    char http_version[11]; // HTTP/XX.XX
-    char method[8]; // GET, HEAD, PUT, POST, PATCH, DELETE, CONNECT, OPTIONS, TRACE
-    char* path;
-    List* header_fields;
+    StringView name;
+    StringView value; // without surrounding whitespace
+} HTTPHeaderField;
+
+typedef struct {
+    StringView method;       // GET, HEAD, PUT, POST, PATCH, DELETE, CONNECT, OPTIONS, TRACE
+    StringView path;
+    StringView http_version; // HTTP/XX.XX
+    HTTPHeaderField fields[MAX_HEADER_FIELDS]; // every field in arrival order, unknown ones are only found here
+    size_t field_count;
+    unsigned char known[HTTP_HEADER_COUNT];    // index + 1 in fields of each known header, 0 if absent
 } HTTPRequestHeader;
 
 typedef struct {
     HTTPRequestHeader http_header;
-    unsigned char* body;
+    char* data; // raw request the views point into, owned by the connection
+    RequestBody body; // filled while the request is received, complete once it is routed
+    Arena* arena; // memory for handling the request, reset along with it
 } HTTPRequest;
 
+typedef enum {
+    HTTP_PARSE_METHOD,
+    HTTP_PARSE_PATH,
+    HTTP_PARSE_VERSION,
+    HTTP_PARSE_LINE_LF,     // CR seen, the line ends with the LF
+    HTTP_PARSE_FIELD_START,
+    HTTP_PARSE_FIELD_NAME,
+    HTTP_PARSE_VALUE_START, // whitespace after the colon
+    HTTP_PARSE_FIELD_VALUE,
+    HTTP_PARSE_HEADER_LF,   // CR of the empty line seen
+    HTTP_PARSE_DONE,
+} HTTPParseState;
+
+// Position of a request header parse, kept between reads.
 typedef struct {
-    char date[DATE_BUFFER_SIZE];
+    HTTPParseState state;
+    size_t offset;      // bytes consumed, the header size once done
+    size_t token_start; // first byte of the token being read
+} HTTPParser;
+
+typedef struct {
+    char date[DATE_BUFFER_SIZE]; // Date header line, CRLF included
     char desc[32]; // OK, NOT FOUND, ETC.
     char http_version[11];
     List* header_fields;
     short code;
+    size_t date_size;
 } HTTPResponseHeader;
 
 typedef struct {
@@ -39,130 +81,176 @@ typedef struct {
     unsigned char* body;
 } HTTPResponse;
 
+typedef struct {
+    OutputQueue* output;       // responses are appended here and written in batches
+    int keep_alive;            // connection stays open after the response
+    int keep_alive_timeout;    // seconds, advertised with Keep-Alive
+    int keep_alive_max;        // requests left on the connection
+    size_t sendfile_threshold; // static files at least this large are sent with sendfile
+    int chunked;               // the client takes chunked responses, others get streamed bodies until close
+    int (*flush)(void* context); // sends the output so far while the handler runs, NULL if it waits for the handler
+    void* flush_context;
+    const DateCache* date;     // preformatted Date line of the current second, NULL formats one per response
+    int head;                  // HEAD request, every header goes out without its body
+} ResponseWriter;
+
+/*
+ * Function: init_http_parser
+ *
+ * --------------------------
+ *
+ *  Prepares the parser for a new request.
+ *
+ *  parser: pointer to the parser.
+ */
+void init_http_parser(HTTPParser* parser);
+
 /*
- * Function: init_lines
+ * Function: parse_header
  *
- * --------------------
+ * ----------------------
  *
- *  Initiates line list.
+ *  Parses the request line and header fields in a single pass, resuming
+ *  where the previous call stopped. Nothing is copied or allocated, the
+ *  request records views into data and terminates them in place.
  *
- *  line_arr: pointer to the line list.
- *  initial_size: initial list size.
+ *  parser: pointer to the parser state.
+ *  req: pointer to the HTTPRequest struct.
+ *  data: raw request bytes, may have moved since the previous call.
+ *  size: number of bytes received so far.
  *
- *  returns: if failed (-1), on success (1).
+ *  returns: if malformed (-1), incomplete (0), header complete (1).
  */
-int init_lines(LineArray* line_arr, size_t initial_size);
+int parse_header(HTTPParser* parser, HTTPRequest* req, char* data, size_t size);
 
 /*
- * Function: insert_line
+ * Function: http_req_method
  *
- * ---------------------
+ * -------------------------
  *
- *  Adds line to the list.
+ *  Returns the request method.
  *
- *  line_arr: pointer to the list.
- *  data: line data.
- *  size: line lenght.
+ *  req: pointer to the parsed http request.
  *
- *  returns: length of the inserted line.
+ *  returns: method string.
  */
-ssize_t insert_line(LineArray* line_arr, const char* data, size_t size);
+const char* http_req_method(const HTTPRequest* req);
 
 /*
- * Function: free_lines
+ * Function: http_req_path
+ *
+ * -----------------------
  *
- * --------------------
+ *  Returns the request target.
  *
- *  Frees line list.
+ *  req: pointer to the parsed http request.
  *
- *  line_arr: pointer to the line list.
+ *  returns: path string.
  */
-void free_lines(LineArray* line_arr);
+const char* http_req_path(const HTTPRequest* req);
 
 /*
- * Function: print_http_req
+ * Function: http_req_version
  *
- * ------------------------
+ * --------------------------
  *
- *  Prints HTTP request data.
+ *  Returns the protocol version of the request line.
  *
- *  req: pointer to the http request.
+ *  req: pointer to the parsed http request.
+ *
+ *  returns: version string.
  */
-void print_http_req(HTTPRequest* req);
+const char* http_req_version(const HTTPRequest* req);
 
 /*
- * Function: http_req_to_LineArray
+ * Function: http_req_known_header
  *
  * -------------------------------
  *
- *  Converts raw http requests to lines.
+ *  Returns a well-known header from its fixed slot.
  *
- *  req_raw: raw http request.
- *  line_arr: pointer to the line list.
+ *  req: pointer to the parsed http request.
+ *  id: header id.
  *
- *  returns: number of lines.
+ *  returns: field value of its first occurrence. if not sent, NULL.
  */
-size_t http_req_to_LineArray(const char* req_raw, LineArray* line_arr);
+const char* http_req_known_header(const HTTPRequest* req, HTTPHeaderId id);
 
 /*
- * Function: parse_request_line
+ * Function: http_req_header
  *
- * ----------------------------
+ * -------------------------
  *
- *  Parses the first line of the HTTP request.
+ *  Looks up a header field, names are compared case-insensitively. Known
+ *  headers are read from their slot, others are searched for.
  *
- *  req_line: pointer to the string data of the first line.
- *  req_header: pointer to the HTTPRequestHeader struct.
+ *  req: pointer to the parsed http request.
+ *  name: field name.
  *
- *  returns: if failed (-1), on success (1).
+ *  returns: field value of the first match. if not found, NULL.
  */
-int parse_request_line(const char* req_line, HTTPRequestHeader* req_header);
+const char* http_req_header(const HTTPRequest* req, const char* name);
 
 /*
- * Function: parse_header_fields
- *
- * -----------------------------
+ * Function: print_http_req
  *
- *  Parse's HTTP Request headers to a list of key-values.
+ * ------------------------
  *
- *  line_arr: pointer to the line list.
- *  header_fields: pointer to the header fields list.
+ *  Prints HTTP request data.
  *
- *  returns: number of header fields. if failed (-1).
+ *  req: pointer to the http request.
  */
-int parse_header_fields(const LineArray* line_arr, List* header_fields);
+void print_http_req(HTTPRequest* req);
 
 /*
- * Function: parse_header
+ * Function: http_req_keep_alive
  *
- * ----------------------
+ * -----------------------------
  *
- *  Parses raw http request headers.
+ *  Checks whether the client wants a persistent connection. HTTP/1.1
+ *  connections persist unless "Connection: close" is sent, HTTP/1.0 ones
+ *  only with "Connection: keep-alive".
  *
- *  req: pointer to the HTTPRequest struct.
- *  req_data: pointer to the raw request data.
+ *  req: pointer to the parsed http request.
  *
- *  returns: if failed (-1), on success (1). 
+ *  returns: persistent (1), close after the response (0).
  */
-int parse_header(HTTPRequest* req, const char* req_data);
+int http_req_keep_alive(HTTPRequest* req);
 
 /*
  * Function: free_http_req
  *
  * -----------------------
  *
- *  Frees HTTP Request struct.
+ *  Frees HTTP Request struct and forgets its parsed views.
  *
  *  req: pointer to the http request struct.
  */
 void free_http_req(HTTPRequest* req);
 
+/*
+ * Function: http_response_header_to_string
+ *
+ * ----------------------------------------
+ *
+ *  Stringifies the status line and header fields, up to and including
+ *  the empty line.
+ *
+ *  res_header: pointer to the http response header struct.
+ *  res_string: pointer to the string buffer.
+ *
+ *  returns: size of response string. if failed (-1).
+ */
+ssize_t http_response_header_to_string(HTTPResponseHeader* res_header, StringBuffer* res_string);
+
 /*
  * Function: http_response_to_string
  *
  * ---------------------------------
  *
- *  Stringifies the HTTP Response struct.
+ *  Stringifies the HTTP Response struct. Without a Content-Length field
+ *  the body is taken as a string, written as one chunk when the header
+ *  has Transfer-Encoding: chunked.
  *
  *  res: pointer to the http response struct.
  *  res_string: pointer to the string buffer.
@@ -176,7 +264,7 @@ ssize_t http_response_to_string(HTTPResponse* res, StringBuffer* res_string);
  *
  * ----------------------------
  *
- *  Generates date string.
+ *  Generates the Date header line, CRLF included.
  *
  *  timer: pointer to the current time.
  *  date_string: pointer to the date string.
@@ -184,4 +272,19 @@ ssize_t http_response_to_string(HTTPResponse* res, StringBuffer* res_string);
  *  returns: date string length.
  */
 size_t generate_http_date(const time_t* timer, char* date_string);
+
+/*
+ * Function: update_date_cache
+ *
+ * ---------------------------
+ *
+ *  Reformats the cached Date line if the second has changed since the
+ *  last update.
+ *
+ *  cache: pointer to the date cache.
+ *  now: current time.
+ *
+ *  returns: if failed (-1), still current (0), reformatted (1).
+ */
+int update_date_cache(DateCache* cache, time_t now);
 #endif
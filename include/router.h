@@ -4,23 +4,38 @@
 #include "linked_list.h"
 #include "hash.h"
 
+#define STREAMED_BODY_SIZE ((ssize_t) -1) // body length of chunked and close delimited responses
+#define UPLOAD_MAX_BODY_SIZE (64 * 1024 * 1024) // POST /upload and /echo take more than the server's default
+
 typedef struct route {
     char* path;
     char method[8];
-    void (*handler)(int* client_fd, HTTPRequest* req);
+    void (*handler)(ResponseWriter* writer, HTTPRequest* req);
+    size_t max_body_size; // request body limit, 0 uses the server's
 } Route;
 
-ssize_t load_page(unsigned char** body, const char* page_path);
+ssize_t load_page(Arena* arena, unsigned char** body, const char* page_path);
 char* get_content_type(const char* extension);
-int send_response(int* client_fd, HTTPResponseHeader* res_header, unsigned char* body, 
+int send_response(ResponseWriter* writer, HTTPResponseHeader* res_header, unsigned char* body, 
                   size_t body_size, const char* content_type);
+int send_buffer_response(ResponseWriter* writer, HTTPResponseHeader* res_header, unsigned char* body,
+                         size_t body_size, const char* content_type);
+int send_file_response(ResponseWriter* writer, HTTPResponseHeader* res_header, int fd, size_t offset,
+                       size_t length, const char* content_type);
+int send_chunked_response(ResponseWriter* writer, HTTPResponseHeader* res_header, const char* content_type);
+int send_chunk(ResponseWriter* writer, const void* data, size_t size);
+int end_chunked_response(ResponseWriter* writer);
 int setup_routes(List* route_list, Route routes[], size_t route_count);
-int router(List* route_list, HTTPRequest* req, int* client_fd, HashTable* file_table);
-void generic_route_handler(int* client_fd, HTTPRequest* req, const char* page_path, 
+Route* match_route(List* route_list, HTTPRequest* req);
+int router(List* route_list, HTTPRequest* req, ResponseWriter* writer, HashTable* file_table);
+void generic_route_handler(ResponseWriter* writer, HTTPRequest* req, const char* page_path, 
                            int status_code, const char* status_desc);
-void home_route_handler(int* client_fd, HTTPRequest* req);
-void posts_route_handler(int* client_fd, HTTPRequest* req);
-void not_found_route_handler(int* client_fd, HTTPRequest* req);
-int undefined_route_handler(int* client_fd, HTTPRequest* req, HashTable* file_table);
-char* generate_route_key(const char* method, const char* path);
+void home_route_handler(ResponseWriter* writer, HTTPRequest* req);
+void posts_route_handler(ResponseWriter* writer, HTTPRequest* req);
+void not_found_route_handler(ResponseWriter* writer, HTTPRequest* req);
+void server_status_route_handler(ResponseWriter* writer, HTTPRequest* req);
+void upload_route_handler(ResponseWriter* writer, HTTPRequest* req);
+void echo_route_handler(ResponseWriter* writer, HTTPRequest* req);
+int undefined_route_handler(ResponseWriter* writer, HTTPRequest* req, HashTable* file_table);
+char* generate_route_key(Arena* arena, const char* method, const char* path);
 #endif
@@ -0,0 +1,105 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdio.h>
+
+// Instruction sets the delimiter scanners can use, best last.
+typedef enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+} ScanLevel;
+
+/*
+ * Function: init_scanner
+ *
+ * ----------------------
+ *
+ *  Selects the widest scanner the CPU supports. Until it is called the
+ *  scalar scanner is used.
+ */
+void init_scanner(void);
+
+/*
+ * Function: set_scan_level
+ *
+ * ------------------------
+ *
+ *  Forces a scanner, for benchmarks and comparisons.
+ *
+ *  level: instruction set to use.
+ *
+ *  returns: if not supported by this CPU (-1), on success (1).
+ */
+int set_scan_level(ScanLevel level);
+
+/*
+ * Function: get_scan_level
+ *
+ * ------------------------
+ *
+ *  Returns the scanner in use.
+ *
+ *  returns: current scan level.
+ */
+ScanLevel get_scan_level(void);
+
+/*
+ * Function: scan_level_name
+ *
+ * -------------------------
+ *
+ *  Names a scan level.
+ *
+ *  level: scan level.
+ *
+ *  returns: "scalar", "sse2" or "avx2".
+ */
+const char* scan_level_name(ScanLevel level);
+
+/*
+ * Function: scan_token_end
+ *
+ * ------------------------
+ *
+ *  Finds the first space, control character or DEL, the end of a request
+ *  target or version.
+ *
+ *  data: bytes to scan.
+ *  size: number of bytes.
+ *
+ *  returns: offset of the delimiter. if there is none, size.
+ */
+size_t scan_token_end(const char* data, size_t size);
+
+/*
+ * Function: scan_field_end
+ *
+ * ------------------------
+ *
+ *  Finds the first control character other than HTAB, or DEL. In a field
+ *  value that is the CR or LF ending the line, anything else is invalid.
+ *
+ *  data: bytes to scan.
+ *  size: number of bytes.
+ *
+ *  returns: offset of the delimiter. if there is none, size.
+ */
+size_t scan_field_end(const char* data, size_t size);
+
+/*
+ * Function: scan_name_end
+ *
+ * -----------------------
+ *
+ *  Finds the first byte that is not a tchar, the end of a method or field
+ *  name: the space after a method, the colon after a field name, or an
+ *  invalid byte.
+ *
+ *  data: bytes to scan.
+ *  size: number of bytes.
+ *
+ *  returns: offset of the delimiter. if there is none, size.
+ */
+size_t scan_name_end(const char* data, size_t size);
+#endif
@@ -0,0 +1,134 @@
+#ifndef SLAB_H
+#define SLAB_H
+#include "buffer.h"
+#include "stats.h"
+
+#include <stdio.h>
+
+#define SLAB_OBJECTS 64         // objects carved from one allocation
+#define BUFFER_POOL_MAX_FREE 256 // idle buffers kept, the rest go back to malloc
+
+typedef struct pool_entry {
+    struct pool_entry* next;
+} PoolEntry;
+
+// Fixed size objects carved from larger allocations. Freed objects are
+// handed out again newest first, while they are still in the cache.
+// Only the owning thread may use a pool.
+typedef struct {
+    size_t object_size; // rounded up to the allocation alignment
+    PoolEntry* free;    // LIFO list of available objects
+    PoolEntry* slabs;   // every allocation, released with the pool
+    ServerStats* stats; // hit and miss counters, may be NULL
+} SlabPool;
+
+// Recycled StringBuffers of one capacity. Buffers are malloc'd one by one
+// so their owner may still grow them, grown ones are not taken back.
+typedef struct {
+    size_t buffer_size;
+    PoolEntry* free;    // LIFO list of idle buffers
+    size_t free_count;
+    ServerStats* stats; // hit and miss counters, may be NULL
+} BufferPool;
+
+/*
+ * Function: init_slab_pool
+ *
+ * ------------------------
+ *
+ *  Initializes an empty pool, nothing is allocated before the first use.
+ *
+ *  pool: pointer to the pool.
+ *  object_size: size of one object.
+ *  stats: counters receiving the hits and misses, may be NULL.
+ */
+void init_slab_pool(SlabPool* pool, size_t object_size, ServerStats* stats);
+
+/*
+ * Function: slab_alloc
+ *
+ * --------------------
+ *
+ *  Takes an object from the pool, carving a new slab when it is empty.
+ *  The object is not cleared.
+ *
+ *  pool: pointer to the pool.
+ *
+ *  returns: pointer to the object. if failed, NULL.
+ */
+void* slab_alloc(SlabPool* pool);
+
+/*
+ * Function: slab_free
+ *
+ * -------------------
+ *
+ *  Returns an object taken from the same pool.
+ *
+ *  pool: pointer to the pool.
+ *  object: pointer to the object.
+ */
+void slab_free(SlabPool* pool, void* object);
+
+/*
+ * Function: free_slab_pool
+ *
+ * ------------------------
+ *
+ *  Releases every slab, objects still in use become invalid.
+ *
+ *  pool: pointer to the pool.
+ */
+void free_slab_pool(SlabPool* pool);
+
+/*
+ * Function: init_buffer_pool
+ *
+ * --------------------------
+ *
+ *  Initializes an empty buffer pool.
+ *
+ *  pool: pointer to the pool.
+ *  buffer_size: capacity of the pooled buffers.
+ *  stats: counters receiving the hits and misses, may be NULL.
+ */
+void init_buffer_pool(BufferPool* pool, size_t buffer_size, ServerStats* stats);
+
+/*
+ * Function: buffer_pool_acquire
+ *
+ * -----------------------------
+ *
+ *  Prepares an empty buffer, reusing an idle one when there is any.
+ *
+ *  pool: pointer to the pool.
+ *  buffer: pointer to the StringBuffer to fill in.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int buffer_pool_acquire(BufferPool* pool, StringBuffer* buffer);
+
+/*
+ * Function: buffer_pool_release
+ *
+ * -----------------------------
+ *
+ *  Keeps the buffer for reuse if it still has the pool's capacity and the
+ *  pool is not full, frees it otherwise.
+ *
+ *  pool: pointer to the pool, NULL frees the buffer.
+ *  buffer: pointer to the StringBuffer, emptied.
+ */
+void buffer_pool_release(BufferPool* pool, StringBuffer* buffer);
+
+/*
+ * Function: free_buffer_pool
+ *
+ * --------------------------
+ *
+ *  Frees the idle buffers.
+ *
+ *  pool: pointer to the pool.
+ */
+void free_buffer_pool(BufferPool* pool);
+#endif
@@ -4,55 +4,106 @@
 #include "polls.h"
 #include "hash.h"
 #include "request.h"
+#include "config.h"
+#include "connection.h"
+#include "thread_pool.h"
+#include "mpsc_queue.h"
+#include "stats.h"
+#include "codel.h"
 
 #include <netdb.h>
+#include <pthread.h>
 #include <netinet/in.h>
 
 #define KB (1 << 10) //1024
 #define MAX_REQ_BUFFER_SIZE (sizeof(char) * 4 * KB)
+#define MAX_REQ_HEADER_SIZE (sizeof(char) * 16 * KB)
+#define MIN_RECV_SPACE (sizeof(char) * 1 * KB) // the request buffer grows when less is left
+#define RECV_BUFFER_COUNT 256                     // io_uring receive buffers per worker, a power of two
+#define RECV_BUFFER_SIZE MAX_REQ_BUFFER_SIZE
+#define FILE_CHUNK_SIZE (sizeof(char) * 64 * KB)  // file bytes read ahead of one io_uring send
+#define IO_FINISH_TIMEOUT 1000                    // ms an exiting worker waits for its io_uring requests
 
 typedef struct {
-    char host[INET6_ADDRSTRLEN];
-    char port[6];
-    int socket_fd;
     List* routes;
     HashTable* file_table;
+    const ServerConfig* config;
+    ThreadPool* pool; // route handler executor, NULL runs handlers on the event loop
+    int* listener_fds;     // every open listener while running, inherited ones before, -1 once drained
+    size_t listener_count;
+    pthread_mutex_t listener_lock; // a drain closes listeners while another worker hands them to a successor
 } Server;
 
+// Routes, files and config of the Server are shared read-only between workers.
+typedef struct {
+    size_t id;
+    pthread_t thread;
+    Server* server;
+    int listener_fds[MAX_LISTENERS];   // per configured listener, -1 once closed by a drain, unix ones shared
+    Connection* listeners[MAX_LISTENERS];
+    PollFd pfds;
+    ConnectionList connections;        // client connections
+    TimerWheel timers;                 // idle, header, body and write deadlines of the connections
+    MpscQueue completions;             // handler tasks finished by the pool
+    int notify_fd;                     // eventfd waking the loop for completions and signals
+    atomic_int notified;               // a wakeup is already pending on notify_fd
+    unsigned int accept_pending;       // edge triggered listeners left with a full batch, by index
+    ServerStats stats;
+    CoDel codel;                       // sheds requests that queued too long
+    ConnectionPools pools;             // client connections and their buffers, worker thread only
+    SlabPool tasks;                    // handler tasks, returned once their completion is taken
+    unsigned long long pass_start;     // when the current loop pass began
+    unsigned long long queued_since;   // estimated arrival of the requests found in this pass
+    DateCache date;                    // Date header line, refreshed by the loop once a second
+    int draining;                      // no longer accepting, connections close after their response
+    unsigned long long drain_deadline; // when the remaining connections are dropped
+    int status;
+} Worker;
+
 int free_server(Server* server);
 void* get_server_ip(struct sockaddr* server_addr);
 void* get_server_port(struct sockaddr* server_addr);
 void get_server_address(struct addrinfo* server, char* host, char* port);
-int init_tcp_server_address(struct addrinfo* hints, struct addrinfo** res, const char* service, int address_family);
-int init_socket(struct addrinfo* res, char* host);
-int start_server(Server* server, int queue_size);
-int process_connections(PollFd* pfds, Server* server);
+int set_nonblocking(int fd);
+int init_tcp_server_address(struct addrinfo* hints, struct addrinfo** res, const char* host,
+                            const char* service, int address_family);
+int init_socket(struct addrinfo* res, int reuse_port, int v6only, const SocketOptions* options);
+int init_unix_socket(const char* path);
+int start_server(Server* server);
+int process_connections(Worker* worker);
 
 /*
  * Function: handle_new_connection
  *
  * -------------------------------
  *
- *  Handles new coming connection and adds it to the list.
+ *  Accepts pending connections until the backlog is empty or the
+ *  listener's batch is reached, and adds them to the list. An edge
+ *  triggered listener stopped by the batch limit is resumed on the next
+ *  loop iteration. Clients over the worker's share of the connection
+ *  limit get a 503 and are closed right away.
  *
- *  pfds: pointer to the poll list.
- *  listener_fd: listener socket file descriptor.
+ *  worker: pointer to the worker polling the listener.
+ *  listener: listener connection.
  *
- *  returns: if failed (-1), on success (1).
+ *  returns: number of accepted connections. if failed (-1).
  */
-int handle_new_connection(PollFd* pfds, int listener_fd);
+int handle_new_connection(Worker* worker, Connection* listener);
 
 /*
  * Function: handle_client_data
  *
  * ----------------------------
  *
- *  receives client's request data.
+ *  Receives whatever the client has sent so far without blocking and
+ *  advances the connection's request state after every read, so a body
+ *  never piles up in the request buffer. A peer shutdown is recorded in
+ *  conn->read_closed.
  *
- *  client_fd: client's file descriptor.
- *  req: pointer to a empty initiated http request.
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
  *
- *  returns: received bytes. if failed (-1).
+ *  returns: if failed or closed (-1), incomplete request (0), complete request (1).
  */
-ssize_t handle_client_data(int client_fd, HTTPRequest* req);
+ssize_t handle_client_data(Worker* worker, Connection* conn);
 #endif
@@ -0,0 +1,57 @@
+#ifndef SOCKET_OPTIONS_H
+#define SOCKET_OPTIONS_H
+
+#include <stdio.h>
+
+// Tunables applied to listeners and accepted sockets, 0 keeps the kernel default.
+typedef struct {
+    int nodelay;      // TCP_NODELAY on accepted sockets, partial responses are not held back
+    int quickack;     // TCP_QUICKACK on accepted sockets, the first request is acked at once
+    int defer_accept; // TCP_DEFER_ACCEPT seconds, connections are reported once they sent data
+    int fastopen;     // TCP_FASTOPEN queue length, SYN data is delivered with the connection
+    int rcvbuf;       // SO_RCVBUF bytes, set on the listener so accepted sockets inherit it
+    int sndbuf;       // SO_SNDBUF bytes, set on the listener so accepted sockets inherit it
+    int busy_poll;    // SO_BUSY_POLL microseconds spent polling the device on reads
+} SocketOptions;
+
+/*
+ * Function: init_socket_options
+ *
+ * -----------------------------
+ *
+ *  Leaves every option at the kernel default.
+ *
+ *  options: pointer to the socket options.
+ */
+void init_socket_options(SocketOptions* options);
+
+/*
+ * Function: apply_listener_options
+ *
+ * --------------------------------
+ *
+ *  Sets the listener side options. Failures are reported but the
+ *  remaining options are still applied.
+ *
+ *  socket_fd: listener socket file descriptor.
+ *  options: pointer to the socket options.
+ *
+ *  returns: if any option failed (-1), on success (1).
+ */
+int apply_listener_options(int socket_fd, const SocketOptions* options);
+
+/*
+ * Function: apply_client_options
+ *
+ * ------------------------------
+ *
+ *  Sets the per connection options on an accepted socket. Failures are
+ *  not reported, the connection works without them.
+ *
+ *  socket_fd: accepted socket file descriptor.
+ *  options: pointer to the socket options.
+ *
+ *  returns: if any option failed (-1), on success (1).
+ */
+int apply_client_options(int socket_fd, const SocketOptions* options);
+#endif
@@ -0,0 +1,90 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Counters of one worker. They are atomic because the worker's handler
+// tasks update them from the pool threads too (shed_requests). Readers sum
+// every registered block.
+typedef struct server_stats {
+    atomic_ullong accepted;          // client connections accepted
+    atomic_ullong accept_wakeups;    // listener readiness events handled
+    atomic_ullong accept_batch_full; // wakeups that stopped at the accept batch limit
+    atomic_ullong accept_errors;     // accept failures other than EAGAIN
+    atomic_ullong timeouts_idle;     // keep-alive connections closed while idle
+    atomic_ullong timeouts_header;   // connections closed before sending their headers
+    atomic_ullong timeouts_body;     // connections closed while a body stalled
+    atomic_ullong timeouts_write;    // connections closed while a response stalled
+    atomic_ullong shed_connections;  // clients turned away over the connection limit
+    atomic_ullong shed_requests;     // requests answered with a 503 after queueing too long
+    atomic_ullong pool_hits;         // connections, tasks and buffers reused from a worker pool
+    atomic_ullong pool_misses;       // pool requests that had to go to malloc
+    atomic_ullong bodies_rejected;   // requests answered with a 413 before their body was read
+    atomic_ullong bodies_spilled;    // request bodies written to a temp file
+    struct server_stats* next;       // registry link
+} ServerStats;
+
+#define STATS_ADD(stats, field, value) \
+    atomic_fetch_add_explicit(&(stats)->field, (value), memory_order_relaxed)
+#define STATS_GET(stats, field) \
+    atomic_load_explicit(&(stats)->field, memory_order_relaxed)
+
+/*
+ * Function: stats_register
+ *
+ * ------------------------
+ *
+ *  Clears the counters and adds them to the process wide registry.
+ *
+ *  stats: pointer to the counters.
+ */
+void stats_register(ServerStats* stats);
+
+/*
+ * Function: stats_unregister
+ *
+ * --------------------------
+ *
+ *  Removes the counters from the registry. Their values are kept in the
+ *  registry totals.
+ *
+ *  stats: pointer to the counters.
+ */
+void stats_unregister(ServerStats* stats);
+
+/*
+ * Function: stats_collect
+ *
+ * -----------------------
+ *
+ *  Sums every registered block.
+ *
+ *  total: pointer to the counters receiving the sum.
+ */
+void stats_collect(ServerStats* total);
+
+/*
+ * Function: stats_uptime_ms
+ *
+ * -------------------------
+ *
+ *  returns: milliseconds since the first block was registered.
+ */
+unsigned long long stats_uptime_ms(void);
+
+/*
+ * Function: read_listen_overflows
+ *
+ * -------------------------------
+ *
+ *  Reads the kernel's TcpExt ListenOverflows and ListenDrops counters.
+ *  They cover every listener of the network namespace.
+ *
+ *  overflows: accept queue overflows.
+ *  drops: SYNs dropped on listeners, overflows included.
+ *
+ *  returns: if failed or not available (-1), on success (1).
+ */
+int read_listen_overflows(unsigned long long* overflows, unsigned long long* drops);
+#endif
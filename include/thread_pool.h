@@ -0,0 +1,81 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define TASK_DEQUE_INITIAL_SIZE 64
+
+typedef void (*TaskFunction)(void* arg);
+
+typedef struct {
+    TaskFunction run;
+    void* arg;
+} Task;
+
+struct thread_pool;
+
+// Owner pops the newest task, thieves take the oldest one.
+typedef struct {
+    struct thread_pool* pool; // owning pool, for the thread running this deque
+    pthread_mutex_t lock;
+    Task* tasks; // ring buffer
+    size_t head; // oldest task
+    size_t size;
+    size_t max_size;
+} TaskDeque;
+
+typedef struct thread_pool {
+    size_t size;    // number of threads, one deque each
+    size_t running; // started threads
+    pthread_t* threads;
+    TaskDeque* deques;
+    atomic_size_t next_deque; // round robin target for submissions
+    atomic_size_t pending;    // queued tasks over all deques
+    atomic_size_t sleeping;   // threads waiting for work
+    atomic_int stopping;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+} ThreadPool;
+
+/*
+ * Function: init_thread_pool
+ *
+ * --------------------------
+ *
+ *  Starts a work-stealing thread pool.
+ *
+ *  pool: pointer to the thread pool.
+ *  thread_count: number of threads.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int init_thread_pool(ThreadPool* pool, size_t thread_count);
+
+/*
+ * Function: thread_pool_submit
+ *
+ * ----------------------------
+ *
+ *  Queues a task on one of the pool's deques and wakes an idle thread.
+ *
+ *  pool: pointer to the thread pool.
+ *  run: task function.
+ *  arg: argument passed to the task function.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int thread_pool_submit(ThreadPool* pool, TaskFunction run, void* arg);
+
+/*
+ * Function: free_thread_pool
+ *
+ * --------------------------
+ *
+ *  Runs the queued tasks, stops and joins the threads and frees the pool.
+ *
+ *  pool: pointer to the thread pool.
+ */
+void free_thread_pool(ThreadPool* pool);
+#endif
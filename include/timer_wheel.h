@@ -0,0 +1,113 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4 // 1 ms ticks, 64^4 ms (~4.6 hours) of range
+
+// Intrusive timer, embedded in the object it belongs to.
+typedef struct timer {
+    unsigned long long expires; // tick (monotonic ms) it fires at
+    void* data;                 // owner of the timer
+    int kind;                   // owner defined
+    int active;
+    unsigned char level;
+    unsigned char slot;
+    struct timer* next;
+    struct timer** pprev;
+} Timer;
+
+// Level L slot S holds timers whose expiry is 64^L ticks apart at most;
+// they are moved down a level when the wheel reaches them.
+typedef struct {
+    unsigned long long now; // next tick to process
+    size_t count;
+    uint64_t occupied[TIMER_WHEEL_LEVELS]; // bitmap of non-empty slots
+    Timer* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+/*
+ * Function: init_timer_wheel
+ *
+ * --------------------------
+ *
+ *  Initializes an empty wheel.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  now: current monotonic time in milliseconds.
+ */
+void init_timer_wheel(TimerWheel* wheel, unsigned long long now);
+
+/*
+ * Function: init_timer
+ *
+ * --------------------
+ *
+ *  Initializes an inactive timer.
+ *
+ *  timer: pointer to the timer.
+ *  data: owner of the timer.
+ */
+void init_timer(Timer* timer, void* data);
+
+/*
+ * Function: timer_wheel_add
+ *
+ * -------------------------
+ *
+ *  Schedules the timer, moving it if it is already scheduled. Expiries in
+ *  the past fire on the next advance.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  timer: pointer to the timer.
+ *  expires: monotonic time in milliseconds.
+ */
+void timer_wheel_add(TimerWheel* wheel, Timer* timer, unsigned long long expires);
+
+/*
+ * Function: timer_wheel_remove
+ *
+ * ----------------------------
+ *
+ *  Cancels the timer. Inactive timers are ignored.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  timer: pointer to the timer.
+ */
+void timer_wheel_remove(TimerWheel* wheel, Timer* timer);
+
+/*
+ * Function: timer_wheel_advance
+ *
+ * -----------------------------
+ *
+ *  Moves the wheel up to now and detaches every expired timer.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  now: current monotonic time in milliseconds.
+ *  expired: receives the expired timers, linked through next.
+ *
+ *  returns: number of expired timers.
+ */
+size_t timer_wheel_advance(TimerWheel* wheel, unsigned long long now, Timer** expired);
+
+/*
+ * Function: timer_wheel_timeout
+ *
+ * -----------------------------
+ *
+ *  Computes how long the event loop may wait. Timers on the upper levels
+ *  wake the loop when they have to move down, which may be earlier than
+ *  their expiry.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  now: current monotonic time in milliseconds.
+ *
+ *  returns: milliseconds to wait, (-1) if no timer is scheduled.
+ */
+int timer_wheel_timeout(TimerWheel* wheel, unsigned long long now);
+#endif
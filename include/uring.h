@@ -0,0 +1,204 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdio.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+
+#define URING_SQ_ENTRIES 256
+#define URING_CQ_ENTRIES 4096
+
+// Submission and completion rings shared with the kernel, see io_uring(7).
+typedef struct uring {
+    int ring_fd;
+    unsigned features;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_pending; // sqes filled since the last submission
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} Uring;
+
+// Receive buffers the kernel picks from as data arrives, see io_uring_register_buf_ring(3).
+typedef struct uring_buffers {
+    struct io_uring_buf_ring* ring; // entries shared with the kernel, the tail among them
+    char* memory;                   // count buffers of size bytes
+    unsigned short group;           // buffer group named by the receive requests
+    unsigned short tail;            // next entry to hand back
+    unsigned count;                 // power of two
+    size_t size;
+} UringBuffers;
+
+/*
+ * Function: init_uring
+ *
+ * --------------------
+ *
+ *  Creates an io_uring instance and maps its rings.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: if failed or not supported (-1), on success (1).
+ */
+int init_uring(Uring* ring);
+
+/*
+ * Function: uring_get_sqe
+ *
+ * -----------------------
+ *
+ *  Returns a cleared submission entry, submitting the queued ones first
+ *  if the ring is full.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: pointer to the entry. if failed, NULL.
+ */
+struct io_uring_sqe* uring_get_sqe(Uring* ring);
+
+/*
+ * Function: uring_reserve
+ *
+ * -----------------------
+ *
+ *  Makes room for count submission entries, submitting the queued ones if
+ *  the ring has less, so linked entries go to the kernel together.
+ *
+ *  ring: pointer to the ring.
+ *  count: number of entries needed.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int uring_reserve(Uring* ring, unsigned count);
+
+/*
+ * Function: uring_submit
+ *
+ * ----------------------
+ *
+ *  Submits the queued entries without waiting for completions.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int uring_submit(Uring* ring);
+
+/*
+ * Function: uring_submit_and_wait
+ *
+ * -------------------------------
+ *
+ *  Submits the queued entries and waits for at least one completion with
+ *  a single io_uring_enter call.
+ *
+ *  ring: pointer to the ring.
+ *  timeout: timeout in milliseconds, (-1) waits forever.
+ *
+ *  returns: if failed (-1), timed out (0), on success (1).
+ */
+int uring_submit_and_wait(Uring* ring, int timeout);
+
+/*
+ * Function: uring_peek_cqe
+ *
+ * ------------------------
+ *
+ *  Returns the oldest unseen completion without waiting.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: pointer to the completion. NULL if none is ready.
+ */
+struct io_uring_cqe* uring_peek_cqe(Uring* ring);
+
+/*
+ * Function: uring_cqe_seen
+ *
+ * ------------------------
+ *
+ *  Hands the completion returned by uring_peek_cqe back to the kernel.
+ *
+ *  ring: pointer to the ring.
+ */
+void uring_cqe_seen(Uring* ring);
+
+/*
+ * Function: init_uring_buffers
+ *
+ * ----------------------------
+ *
+ *  Allocates receive buffers and registers them with the ring as a buffer
+ *  group. Needs Linux 5.19.
+ *
+ *  ring: pointer to the ring.
+ *  buffers: pointer to the buffers.
+ *  group: buffer group id.
+ *  count: number of buffers, a power of two.
+ *  size: bytes per buffer.
+ *
+ *  returns: if failed or not supported (-1), on success (1).
+ */
+int init_uring_buffers(Uring* ring, UringBuffers* buffers, unsigned short group, unsigned count, size_t size);
+
+/*
+ * Function: uring_buffer
+ *
+ * ----------------------
+ *
+ *  Returns the buffer the kernel picked for a completion.
+ *
+ *  buffers: pointer to the buffers.
+ *  id: buffer id from the completion's flags.
+ *
+ *  returns: pointer to the buffer's data.
+ */
+char* uring_buffer(UringBuffers* buffers, unsigned short id);
+
+/*
+ * Function: uring_buffer_release
+ *
+ * ------------------------------
+ *
+ *  Hands a buffer back to the kernel once its data has been taken.
+ *
+ *  buffers: pointer to the buffers.
+ *  id: buffer id from the completion's flags.
+ */
+void uring_buffer_release(UringBuffers* buffers, unsigned short id);
+
+/*
+ * Function: free_uring_buffers
+ *
+ * ----------------------------
+ *
+ *  Unregisters the buffer group and frees its buffers.
+ *
+ *  ring: pointer to the ring, NULL if it is already closed.
+ *  buffers: pointer to the buffers.
+ */
+void free_uring_buffers(Uring* ring, UringBuffers* buffers);
+
+/*
+ * Function: free_uring
+ *
+ * --------------------
+ *
+ *  Unmaps the rings and closes the instance.
+ *
+ *  ring: pointer to the ring.
+ */
+void free_uring(Uring* ring);
+#endif
+#endif
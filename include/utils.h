@@ -60,4 +60,13 @@ size_t get_file_size(FILE* file);
 *  returns: Number of read characters. If failed, (-1).
 */
 ssize_t get_line(char **line_ptr, size_t *size, FILE *stream);
+
+/*
+* Function monotonic_ms
+* ---------------------
+*  Returns a monotonic timestamp, unaffected by wall clock changes.
+*
+*  returns: Milliseconds since an unspecified starting point.
+*/
+unsigned long long monotonic_ms(void);
 #endif
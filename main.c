@@ -3,6 +3,9 @@
 #include "include/hash.h"
 #include "include/router.h"
 #include "include/file_manager.h"
+#include "include/config.h"
+#include "include/lifecycle.h"
+#include "include/scan.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,34 +13,35 @@
 #include <unistd.h>
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        printf("USAGE: %s [port]\n", argv[0]);
+    ServerConfig config;
+    init_server_config(&config);
+    if (parse_server_config(argc, argv, &config) == -1) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    Server server = {{0}, {0}, -1, NULL, NULL};
-    strncpy(server.port, argv[1], 6);
-    struct addrinfo hints;
-    struct addrinfo* res;
-    int result = -1;
-    if ((result = init_tcp_server_address(&hints, &res, server.port, AF_INET)) != 0) {
-        exit(1);
-    }
-
-    if ((server.socket_fd = init_socket(res, server.host)) == -1) {
-        exit(1);
-    }
+    init_scanner();
+    Server server = {NULL, NULL, &config, NULL, NULL, 0, PTHREAD_MUTEX_INITIALIZER};
 
+    // started by a reload, the predecessor's listeners are taken over as they are
+    size_t inherited_count = 0;
+    int* inherited = inherited_listeners(&inherited_count);
+    server.listener_fds = inherited;
+    server.listener_count = inherited_count;
+    int result = -1;
 
-    List routes = {0, NULL};
+    List routes = {0, NULL, NULL};
     Route route_arr[] = {
-        {"/", "GET", home_route_handler},
-        {"/posts", "GET", posts_route_handler},
+        {"/", "GET", home_route_handler, 0},
+        {"/posts", "GET", posts_route_handler, 0},
+        {"/server-status", "GET", server_status_route_handler, 0},
+        {"/upload", "POST", upload_route_handler, UPLOAD_MAX_BODY_SIZE},
+        {"/echo", "POST", echo_route_handler, UPLOAD_MAX_BODY_SIZE},
     };
     size_t route_count = sizeof(route_arr) / sizeof(route_arr[0]);
     result = setup_routes(&routes, route_arr, route_count);
     if (result < (int) route_count) {
-        close(server.socket_fd);
+        free(inherited);
         exit(1);
     }
     server.routes = &routes;
@@ -45,28 +49,28 @@ int main(int argc, char** argv) {
     FileTable file_table;
     result = init_hash_table(&file_table, FILE_TABLE_SIZE);
     if (result == -1) {
-        close(server.socket_fd);
+        free(inherited);
         free_list(&routes);
         exit(1);
     }
 
     result = load_files(DEFAULT_SERVER_PATH, &file_table);
     if (result == -1) {
-        close(server.socket_fd);
+        free(inherited);
         free_file_table(&file_table);
         free_list(&routes);
         exit(1);
     }
     server.file_table = &file_table;
 
-    if ((result = start_server(&server, 128)) == -1) {
-        close(server.socket_fd);
+    if ((result = start_server(&server)) == -1) {
+        free(inherited);
         free_file_table(&file_table);
         free_list(&routes);
         exit(1);
     }
 
-    close(server.socket_fd);
+    free(inherited);
     free_file_table(&file_table);
     free_list(&routes);
     return 0;
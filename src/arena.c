@@ -0,0 +1,144 @@
+#include "../include/arena.h"
+#include "../include/utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+
+// bytes to skip so the next allocation is aligned, the block itself may not be
+static size_t arena_padding(const Arena* arena) {
+    uintptr_t next = (uintptr_t) (arena->data + arena->used);
+    return (ARENA_ALIGN - next % ARENA_ALIGN) % ARENA_ALIGN;
+}
+
+/*
+ * Function: init_arena
+ *
+ * --------------------
+ *
+ *  Initializes an empty arena carving the given block first.
+ *
+ *  arena: pointer to the arena.
+ *  initial: block owned by the caller, may be NULL.
+ *  initial_size: size of the block.
+ */
+void init_arena(Arena* arena, char* initial, size_t initial_size) {
+    arena->initial = initial;
+    arena->initial_size = initial ? initial_size : 0;
+    arena->data = arena->initial;
+    arena->size = arena->initial_size;
+    arena->used = 0;
+    arena->blocks = NULL;
+    arena->allocations = 0;
+    arena->heap_blocks = 0;
+}
+
+/*
+ * Function: arena_alloc
+ *
+ * ---------------------
+ *
+ *  Allocates aligned memory valid until the next reset.
+ *
+ *  arena: pointer to the arena.
+ *  size: number of bytes.
+ *
+ *  returns: pointer to the memory. if failed, NULL.
+ */
+void* arena_alloc(Arena* arena, size_t size) {
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    size_t padding = arena->data ? arena_padding(arena) : 0;
+    if (arena->data == NULL || arena->size - arena->used < size + padding) {
+        // the rest of the current block is given up, large requests get a block of their own
+        size_t header_size = ARENA_ROUND(sizeof(ArenaBlock));
+        size_t block_size = size + header_size > ARENA_BLOCK_SIZE ? size + header_size : ARENA_BLOCK_SIZE;
+        ArenaBlock* block = malloc(block_size);
+        if (block == NULL) {
+            err("arena_alloc", "Unable to allocate memory for arena block!");
+            return NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->heap_blocks++;
+        arena->data = (char*) block + header_size;
+        arena->size = block_size - header_size;
+        arena->used = 0;
+        padding = 0;
+    }
+
+    void* memory = arena->data + arena->used + padding;
+    arena->used += padding + size;
+    arena->allocations++;
+    return memory;
+}
+
+/*
+ * Function: arena_strdup
+ *
+ * ----------------------
+ *
+ *  Copies a string into the arena.
+ *
+ *  arena: pointer to the arena.
+ *  str: string to copy.
+ *
+ *  returns: pointer to the copy. if failed, NULL.
+ */
+char* arena_strdup(Arena* arena, const char* str) {
+    if (str == NULL) {
+        return NULL;
+    }
+    size_t size = strlen(str) + 1;
+    char* copy = arena_alloc(arena, size);
+    if (copy != NULL) {
+        memcpy(copy, str, size);
+    }
+    return copy;
+}
+
+/*
+ * Function: reset_arena
+ *
+ * ---------------------
+ *
+ *  Releases every allocation at once, keeping the owner's block.
+ *
+ *  arena: pointer to the arena.
+ */
+void reset_arena(Arena* arena) {
+    free_arena(arena);
+    arena->data = arena->initial;
+    arena->size = arena->initial_size;
+    arena->used = 0;
+    arena->allocations = 0;
+    arena->heap_blocks = 0;
+}
+
+/*
+ * Function: free_arena
+ *
+ * --------------------
+ *
+ *  Frees the heap blocks, the owner's block is left to its owner.
+ *
+ *  arena: pointer to the arena.
+ */
+void free_arena(Arena* arena) {
+    ArenaBlock* block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->data = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
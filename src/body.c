@@ -0,0 +1,216 @@
+#define _GNU_SOURCE // O_TMPFILE
+#include "../include/body.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// unlinked from the start where the filesystem allows it, right after creation otherwise
+static int open_spill_file(const char* temp_dir) {
+    int fd = open(temp_dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd != -1) {
+        return fd;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/http-body-XXXXXX", temp_dir);
+    fd = mkostemp(path, O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    unlink(path);
+    return fd;
+}
+
+static int write_spill_file(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+        data += written;
+        size -= written;
+    }
+    return 1;
+}
+
+static int spill_request_body(RequestBody* body) {
+    body->fd = open_spill_file(body->temp_dir);
+    if (body->fd == -1) {
+        err("spill_request_body", "Unable to create a temp file for the request body!");
+        printf("\tdirectory: %s\n", body->temp_dir);
+        return -1;
+    }
+    body->spilled = 1;
+
+    // what was kept so far moves along, the arena memory is left for the reset
+    if (body->size > 0 && write_spill_file(body->fd, body->data, body->size) == -1) {
+        err("spill_request_body", "Unable to write the request body to its temp file!");
+        return -1;
+    }
+    body->data = NULL;
+    body->capacity = 0;
+    return 1;
+}
+
+static int grow_request_body(RequestBody* body, size_t needed) {
+    size_t capacity = body->capacity > 0 ? body->capacity * 2 : BODY_MEMORY_MIN;
+    if (capacity < needed) {
+        capacity = needed;
+    }
+    if (capacity > body->memory_limit) {
+        capacity = body->memory_limit;
+    }
+
+    char* data = arena_alloc(body->arena, capacity);
+    if (data == NULL) {
+        err("grow_request_body", "Unable to allocate memory for the request body!");
+        return -1;
+    }
+    if (body->size > 0) {
+        memcpy(data, body->data, body->size);
+    }
+    body->data = data;
+    body->capacity = capacity;
+    return 1;
+}
+
+/*
+ * Function: init_request_body
+ *
+ * ---------------------------
+ *
+ *  Prepares an empty body. A declared length over the memory limit spills
+ *  right away, one within it is allocated at once.
+ *
+ *  body: pointer to the body.
+ *  arena: request arena for the in-memory part.
+ *  expected_size: declared length, 0 if unknown.
+ *  memory_limit: bytes kept in memory at most.
+ *  temp_dir: directory for the spill file.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int init_request_body(RequestBody* body, Arena* arena, size_t expected_size, size_t memory_limit,
+                      const char* temp_dir) {
+    memset(body, 0, sizeof(RequestBody));
+    body->arena = arena;
+    body->memory_limit = arena ? memory_limit : 0;
+    body->temp_dir = temp_dir;
+
+    if (expected_size > body->memory_limit) {
+        return spill_request_body(body);
+    }
+    if (expected_size > 0) {
+        return grow_request_body(body, expected_size);
+    }
+    return 1;
+}
+
+/*
+ * Function: request_body_append
+ *
+ * -----------------------------
+ *
+ *  Stores received body bytes, moving the body to the spill file once it
+ *  outgrows the memory limit.
+ *
+ *  body: pointer to the body.
+ *  data: received bytes.
+ *  size: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int request_body_append(RequestBody* body, const char* data, size_t size) {
+    if (size == 0) {
+        return 1;
+    }
+
+    if (!body->spilled && body->size + size > body->memory_limit && spill_request_body(body) == -1) {
+        return -1;
+    }
+    if (body->spilled) {
+        if (write_spill_file(body->fd, data, size) == -1) {
+            err("request_body_append", "Unable to write the request body to its temp file!");
+            return -1;
+        }
+        body->size += size;
+        return 1;
+    }
+
+    if (body->size + size > body->capacity && grow_request_body(body, body->size + size) == -1) {
+        return -1;
+    }
+    memcpy(body->data + body->size, data, size);
+    body->size += size;
+    return 1;
+}
+
+/*
+ * Function: request_body_read
+ *
+ * ---------------------------
+ *
+ *  Copies the next chunk of the body, continuing where the previous call
+ *  stopped.
+ *
+ *  body: pointer to the body.
+ *  buffer: destination.
+ *  size: space in the destination.
+ *
+ *  returns: bytes copied, 0 at the end of the body. if failed (-1).
+ */
+ssize_t request_body_read(RequestBody* body, char* buffer, size_t size) {
+    if (body == NULL || buffer == NULL) {
+        return -1;
+    }
+
+    size_t left = body->size - body->read_offset;
+    if (size > left) {
+        size = left;
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    if (!body->spilled) {
+        memcpy(buffer, body->data + body->read_offset, size);
+        body->read_offset += size;
+        return size;
+    }
+
+    ssize_t read_bytes;
+    do {
+        read_bytes = pread(body->fd, buffer, size, body->read_offset);
+    } while (read_bytes == -1 && errno == EINTR);
+    if (read_bytes <= 0) {
+        err("request_body_read", "Unable to read the request body from its temp file!");
+        return -1;
+    }
+    body->read_offset += read_bytes;
+    return read_bytes;
+}
+
+/*
+ * Function: free_request_body
+ *
+ * ---------------------------
+ *
+ *  Closes the spill file and forgets the body, its memory goes with the
+ *  arena.
+ *
+ *  body: pointer to the body.
+ */
+void free_request_body(RequestBody* body) {
+    if (body->spilled && body->fd != -1) {
+        close(body->fd);
+    }
+    memset(body, 0, sizeof(RequestBody));
+}
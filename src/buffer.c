@@ -54,22 +54,45 @@ ssize_t write_to_string_buffer(StringBuffer* buffer, const char* str, size_t str
         return -1;
     }
 
-    // size_t str_size = strlen(str);
+    if (reserve_string_buffer(buffer, str_size) == -1) {
+        return -1;
+    }
+
+    // data may be binary, keep it NUL terminated for string helpers only
+    memcpy(buffer->data + buffer->size, str, str_size);
+    buffer->size += str_size;
+    buffer->data[buffer->size] = '\0';
+    return str_size;
+}
 
-    if (buffer->size + str_size >= buffer->max_size) {
-        size_t new_size = buffer->size + buffer->max_size + str_size + 1;
-        buffer->data = (char*) realloc(buffer->data, new_size * sizeof(char));
-        if (buffer->data == NULL) {
+/*
+* Function: reserve_string_buffer
+*
+* -------------------------------
+*
+*  Makes sure the buffer can take data_size more bytes (plus a NUL).
+*
+*  buffer: Pointer to the StringBuffer struct.
+*  data_size: Number of bytes that will be appended.
+*
+*  returns: If failed (-1), on success (1).
+*/
+int reserve_string_buffer(StringBuffer* buffer, size_t data_size) {
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    if (buffer->size + data_size >= buffer->max_size) {
+        size_t new_size = buffer->size + buffer->max_size + data_size + 1;
+        char* data = (char*) realloc(buffer->data, new_size * sizeof(char));
+        if (data == NULL) {
             fprintf(stderr, "\n[ERROR]: write_to_buffer() {} -> Unable to reallocate memory for buffer!\n");
             return -1;
         }
+        buffer->data = data;
+        buffer->max_size = new_size;
     }
-
-    // printf("{} %zu %zu %zu\n", buffer->size, buffer->max_size, str_size);
-    strncat(buffer->data, str, str_size);
-
-    buffer->size += str_size;
-    return str_size;
+    return 1;
 }
 
 /*
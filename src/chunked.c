@@ -0,0 +1,156 @@
+#include "../include/chunked.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/*
+ * Function: init_chunked_decoder
+ *
+ * ------------------------------
+ *
+ *  Prepares the decoder for a new body.
+ *
+ *  decoder: pointer to the decoder.
+ */
+void init_chunked_decoder(ChunkedDecoder* decoder) {
+    memset(decoder, 0, sizeof(ChunkedDecoder));
+    decoder->state = CHUNKED_SIZE;
+}
+
+/*
+ * Function: chunked_decode
+ *
+ * ------------------------
+ *
+ *  Decodes the received bytes in place, the chunk data is moved to the
+ *  front of the buffer. Stops after the last chunk and its trailer, what
+ *  follows belongs to the next request.
+ *
+ *  decoder: pointer to the decoder.
+ *  data: received bytes, overwritten with the decoded ones.
+ *  size: number of received bytes.
+ *  consumed: set to the number of received bytes used up.
+ *
+ *  returns: number of decoded bytes at the front of data. if malformed (-1).
+ */
+ssize_t chunked_decode(ChunkedDecoder* decoder, char* data, size_t size, size_t* consumed) {
+    size_t decoded = 0;
+    size_t i = 0;
+
+    // line endings are CRLF only, a bare LF is read differently by some hops
+    while (i < size && decoder->state != CHUNKED_DONE) {
+        char c = data[i];
+        switch (decoder->state) {
+        case CHUNKED_SIZE: {
+            int value = hex_value(c);
+            if (value != -1) {
+                if (decoder->chunk_size > (SIZE_MAX >> 4)) {
+                    return -1;
+                }
+                decoder->chunk_size = (decoder->chunk_size << 4) | value;
+                decoder->digits++;
+            } else if (decoder->digits == 0) {
+                return -1;
+            } else if (c == ';' || c == ' ' || c == '\t') {
+                decoder->state = CHUNKED_EXTENSION;
+            } else if (c == '\r') {
+                decoder->state = CHUNKED_SIZE_LF;
+            } else {
+                return -1;
+            }
+            break;
+        }
+        case CHUNKED_EXTENSION:
+            if (c == '\r') {
+                decoder->state = CHUNKED_SIZE_LF;
+            } else if (c == '\n') {
+                return -1;
+            }
+            break;
+        case CHUNKED_SIZE_LF:
+            if (c != '\n') {
+                return -1;
+            }
+            decoder->state = decoder->chunk_size == 0 ? CHUNKED_TRAILER : CHUNKED_DATA;
+            decoder->line_size = 0;
+            break;
+        case CHUNKED_DATA: {
+            // the whole run at once, only the chunk data is moved
+            size_t run = size - i < decoder->chunk_size ? size - i : decoder->chunk_size;
+            if (decoded != i) {
+                memmove(data + decoded, data + i, run);
+            }
+            decoded += run;
+            decoder->chunk_size -= run;
+            if (decoder->chunk_size == 0) {
+                decoder->state = CHUNKED_DATA_CR;
+            }
+            i += run;
+            continue;
+        }
+        case CHUNKED_DATA_CR:
+            if (c != '\r') {
+                return -1;
+            }
+            decoder->state = CHUNKED_DATA_LF;
+            break;
+        case CHUNKED_DATA_LF:
+            if (c != '\n') {
+                return -1;
+            }
+            decoder->state = CHUNKED_SIZE;
+            decoder->digits = 0;
+            break;
+        case CHUNKED_TRAILER:
+            // trailer fields are not used, only their size is checked
+            if (c == '\r') {
+                decoder->state = CHUNKED_TRAILER_LF;
+            } else if (c == '\n' || ++decoder->trailer_size > CHUNKED_TRAILER_MAX) {
+                return -1;
+            } else {
+                decoder->line_size++;
+            }
+            break;
+        case CHUNKED_TRAILER_LF:
+            if (c != '\n') {
+                return -1;
+            }
+            decoder->state = decoder->line_size == 0 ? CHUNKED_DONE : CHUNKED_TRAILER;
+            decoder->line_size = 0;
+            break;
+        case CHUNKED_DONE:
+            break;
+        }
+
+        if ((decoder->state == CHUNKED_SIZE || decoder->state == CHUNKED_EXTENSION) &&
+            ++decoder->line_size > CHUNKED_LINE_MAX) {
+            return -1;
+        }
+        i++;
+    }
+
+    *consumed = i;
+    return decoded;
+}
+
+/*
+ * Function: chunked_decoder_done
+ *
+ * ------------------------------
+ *
+ *  Tells whether the last chunk and the trailer have been read.
+ *
+ *  decoder: pointer to the decoder.
+ *
+ *  returns: complete (1), more to come (0).
+ */
+int chunked_decoder_done(const ChunkedDecoder* decoder) {
+    return decoder->state == CHUNKED_DONE;
+}
@@ -0,0 +1,84 @@
+#include "../include/codel.h"
+#include "../include/utils.h"
+
+#include <limits.h>
+
+/*
+ * Function: init_codel
+ *
+ * --------------------
+ *
+ *  Initializes the controller.
+ *
+ *  codel: pointer to the controller.
+ *  target: acceptable standing delay in milliseconds, 0 never sheds.
+ *  interval: measurement window in milliseconds.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int init_codel(CoDel* codel, unsigned long long target, unsigned long long interval) {
+    if (codel == NULL || interval == 0) {
+        return -1;
+    }
+    if (pthread_mutex_init(&codel->lock, NULL) != 0) {
+        err("init_codel", "Unable to initialize the lock!");
+        return -1;
+    }
+    codel->target = target;
+    codel->interval = interval;
+    codel->interval_end = 0;
+    codel->min_delay = ULLONG_MAX;
+    codel->overloaded = 0;
+    return 1;
+}
+
+/*
+ * Function: codel_should_shed
+ *
+ * ---------------------------
+ *
+ *  Records the queueing delay of a request that is about to be handled
+ *  and decides whether it should be rejected instead.
+ *
+ *  codel: pointer to the controller.
+ *  delay: milliseconds the request waited before being handled.
+ *  now: current monotonic time in milliseconds.
+ *
+ *  returns: handle the request (0), shed it (1).
+ */
+int codel_should_shed(CoDel* codel, unsigned long long delay, unsigned long long now) {
+    if (codel == NULL || codel->target == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&codel->lock);
+    if (now >= codel->interval_end) {
+        // an idle window says nothing about the queue
+        codel->overloaded = codel->min_delay != ULLONG_MAX && codel->min_delay > codel->target;
+        codel->min_delay = ULLONG_MAX;
+        codel->interval_end = now + codel->interval;
+    }
+    if (delay < codel->min_delay) {
+        codel->min_delay = delay;
+    }
+    unsigned long long limit = codel->overloaded ? codel->target : codel->interval;
+    pthread_mutex_unlock(&codel->lock);
+
+    return delay > limit;
+}
+
+/*
+ * Function: free_codel
+ *
+ * --------------------
+ *
+ *  Releases the controller's lock.
+ *
+ *  codel: pointer to the controller.
+ */
+void free_codel(CoDel* codel) {
+    if (codel == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&codel->lock);
+}
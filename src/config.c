@@ -0,0 +1,427 @@
+#include "../include/config.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int parse_port(const char* value, char* port) {
+    char* end;
+    long number = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || number <= 0 || number > 65535) {
+        err("add_listener", "Invalid port!");
+        return -1;
+    }
+    snprintf(port, 6, "%ld", number);
+    return 1;
+}
+
+/*
+ * Function: add_listener
+ *
+ * ----------------------
+ *
+ *  Parses a listener description and appends it to the config.
+ *
+ *  config: pointer to the server config.
+ *  spec: tcp4:[host:]port, tcp6:[[host]:]port or unix:path, optionally
+ *        followed by ,batch=N and ,backlog=N.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+static int add_listener(ServerConfig* config, const char* spec) {
+    if (config->listener_count == MAX_LISTENERS) {
+        err("add_listener", "Too many listeners!");
+        return -1;
+    }
+
+    char buffer[256];
+    if (snprintf(buffer, sizeof(buffer), "%s", spec) >= (int) sizeof(buffer)) {
+        err("add_listener", "Listener description is too long!");
+        return -1;
+    }
+
+    ListenerConfig listener;
+    memset(&listener, 0, sizeof(listener));
+
+    // accept policy, after the address
+    char* options = strchr(buffer, ',');
+    if (options != NULL) {
+        *options++ = '\0';
+    }
+    while (options != NULL) {
+        char* next = strchr(options, ',');
+        if (next != NULL) *next++ = '\0';
+        int value = 0;
+        if (sscanf(options, "batch=%d", &value) == 1 && value > 0) {
+            listener.accept_batch = value;
+        } else if (sscanf(options, "backlog=%d", &value) == 1 && value > 0) {
+            listener.backlog = value;
+        } else {
+            err("add_listener", "Invalid listener option!");
+            return -1;
+        }
+        options = next;
+    }
+
+    char* address = NULL;
+    char* port = NULL;
+    if (strncmp(buffer, "unix:", 5) == 0) {
+        listener.type = LISTENER_UNIX;
+        if (buffer[5] == '\0' || strlen(buffer + 5) >= LISTENER_ADDRESS_SIZE) {
+            err("add_listener", "Invalid unix socket path!");
+            return -1;
+        }
+        strcpy(listener.address, buffer + 5);
+    } else if (strncmp(buffer, "tcp4:", 5) == 0) {
+        listener.type = LISTENER_TCP4;
+        port = strrchr(buffer + 5, ':');
+        if (port != NULL) {
+            *port++ = '\0';
+            address = buffer + 5;
+        } else {
+            port = buffer + 5;
+        }
+    } else if (strncmp(buffer, "tcp6:", 5) == 0) {
+        listener.type = LISTENER_TCP6;
+        port = buffer + 5;
+        // addresses are bracketed, their colons are not the port separator
+        if (*port == '[') {
+            address = port + 1;
+            char* close = strchr(address, ']');
+            if (close == NULL || close[1] != ':') {
+                err("add_listener", "Invalid IPv6 listener address!");
+                return -1;
+            }
+            *close = '\0';
+            port = close + 2;
+        }
+    } else {
+        err("add_listener", "Unknown listener type!");
+        return -1;
+    }
+
+    if (port != NULL && parse_port(port, listener.port) == -1) {
+        return -1;
+    }
+    if (address != NULL) {
+        if (strlen(address) >= LISTENER_ADDRESS_SIZE) {
+            err("add_listener", "Invalid listener address!");
+            return -1;
+        }
+        strcpy(listener.address, address);
+    }
+
+    config->listeners[config->listener_count++] = listener;
+    return 1;
+}
+
+/*
+ * Function: init_server_config
+ *
+ * ----------------------------
+ *
+ *  Fills the config with default values.
+ *
+ *  config: pointer to the server config.
+ */
+void init_server_config(ServerConfig* config) {
+    config->argv = NULL;
+    config->listener_count = 0;
+    config->poll_backend = POLL_BACKEND_EPOLL;
+    config->poll_trigger = POLL_TRIGGER_LEVEL;
+    config->keep_alive_timeout = DEFAULT_KEEP_ALIVE_TIMEOUT;
+    config->header_timeout = DEFAULT_HEADER_TIMEOUT;
+    config->body_timeout = DEFAULT_BODY_TIMEOUT;
+    config->write_timeout = DEFAULT_WRITE_TIMEOUT;
+    config->max_keep_alive_requests = DEFAULT_KEEP_ALIVE_REQUESTS;
+    config->workers = 1;
+    config->handler_threads = 0;
+    config->accept_batch = DEFAULT_ACCEPT_BATCH;
+    config->backlog = DEFAULT_LISTEN_BACKLOG;
+    config->max_connections = DEFAULT_MAX_CONNECTIONS;
+    config->shed_target = DEFAULT_SHED_TARGET;
+    config->shed_interval = DEFAULT_SHED_INTERVAL;
+    config->drain_timeout = DEFAULT_DRAIN_TIMEOUT;
+    config->output_high_water = DEFAULT_OUTPUT_HIGH_WATER;
+    config->sendfile_threshold = DEFAULT_SENDFILE_THRESHOLD;
+    config->max_body_size = DEFAULT_MAX_BODY_SIZE;
+    config->body_memory_limit = DEFAULT_BODY_MEMORY_LIMIT;
+    config->body_temp_dir = DEFAULT_BODY_TEMP_DIR;
+    init_socket_options(&config->socket_options);
+}
+
+/*
+ * Function: print_usage
+ *
+ * ---------------------
+ *
+ *  Prints command line usage.
+ *
+ *  program: program name.
+ */
+void print_usage(const char* program) {
+    printf("USAGE: %s [port] [options]\n", program);
+    printf("\t--listen SPEC\t\tadd a listener, the port alone listens on tcp4:port\n");
+    printf("\t\t\t\ttcp4:[host:]port, tcp6:[[host]:]port or unix:path\n");
+    printf("\t\t\t\tfollowed by ,batch=N or ,backlog=N to override the accept policy\n");
+    printf("\t--backend poll|epoll|uring\tevent loop backend (default: epoll)\n");
+    printf("\t--edge-triggered\tuse edge triggered notifications (epoll)\n");
+    printf("\t--keep-alive-timeout S\tidle seconds before closing a connection (default: %d)\n",
+           DEFAULT_KEEP_ALIVE_TIMEOUT);
+    printf("\t--header-timeout S\tseconds to receive the request headers (default: %d)\n", DEFAULT_HEADER_TIMEOUT);
+    printf("\t--body-timeout S\tseconds without body data before closing (default: %d)\n", DEFAULT_BODY_TIMEOUT);
+    printf("\t--write-timeout S\tseconds without response progress before closing (default: %d)\n",
+           DEFAULT_WRITE_TIMEOUT);
+    printf("\t--max-requests N\trequests per connection, 1 disables keep-alive (default: %d)\n",
+           DEFAULT_KEEP_ALIVE_REQUESTS);
+    printf("\t--workers N\t\tevent loop threads, 0 uses every online cpu (default: 1)\n");
+    printf("\t--handler-threads N\trun route handlers on a shared thread pool (default: 0, inline)\n");
+    printf("\t--accept-batch N\tconnections accepted per listener wakeup (default: %d)\n", DEFAULT_ACCEPT_BATCH);
+    printf("\t--backlog N\t\tlisten queue length (default: %d)\n", DEFAULT_LISTEN_BACKLOG);
+    printf("\t--max-connections N\topen connections before new ones get a 503, 0 is unlimited (default: %d)\n",
+           DEFAULT_MAX_CONNECTIONS);
+    printf("\t--shed-target MS\tqueue delay before requests get a 503, 0 disables shedding (default: %d)\n",
+           DEFAULT_SHED_TARGET);
+    printf("\t--shed-interval MS\twindow the queue delay has to persist over (default: %d)\n",
+           DEFAULT_SHED_INTERVAL);
+    printf("\t--drain-timeout S\tseconds to finish in-flight requests after SIGTERM (default: %d)\n",
+           DEFAULT_DRAIN_TIMEOUT);
+    printf("\t--output-high-water N\tpending response bytes before a client is no longer read, 0 is unlimited (default: %d)\n",
+           DEFAULT_OUTPUT_HIGH_WATER);
+    printf("\t--sendfile-threshold N\tstatic files from this size on are sent with sendfile, smaller ones are read (default: %d)\n",
+           DEFAULT_SENDFILE_THRESHOLD);
+    printf("\t--max-body-size N\trequest body limit of routes without their own, 0 is unlimited (default: %d)\n",
+           DEFAULT_MAX_BODY_SIZE);
+    printf("\t--body-memory-limit N\trequest bodies larger than this are spilled to a temp file (default: %d)\n",
+           DEFAULT_BODY_MEMORY_LIMIT);
+    printf("\t--body-temp-dir PATH\tdirectory for spilled request bodies (default: %s)\n", DEFAULT_BODY_TEMP_DIR);
+    printf("\t--tcp-nodelay\t\tdisable Nagle's algorithm on client sockets\n");
+    printf("\t--tcp-quickack\t\tack the first request immediately\n");
+    printf("\t--defer-accept S\twake up for connections only once they sent data, for up to S seconds\n");
+    printf("\t--fastopen N\t\taccept TCP Fast Open with a queue of N pending requests\n");
+    printf("\t--rcvbuf N\t\tsocket receive buffer in bytes (default: kernel)\n");
+    printf("\t--sndbuf N\t\tsocket send buffer in bytes (default: kernel)\n");
+    printf("\t--busy-poll US\t\tbusy poll the device for up to US microseconds on reads\n");
+    printf("SIGTERM drains the server, SIGHUP or SIGUSR2 start a new process on the same listeners.\n");
+}
+
+/*
+ * Function: parse_server_config
+ *
+ * -----------------------------
+ *
+ *  Parses command line arguments into the config.
+ *
+ *  argc: number of arguments.
+ *  argv: argument list.
+ *  config: pointer to the server config.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int parse_server_config(int argc, char** argv, ServerConfig* config) {
+    config->argv = argv;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            const char* backend = argv[++i];
+            if (strcmp(backend, "poll") == 0) {
+                config->poll_backend = POLL_BACKEND_POLL;
+            } else if (strcmp(backend, "epoll") == 0) {
+                config->poll_backend = POLL_BACKEND_EPOLL;
+            } else if (strcmp(backend, "uring") == 0) {
+                config->poll_backend = POLL_BACKEND_URING;
+            } else {
+                err("parse_server_config", "Unknown backend!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--edge-triggered") == 0) {
+            config->poll_trigger = POLL_TRIGGER_EDGE;
+        } else if (strcmp(argv[i], "--keep-alive-timeout") == 0 && i + 1 < argc) {
+            config->keep_alive_timeout = atoi(argv[++i]);
+            if (config->keep_alive_timeout <= 0) {
+                err("parse_server_config", "Keep-alive timeout must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--header-timeout") == 0 && i + 1 < argc) {
+            config->header_timeout = atoi(argv[++i]);
+            if (config->header_timeout <= 0) {
+                err("parse_server_config", "Header timeout must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--body-timeout") == 0 && i + 1 < argc) {
+            config->body_timeout = atoi(argv[++i]);
+            if (config->body_timeout <= 0) {
+                err("parse_server_config", "Body timeout must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--write-timeout") == 0 && i + 1 < argc) {
+            config->write_timeout = atoi(argv[++i]);
+            if (config->write_timeout <= 0) {
+                err("parse_server_config", "Write timeout must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--max-requests") == 0 && i + 1 < argc) {
+            int max_requests = atoi(argv[++i]);
+            if (max_requests <= 0) {
+                err("parse_server_config", "Max requests must be positive!");
+                return -1;
+            }
+            config->max_keep_alive_requests = max_requests;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            int workers = atoi(argv[++i]);
+            if (workers < 0) {
+                err("parse_server_config", "Workers can not be negative!");
+                return -1;
+            } else if (workers == 0) {
+                long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                workers = cpus > 0 ? (int) cpus : 1;
+            }
+            config->workers = workers;
+        } else if (strcmp(argv[i], "--handler-threads") == 0 && i + 1 < argc) {
+            int handler_threads = atoi(argv[++i]);
+            if (handler_threads < 0) {
+                err("parse_server_config", "Handler threads can not be negative!");
+                return -1;
+            }
+            config->handler_threads = handler_threads;
+        } else if (strcmp(argv[i], "--accept-batch") == 0 && i + 1 < argc) {
+            int accept_batch = atoi(argv[++i]);
+            if (accept_batch <= 0) {
+                err("parse_server_config", "Accept batch must be positive!");
+                return -1;
+            }
+            config->accept_batch = accept_batch;
+        } else if (strcmp(argv[i], "--backlog") == 0 && i + 1 < argc) {
+            config->backlog = atoi(argv[++i]);
+            if (config->backlog <= 0) {
+                err("parse_server_config", "Backlog must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--max-connections") == 0 && i + 1 < argc) {
+            int max_connections = atoi(argv[++i]);
+            if (max_connections < 0) {
+                err("parse_server_config", "Max connections can not be negative!");
+                return -1;
+            }
+            config->max_connections = max_connections;
+        } else if (strcmp(argv[i], "--shed-target") == 0 && i + 1 < argc) {
+            int shed_target = atoi(argv[++i]);
+            if (shed_target < 0) {
+                err("parse_server_config", "Shed target can not be negative!");
+                return -1;
+            }
+            config->shed_target = shed_target;
+        } else if (strcmp(argv[i], "--shed-interval") == 0 && i + 1 < argc) {
+            int shed_interval = atoi(argv[++i]);
+            if (shed_interval <= 0) {
+                err("parse_server_config", "Shed interval must be positive!");
+                return -1;
+            }
+            config->shed_interval = shed_interval;
+        } else if (strcmp(argv[i], "--drain-timeout") == 0 && i + 1 < argc) {
+            config->drain_timeout = atoi(argv[++i]);
+            if (config->drain_timeout <= 0) {
+                err("parse_server_config", "Drain timeout must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--output-high-water") == 0 && i + 1 < argc) {
+            long long output_high_water = atoll(argv[++i]);
+            if (output_high_water < 0) {
+                err("parse_server_config", "Output high water mark can not be negative!");
+                return -1;
+            }
+            config->output_high_water = output_high_water;
+        } else if (strcmp(argv[i], "--sendfile-threshold") == 0 && i + 1 < argc) {
+            long long sendfile_threshold = atoll(argv[++i]);
+            if (sendfile_threshold < 0) {
+                err("parse_server_config", "Sendfile threshold can not be negative!");
+                return -1;
+            }
+            config->sendfile_threshold = sendfile_threshold;
+        } else if (strcmp(argv[i], "--max-body-size") == 0 && i + 1 < argc) {
+            long long max_body_size = atoll(argv[++i]);
+            if (max_body_size < 0) {
+                err("parse_server_config", "Max body size can not be negative!");
+                return -1;
+            }
+            config->max_body_size = max_body_size;
+        } else if (strcmp(argv[i], "--body-memory-limit") == 0 && i + 1 < argc) {
+            long long body_memory_limit = atoll(argv[++i]);
+            if (body_memory_limit < 0) {
+                err("parse_server_config", "Body memory limit can not be negative!");
+                return -1;
+            }
+            config->body_memory_limit = body_memory_limit;
+        } else if (strcmp(argv[i], "--body-temp-dir") == 0 && i + 1 < argc) {
+            config->body_temp_dir = argv[++i];
+        } else if (strcmp(argv[i], "--tcp-nodelay") == 0) {
+            config->socket_options.nodelay = 1;
+        } else if (strcmp(argv[i], "--tcp-quickack") == 0) {
+            config->socket_options.quickack = 1;
+        } else if (strcmp(argv[i], "--defer-accept") == 0 && i + 1 < argc) {
+            config->socket_options.defer_accept = atoi(argv[++i]);
+            if (config->socket_options.defer_accept <= 0) {
+                err("parse_server_config", "Defer accept must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--fastopen") == 0 && i + 1 < argc) {
+            config->socket_options.fastopen = atoi(argv[++i]);
+            if (config->socket_options.fastopen <= 0) {
+                err("parse_server_config", "Fast open queue must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--rcvbuf") == 0 && i + 1 < argc) {
+            config->socket_options.rcvbuf = atoi(argv[++i]);
+            if (config->socket_options.rcvbuf <= 0) {
+                err("parse_server_config", "Receive buffer must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--sndbuf") == 0 && i + 1 < argc) {
+            config->socket_options.sndbuf = atoi(argv[++i]);
+            if (config->socket_options.sndbuf <= 0) {
+                err("parse_server_config", "Send buffer must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc) {
+            config->socket_options.busy_poll = atoi(argv[++i]);
+            if (config->socket_options.busy_poll <= 0) {
+                err("parse_server_config", "Busy poll time must be positive!");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            if (add_listener(config, argv[++i]) == -1) {
+                return -1;
+            }
+        } else if (argv[i][0] != '-') {
+            char spec[16];
+            snprintf(spec, sizeof(spec), "tcp4:%.6s", argv[i]);
+            if (add_listener(config, spec) == -1) {
+                return -1;
+            }
+        } else {
+            err("parse_server_config", "Invalid argument!");
+            printf("\t%s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (config->listener_count == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < config->listener_count; i++) {
+        ListenerConfig* listener = &config->listeners[i];
+        if (listener->accept_batch == 0) listener->accept_batch = config->accept_batch;
+        if (listener->backlog == 0) listener->backlog = config->backlog;
+
+        // dual-stack would collide with an IPv4 listener on the same port
+        if (listener->type != LISTENER_TCP6) continue;
+        for (size_t j = 0; j < config->listener_count; j++) {
+            if (config->listeners[j].type == LISTENER_TCP4 && strcmp(config->listeners[j].port, listener->port) == 0) {
+                listener->v6only = 1;
+            }
+        }
+    }
+    return 1;
+}
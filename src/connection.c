@@ -0,0 +1,183 @@
+#include "../include/connection.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+
+/*
+ * Function: create_connection
+ *
+ * ---------------------------
+ *
+ *  Creates the state attached to a polled file descriptor.
+ *
+ *  fd: file descriptor of the socket.
+ *  type: listener or client socket.
+ *  pools: worker pools to allocate from, NULL uses malloc.
+ *
+ *  returns: pointer to the connection. if failed, NULL.
+ */
+Connection* create_connection(int fd, ConnectionType type, ConnectionPools* pools) {
+    if (fd < 0) {
+        return NULL;
+    }
+
+    Connection* conn = pools ? slab_alloc(&pools->connections) : malloc(sizeof(Connection));
+    if (conn == NULL) {
+        err("create_connection", "Unable to allocate memory for connection!");
+        return NULL;
+    }
+
+    memset(conn, 0, sizeof(Connection));
+    conn->fd = fd;
+    conn->type = type;
+    conn->state = CONNECTION_READING_HEADER;
+    conn->poll_events = POLLIN;
+    init_http_parser(&conn->parser);
+    init_arena(&conn->arena, conn->arena_block, sizeof(conn->arena_block));
+    conn->req.arena = &conn->arena;
+    conn->pools = pools;
+    if (pools != NULL) {
+        init_output_queue(&conn->output, &pools->segments, &pools->buffers);
+    } else {
+        init_output_queue(&conn->output, NULL, NULL);
+    }
+    init_timer(&conn->read_timer, conn);
+    init_timer(&conn->write_timer, conn);
+    conn->write_timer.kind = CONNECTION_DEADLINE_WRITE;
+    conn->input_op.type = type == CONNECTION_LISTENER ? IO_OP_ACCEPT : IO_OP_RECV;
+    conn->input_op.conn = conn;
+    conn->send_op.type = IO_OP_SEND;
+    conn->send_op.conn = conn;
+    conn->file_op.type = IO_OP_FILE_READ;
+    conn->file_op.conn = conn;
+    return conn;
+}
+
+/*
+ * Function: reset_connection_request
+ *
+ * ----------------------------------
+ *
+ *  Frees the parsed request and drops its bytes from the request buffer,
+ *  keeping any pipelined data that follows it for the next request.
+ *
+ *  conn: pointer to the connection.
+ */
+void reset_connection_request(Connection* conn) {
+    if (conn == NULL) {
+        return;
+    }
+
+    free_http_req(&conn->req);
+    StringBuffer* request_buffer = &conn->request_buffer;
+    if (request_buffer->data != NULL) {
+        // the body was moved out of the buffer while it arrived
+        size_t request_size = conn->header_size;
+        if (conn->state != CONNECTION_REQUEST_READY || request_size > request_buffer->size) {
+            request_size = request_buffer->size;
+        }
+        memmove(request_buffer->data, request_buffer->data + request_size, request_buffer->size - request_size);
+        request_buffer->size -= request_size;
+        request_buffer->data[request_buffer->size] = '\0';
+    }
+    conn->state = CONNECTION_READING_HEADER;
+    init_http_parser(&conn->parser);
+    conn->header_size = 0;
+    conn->content_length = 0;
+    conn->chunked = 0;
+    conn->body_limit = 0;
+}
+
+/*
+ * Function: connection_list_push
+ *
+ * ------------------------------
+ *
+ *  Appends the connection to the list.
+ *
+ *  list: pointer to the connection list.
+ *  conn: pointer to the connection.
+ */
+void connection_list_push(ConnectionList* list, Connection* conn) {
+    conn->next = NULL;
+    conn->prev = list->tail;
+    if (list->tail != NULL) {
+        list->tail->next = conn;
+    } else {
+        list->head = conn;
+    }
+    list->tail = conn;
+    list->size++;
+}
+
+/*
+ * Function: connection_list_remove
+ *
+ * --------------------------------
+ *
+ *  Unlinks the connection from the list.
+ *
+ *  list: pointer to the connection list.
+ *  conn: pointer to the connection.
+ */
+void connection_list_remove(ConnectionList* list, Connection* conn) {
+    if (conn->prev != NULL) {
+        conn->prev->next = conn->next;
+    } else {
+        list->head = conn->next;
+    }
+    if (conn->next != NULL) {
+        conn->next->prev = conn->prev;
+    } else {
+        list->tail = conn->prev;
+    }
+    conn->prev = NULL;
+    conn->next = NULL;
+    list->size--;
+}
+
+/*
+ * Function: connection_io_active
+ *
+ * ------------------------------
+ *
+ *  Tells whether an io_uring request of the connection is still in flight,
+ *  the kernel may use its memory until the request completes.
+ *
+ *  conn: pointer to the connection.
+ *
+ *  returns: in flight (1), otherwise (0).
+ */
+int connection_io_active(const Connection* conn) {
+    return conn->input_op.active || conn->send_op.active || conn->file_op.active;
+}
+
+/*
+ * Function: free_connection
+ *
+ * -------------------------
+ *
+ *  Frees the connection state, returning pooled memory to its pools. The
+ *  socket is not closed.
+ *
+ *  conn: pointer to the connection.
+ */
+void free_connection(Connection* conn) {
+    if (conn == NULL) {
+        return;
+    }
+
+    free_http_req(&conn->req);
+    free_output_queue(&conn->output);
+    free_string_buffer(&conn->file_buffer);
+    if (conn->pools != NULL) {
+        buffer_pool_release(&conn->pools->buffers, &conn->request_buffer);
+        slab_free(&conn->pools->connections, conn);
+    } else {
+        free_string_buffer(&conn->request_buffer);
+        free(conn);
+    }
+}
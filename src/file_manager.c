@@ -1,8 +1,12 @@
 #include "../include/file_manager.h"
 #include "../include/utils.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <dirent.h>
@@ -170,19 +174,20 @@ ssize_t read_file_content(const char* path, unsigned char** buffer) {
 *
 *  Converts requested path to local path.
 *
+*  arena: arena for the local path, NULL uses malloc.
 *  req_path: Requested path.
 *  req_path_size: Requested path string size.
 *  local_path: Pointer to the local path string.
 *
 *  returns: Local path string size. If failed, returns (-1).
 */
-int req_path_to_local(const char* req_path, size_t req_path_size, char** local_path) {
+int req_path_to_local(Arena* arena, const char* req_path, size_t req_path_size, char** local_path) {
     if (req_path == NULL) {
         return -1;
     }
 
     size_t local_path_size = req_path_size + strlen(DEFAULT_SERVER_PATH) + 1;
-    *local_path = malloc(local_path_size * sizeof(char));
+    *local_path = arena ? arena_alloc(arena, local_path_size) : malloc(local_path_size * sizeof(char));
     if (*local_path == NULL) {
         err("req_path_to_local", "Unable to allocate memory for local path!");
         return -1;
@@ -225,35 +230,40 @@ void free_file_table(FileTable* file_table) {
 *
 * -----------------------------
 *  
-*  Sends file to client in chunks.
+*  Sends the whole file to a blocking socket with sendfile, straight from
+*  the page cache.
 *
 *  client_fd: client file discriptor.
 *  path: file path.
 *
-*  returns: Number of sent bytes.
+*  returns: Number of sent bytes. If failed, returns (-1).
 */
 ssize_t stream_file_content(int client_fd, const char* path) {
-    FILE* file = fopen(path, "rb");
-    if (!file) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         err("stream_file_content", "Unable to open file!");
         return -1;
     }
-    unsigned char* buffer = malloc(4096 * sizeof(unsigned char));
-    if (buffer == NULL) {
-        err("stream_file_content", "Unable to allocate memory for file buffer!");
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        err("stream_file_content", "Unable to read file size!");
+        close(fd);
         return -1;
     }
-    size_t read_bytes;
-    ssize_t total_sent = 0;
-    while ((read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
-        ssize_t sent = send(client_fd, buffer, read_bytes, 0);
-        if (sent == -1) {
+
+    off_t offset = 0;
+    while (offset < file_stat.st_size) {
+        ssize_t sent = sendfile(client_fd, fd, &offset, file_stat.st_size - offset);
+        if (sent == -1 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
             err("stream_file_content", "Unable to send data!");
-            fclose(file);
+            close(fd);
             return -1;
         }
-        total_sent += sent;
     }
-    fclose(file);
-    return total_sent;
+    close(fd);
+    return offset;
 }
@@ -0,0 +1,80 @@
+#include "../include/known_headers.h"
+
+#include <strings.h>
+
+#define HEADER_TABLE_SIZE 128
+// collision free for the known headers, checked by the slot table below
+#define HEADER_HASH(size, first, last) (((size) + (first) * 4 + (last) * 24) & (HEADER_TABLE_SIZE - 1))
+
+// header id + 1 by hash, 0 for empty slots. Two headers in one slot fail the build
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Woverride-init"
+static const unsigned char header_slots[HEADER_TABLE_SIZE] = {
+#define HTTP_HEADER_SLOT(id, name, first, last) [HEADER_HASH(sizeof(name) - 1, first, last)] = HTTP_HEADER_##id + 1,
+    HTTP_KNOWN_HEADERS(HTTP_HEADER_SLOT)
+#undef HTTP_HEADER_SLOT
+};
+#pragma GCC diagnostic pop
+
+static const char* const header_names[HTTP_HEADER_COUNT] = {
+#define HTTP_HEADER_NAME(id, name, first, last) name,
+    HTTP_KNOWN_HEADERS(HTTP_HEADER_NAME)
+#undef HTTP_HEADER_NAME
+};
+
+static const unsigned char header_sizes[HTTP_HEADER_COUNT] = {
+#define HTTP_HEADER_SIZE(id, name, first, last) sizeof(name) - 1,
+    HTTP_KNOWN_HEADERS(HTTP_HEADER_SIZE)
+#undef HTTP_HEADER_SIZE
+};
+
+/*
+ * Function: http_header_id
+ *
+ * ------------------------
+ *
+ *  Classifies a header name, case-insensitively, with one hash probe and
+ *  one comparison.
+ *
+ *  name: field name, not necessarily NUL terminated.
+ *  size: length of the name.
+ *
+ *  returns: id of the header. if it is not a known one (-1).
+ */
+int http_header_id(const char* name, size_t size) {
+    if (name == NULL || size == 0) {
+        return -1;
+    }
+
+    // names are tokens, setting 0x20 lowercases letters and leaves digits as they are
+    unsigned char first = (unsigned char) name[0] | 0x20;
+    unsigned char last = (unsigned char) name[size - 1] | 0x20;
+    int slot = header_slots[HEADER_HASH(size, first, last)];
+    if (slot == 0) {
+        return -1;
+    }
+
+    int id = slot - 1;
+    if (header_sizes[id] != size || strncasecmp(name, header_names[id], size) != 0) {
+        return -1;
+    }
+    return id;
+}
+
+/*
+ * Function: http_header_name
+ *
+ * --------------------------
+ *
+ *  Returns the canonical spelling of a known header.
+ *
+ *  id: header id.
+ *
+ *  returns: header name. if the id is out of range, NULL.
+ */
+const char* http_header_name(HTTPHeaderId id) {
+    if (id < 0 || id >= HTTP_HEADER_COUNT) {
+        return NULL;
+    }
+    return header_names[id];
+}
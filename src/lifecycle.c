@@ -0,0 +1,268 @@
+#define _GNU_SOURCE // execvpe
+#include "../include/lifecycle.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+extern char** environ;
+
+static const int* signal_wake_fds = NULL;
+static size_t signal_wake_count = 0;
+static atomic_int drain_pending = 0;
+static atomic_int reload_pending = 0;
+static pid_t predecessor = 0;
+
+static void handle_signal(int signal_number) {
+    int saved_errno = errno;
+    if (signal_number == SIGTERM) {
+        atomic_store(&drain_pending, 1);
+    } else {
+        atomic_store(&reload_pending, 1);
+    }
+
+    // only async-signal-safe calls from here on
+    uint64_t value = 1;
+    for (size_t i = 0; i < signal_wake_count; i++) {
+        if (write(signal_wake_fds[i], &value, sizeof(value)) == -1) {
+            continue;
+        }
+    }
+    errno = saved_errno;
+}
+
+/*
+ * Function: install_signal_handlers
+ *
+ * ---------------------------------
+ *
+ *  SIGTERM requests a graceful drain, SIGHUP and SIGUSR2 request a reload.
+ *  Every request is announced by writing to the given eventfds. SIGPIPE
+ *  is ignored, sendfile has no MSG_NOSIGNAL.
+ *
+ *  wake_fds: eventfds of the event loops, must outlive the handlers.
+ *  count: number of eventfds.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int install_signal_handlers(const int* wake_fds, size_t count) {
+    signal_wake_fds = wake_fds;
+    signal_wake_count = count;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGTERM, &action, NULL) == -1 || sigaction(SIGHUP, &action, NULL) == -1 ||
+        sigaction(SIGUSR2, &action, NULL) == -1) {
+        err("install_signal_handlers", "Unable to install signal handlers!");
+        remove_signal_handlers();
+        return -1;
+    }
+
+    // successors are never waited for, the kernel reaps them
+    signal(SIGCHLD, SIG_IGN);
+    // a peer gone in the middle of a sendfile is reported as EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+    return 1;
+}
+
+/*
+ * Function: remove_signal_handlers
+ *
+ * --------------------------------
+ *
+ *  Restores the default signal dispositions.
+ */
+void remove_signal_handlers(void) {
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGUSR2, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    signal_wake_count = 0;
+    signal_wake_fds = NULL;
+}
+
+/*
+ * Function: drain_requested
+ *
+ * -------------------------
+ *
+ *  returns: a drain was requested (1), otherwise (0).
+ */
+int drain_requested(void) {
+    return atomic_load(&drain_pending);
+}
+
+/*
+ * Function: take_reload_request
+ *
+ * -----------------------------
+ *
+ *  Consumes a pending reload request, so only one caller acts on it.
+ *
+ *  returns: a reload was pending (1), otherwise (0).
+ */
+int take_reload_request(void) {
+    return atomic_exchange(&reload_pending, 0);
+}
+
+/*
+ * Function: inherited_listeners
+ *
+ * -----------------------------
+ *
+ *  Reads the listener descriptors passed down by a predecessor and clears
+ *  the hand-off environment. Must run before any thread is started.
+ *
+ *  count: receives the number of descriptors.
+ *
+ *  returns: allocated descriptor list. NULL if none were inherited or failed.
+ */
+int* inherited_listeners(size_t* count) {
+    *count = 0;
+    const char* list = getenv(LISTEN_FDS_ENV);
+    const char* parent = getenv(PREDECESSOR_ENV);
+    if (list == NULL || *list == '\0') {
+        unsetenv(PREDECESSOR_ENV);
+        return NULL;
+    }
+
+    size_t max_count = 1;
+    for (const char* ptr = list; *ptr != '\0'; ptr++) {
+        if (*ptr == ',') max_count++;
+    }
+    int* fds = malloc(sizeof(int) * max_count);
+    if (fds == NULL) {
+        err("inherited_listeners", "Unable to allocate memory for listeners!");
+        return NULL;
+    }
+
+    const char* ptr = list;
+    while (*ptr != '\0') {
+        char* end;
+        long fd = strtol(ptr, &end, 10);
+        int type = 0;
+        socklen_t type_size = sizeof(type);
+        // anything but a stream socket was not meant for us
+        if (end == ptr || fd < 0 ||
+            getsockopt((int) fd, SOL_SOCKET, SO_TYPE, &type, &type_size) == -1 || type != SOCK_STREAM) {
+            err("inherited_listeners", "Invalid inherited listener!");
+            for (size_t i = 0; i < *count; i++) close(fds[i]);
+            free(fds);
+            *count = 0;
+            return NULL;
+        }
+        fcntl((int) fd, F_SETFD, FD_CLOEXEC);
+        fds[(*count)++] = (int) fd;
+        ptr = *end == ',' ? end + 1 : end;
+    }
+
+    if (parent != NULL) {
+        predecessor = (pid_t) strtol(parent, NULL, 10);
+    }
+    unsetenv(LISTEN_FDS_ENV);
+    unsetenv(PREDECESSOR_ENV);
+    return fds;
+}
+
+/*
+ * Function: spawn_successor
+ *
+ * -------------------------
+ *
+ *  Executes the server binary again with the listeners inherited, so the
+ *  backlog is kept while the successor starts.
+ *
+ *  argv: command line the server was started with.
+ *  listener_fds: listener descriptors to hand down, -1 entries are skipped.
+ *  count: number of descriptors.
+ *
+ *  returns: pid of the successor. if failed (-1).
+ */
+pid_t spawn_successor(char** argv, const int* listener_fds, size_t count) {
+    if (argv == NULL || argv[0] == NULL || listener_fds == NULL || count == 0) {
+        return -1;
+    }
+
+    // the child of a threaded process may only make async-signal-safe calls,
+    // so everything it needs is prepared here
+    size_t fds_size = sizeof(LISTEN_FDS_ENV) + count * 12;
+    char* fds_env = malloc(fds_size);
+    char parent_env[sizeof(PREDECESSOR_ENV) + 24];
+    size_t env_count = 0;
+    while (environ[env_count] != NULL) env_count++;
+    char** envp = malloc(sizeof(char*) * (env_count + 3));
+    if (fds_env == NULL || envp == NULL) {
+        err("spawn_successor", "Unable to allocate memory for the environment!");
+        free(fds_env);
+        free(envp);
+        return -1;
+    }
+
+    size_t offset = snprintf(fds_env, fds_size, "%s=", LISTEN_FDS_ENV);
+    size_t handed = 0;
+    for (size_t i = 0; i < count; i++) {
+        // closed by a draining worker
+        if (listener_fds[i] == -1) continue;
+        offset += snprintf(fds_env + offset, fds_size - offset, handed++ == 0 ? "%d" : ",%d", listener_fds[i]);
+    }
+    if (handed == 0) {
+        err("spawn_successor", "No listener left to hand down!");
+        free(fds_env);
+        free(envp);
+        return -1;
+    }
+    snprintf(parent_env, sizeof(parent_env), "%s=%d", PREDECESSOR_ENV, (int) getpid());
+
+    size_t envp_size = 0;
+    for (size_t i = 0; i < env_count; i++) {
+        if (strncmp(environ[i], LISTEN_FDS_ENV "=", sizeof(LISTEN_FDS_ENV)) != 0 &&
+            strncmp(environ[i], PREDECESSOR_ENV "=", sizeof(PREDECESSOR_ENV)) != 0) {
+            envp[envp_size++] = environ[i];
+        }
+    }
+    envp[envp_size++] = fds_env;
+    envp[envp_size++] = parent_env;
+    envp[envp_size] = NULL;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (listener_fds[i] != -1) fcntl(listener_fds[i], F_SETFD, 0);
+        }
+        execvpe(argv[0], argv, envp);
+        _exit(127);
+    } else if (pid == -1) {
+        err("spawn_successor", "Unable to fork the successor!");
+    }
+
+    free(fds_env);
+    free(envp);
+    return pid;
+}
+
+/*
+ * Function: notify_predecessor
+ *
+ * ----------------------------
+ *
+ *  Asks the server that handed down the listeners to drain, once this
+ *  process accepts on them.
+ */
+void notify_predecessor(void) {
+    // a predecessor that already exited may have handed its pid on
+    if (predecessor > 0 && getppid() == predecessor) {
+        kill(predecessor, SIGTERM);
+    }
+    predecessor = 0;
+}
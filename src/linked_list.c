@@ -14,12 +14,25 @@
  *
  *  returns: Pointer to the item.
  */
-ListItem* create_item(const char* key, const void* value, size_t value_size) {
+ListItem* create_item(Arena* arena, const char* key, const void* value, size_t value_size) {
     if (key == NULL || value == NULL || value_size == 0) {
         err("dict_create", "Null key or value!");
         return NULL;
     }
 
+    if (arena != NULL) {
+        ListItem* item = arena_alloc(arena, sizeof(ListItem));
+        if (item == NULL || (item->key = arena_strdup(arena, key)) == NULL ||
+            (item->value = arena_alloc(arena, value_size)) == NULL) {
+            err("dict_create", "Unable to allocate arena memory for new dictionary entry!");
+            return NULL;
+        }
+        memcpy(item->value, value, value_size);
+        item->next = NULL;
+        item->value_size = value_size;
+        return item;
+    }
+
     ListItem* item = malloc(sizeof(ListItem));
     if (item == NULL) {
         err("dict_create", "Unable to allocate memory for new dictionary entry!");
@@ -73,6 +86,15 @@ int list_set_item(List* list, const char* key, const void* value, size_t value_s
     if (existing_key != NULL) {
         if (existing_key->value_size == value_size) {
             memcpy(existing_key->value, value, value_size);
+        } else if (list->arena != NULL) {
+            // the old value stays in the arena until its reset
+            existing_key->value = arena_alloc(list->arena, value_size);
+            if (existing_key->value == NULL) {
+                err("dict_create", "Unable to allocate arena memory for key value!");
+                return -1;
+            }
+            memcpy(existing_key->value, value, value_size);
+            existing_key->value_size = value_size;
         } else {
             existing_key->value = realloc(existing_key->value, value_size);
             if (existing_key->value == NULL) {
@@ -86,7 +108,7 @@ int list_set_item(List* list, const char* key, const void* value, size_t value_s
     }
 
     // If key does not exists
-    ListItem* new_item = create_item(key, value, value_size);
+    ListItem* new_item = create_item(list->arena, key, value, value_size);
     if (new_item == NULL) {
         return -1;
     }
@@ -136,10 +158,13 @@ size_t free_list(List* list) {
     ListItem* next;
     for (ListItem* i = list->items; i != NULL; i = next) {
         next = i->next;
+        items_freed++;
+        if (list->arena != NULL) {
+            continue;
+        }
         free(i->key);
         free(i->value);
         free(i);
-        items_freed++;
     }
 
     list->items = NULL;
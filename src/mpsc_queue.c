@@ -0,0 +1,79 @@
+#include "../include/mpsc_queue.h"
+
+#include <stdio.h>
+
+/*
+ * Function: init_mpsc_queue
+ *
+ * -------------------------
+ *
+ *  Initializes an empty queue.
+ *
+ *  queue: pointer to the queue.
+ */
+void init_mpsc_queue(MpscQueue* queue) {
+    atomic_store_explicit(&queue->stub.next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&queue->head, &queue->stub, memory_order_relaxed);
+    queue->tail = &queue->stub;
+}
+
+/*
+ * Function: mpsc_queue_push
+ *
+ * -------------------------
+ *
+ *  Appends a node, safe to call from any thread.
+ *
+ *  queue: pointer to the queue.
+ *  node: pointer to the node.
+ */
+void mpsc_queue_push(MpscQueue* queue, MpscNode* node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    MpscNode* prev = atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+    // the list is briefly disconnected here, pop reports empty until the link lands
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/*
+ * Function: mpsc_queue_pop
+ *
+ * ------------------------
+ *
+ *  Removes the oldest node, only called by the consumer thread.
+ *
+ *  queue: pointer to the queue.
+ *
+ *  returns: pointer to the node. NULL if the queue is empty or a push is
+ *           still in progress.
+ */
+MpscNode* mpsc_queue_pop(MpscQueue* queue) {
+    MpscNode* tail = queue->tail;
+    MpscNode* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &queue->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+
+    if (tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        return NULL;
+    }
+
+    // tail is the last node, put the stub behind it so it can be handed out
+    mpsc_queue_push(queue, &queue->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
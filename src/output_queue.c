@@ -0,0 +1,460 @@
+#include "../include/output_queue.h"
+#include "../include/utils.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// a buffer grown past this by one large response is not kept for the next
+#define OUTPUT_BUFFER_KEEP_SIZE (OUTPUT_BUFFER_SIZE * 16)
+
+static void free_segment(OutputQueue* queue, OutputSegment* segment) {
+    if (segment->type == OUTPUT_SEGMENT_MEMORY) {
+        buffer_pool_release(queue->buffers, &segment->buffer);
+    } else if (segment->type == OUTPUT_SEGMENT_DATA) {
+        free_string_buffer(&segment->buffer);
+    } else if (segment->fd != -1) {
+        close(segment->fd);
+    }
+    // segments spliced in from another queue may come from malloc
+    if (segment->pooled) {
+        slab_free(queue->segments, segment);
+    } else {
+        free(segment);
+    }
+}
+
+static OutputSegment* create_segment(OutputQueue* queue, OutputSegmentType type) {
+    OutputSegment* segment = queue->segments ? slab_alloc(queue->segments) : malloc(sizeof(OutputSegment));
+    if (segment == NULL) {
+        err("create_segment", "Unable to allocate memory for output segment!");
+        return NULL;
+    }
+    memset(segment, 0, sizeof(OutputSegment));
+    segment->type = type;
+    segment->fd = -1;
+    segment->pooled = queue->segments != NULL;
+
+    if (type == OUTPUT_SEGMENT_MEMORY) {
+        int result = queue->buffers ? buffer_pool_acquire(queue->buffers, &segment->buffer)
+                                    : init_string_buffer(&segment->buffer, OUTPUT_BUFFER_SIZE);
+        if (result == -1) {
+            free_segment(queue, segment);
+            return NULL;
+        }
+    }
+
+    if (queue->tail != NULL) {
+        queue->tail->next = segment;
+    } else {
+        queue->head = segment;
+    }
+    queue->tail = segment;
+    return segment;
+}
+
+// drops the written head segment, the last memory segment is kept for reuse
+static void pop_segment(OutputQueue* queue) {
+    OutputSegment* segment = queue->head;
+    if (segment == queue->tail && segment->type == OUTPUT_SEGMENT_MEMORY &&
+        segment->buffer.max_size <= OUTPUT_BUFFER_KEEP_SIZE) {
+        segment->buffer.size = 0;
+        segment->sent = 0;
+        segment->sealed = 0;
+        return;
+    }
+
+    queue->head = segment->next;
+    if (queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    free_segment(queue, segment);
+}
+
+/*
+ * Function: init_output_queue
+ *
+ * ---------------------------
+ *
+ *  Initializes an empty queue. The pools are only safe to pass when the
+ *  queue is used by their owning thread alone.
+ *
+ *  queue: pointer to the output queue.
+ *  segments: pool for segment records, NULL uses malloc.
+ *  buffers: pool for memory segment buffers, NULL uses malloc.
+ */
+void init_output_queue(OutputQueue* queue, SlabPool* segments, BufferPool* buffers) {
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->segments = segments;
+    queue->buffers = buffers;
+}
+
+/*
+ * Function: output_queue_buffer
+ *
+ * -----------------------------
+ *
+ *  Returns the buffer at the end of the queue, appending a memory segment
+ *  if the last one is a file, a handed over buffer or sealed.
+ *
+ *  queue: pointer to the output queue.
+ *
+ *  returns: pointer to the buffer. if failed, NULL.
+ */
+StringBuffer* output_queue_buffer(OutputQueue* queue) {
+    if (queue == NULL) {
+        return NULL;
+    }
+    if (queue->tail != NULL && queue->tail->type == OUTPUT_SEGMENT_MEMORY && !queue->tail->sealed) {
+        return &queue->tail->buffer;
+    }
+
+    OutputSegment* segment = create_segment(queue, OUTPUT_SEGMENT_MEMORY);
+    return segment ? &segment->buffer : NULL;
+}
+
+/*
+ * Function: output_queue_write
+ *
+ * ----------------------------
+ *
+ *  Copies data to the end of the queue.
+ *
+ *  queue: pointer to the output queue.
+ *  data: pointer to the data.
+ *  data_size: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int output_queue_write(OutputQueue* queue, const char* data, size_t data_size) {
+    StringBuffer* buffer = output_queue_buffer(queue);
+    if (buffer == NULL || write_to_string_buffer(buffer, data, data_size) == -1) {
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Function: output_queue_take
+ *
+ * ---------------------------
+ *
+ *  Appends a heap buffer without copying it, unless it is small. The
+ *  queue frees it once written, also when appending fails.
+ *
+ *  queue: pointer to the output queue.
+ *  data: buffer allocated with malloc.
+ *  data_size: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int output_queue_take(OutputQueue* queue, char* data, size_t data_size) {
+    if (queue == NULL || data == NULL) {
+        free(data);
+        return -1;
+    }
+    if (data_size < OUTPUT_COPY_LIMIT) {
+        int result = output_queue_write(queue, data, data_size);
+        free(data);
+        return result;
+    }
+
+    OutputSegment* segment = create_segment(queue, OUTPUT_SEGMENT_DATA);
+    if (segment == NULL) {
+        free(data);
+        return -1;
+    }
+    segment->buffer.data = data;
+    segment->buffer.size = data_size;
+    segment->buffer.max_size = data_size;
+    return 1;
+}
+
+/*
+ * Function: output_queue_file
+ *
+ * ---------------------------
+ *
+ *  Appends a range of a file. The queue owns the descriptor from then on,
+ *  also when appending fails.
+ *
+ *  queue: pointer to the output queue.
+ *  fd: open file descriptor.
+ *  offset: first byte of the range.
+ *  length: number of bytes.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int output_queue_file(OutputQueue* queue, int fd, off_t offset, size_t length) {
+    if (queue == NULL || fd < 0) {
+        return -1;
+    }
+    if (length == 0) {
+        close(fd);
+        return 1;
+    }
+
+    OutputSegment* segment = create_segment(queue, OUTPUT_SEGMENT_FILE);
+    if (segment == NULL) {
+        close(fd);
+        return -1;
+    }
+    segment->fd = fd;
+    segment->offset = offset;
+    segment->length = length;
+    return 1;
+}
+
+/*
+ * Function: output_queue_splice
+ *
+ * -----------------------------
+ *
+ *  Moves every segment of src to the end of dst, leaving src empty.
+ *
+ *  dst: pointer to the receiving queue.
+ *  src: pointer to the queue being emptied.
+ */
+void output_queue_splice(OutputQueue* dst, OutputQueue* src) {
+    if (src->head == NULL) {
+        return;
+    }
+    if (dst->tail != NULL) {
+        dst->tail->next = src->head;
+    } else {
+        dst->head = src->head;
+    }
+    dst->tail = src->tail;
+    src->head = NULL;
+    src->tail = NULL;
+}
+
+/*
+ * Function: output_queue_pending
+ *
+ * ------------------------------
+ *
+ *  Counts the bytes not yet written.
+ *
+ *  queue: pointer to the output queue.
+ *
+ *  returns: number of pending bytes.
+ */
+size_t output_queue_pending(const OutputQueue* queue) {
+    size_t pending = 0;
+    for (OutputSegment* segment = queue->head; segment != NULL; segment = segment->next) {
+        if (segment->type == OUTPUT_SEGMENT_FILE) {
+            pending += segment->length;
+        } else {
+            pending += segment->buffer.size - segment->sent;
+        }
+    }
+    return pending;
+}
+
+/*
+ * Function: output_queue_gather
+ *
+ * -----------------------------
+ *
+ *  Describes the unwritten bytes of the memory segments at the head of the
+ *  queue, up to the first file, without writing them. Written segments
+ *  are dropped first, so a file at the head is left at queue->head.
+ *
+ *  queue: pointer to the output queue.
+ *  iov: receives the byte ranges.
+ *  iov_max: number of entries iov holds.
+ *  size: receives the number of bytes described.
+ *
+ *  returns: number of entries filled, 0 if the head is a file or nothing is left.
+ */
+size_t output_queue_gather(OutputQueue* queue, struct iovec* iov, size_t iov_max, size_t* size) {
+    *size = 0;
+    while (queue->head != NULL && queue->head->type != OUTPUT_SEGMENT_FILE &&
+           queue->head->sent == queue->head->buffer.size) {
+        OutputSegment* segment = queue->head;
+        pop_segment(queue);
+        // only the reused buffer is left
+        if (queue->head == segment) return 0;
+    }
+
+    size_t iov_count = 0;
+    // headers and bodies of several responses, up to the next file
+    for (OutputSegment* next = queue->head; next != NULL && next->type != OUTPUT_SEGMENT_FILE &&
+                                            iov_count < iov_max; next = next->next) {
+        size_t left = next->buffer.size - next->sent;
+        if (left == 0) continue;
+        iov[iov_count].iov_base = next->buffer.data + next->sent;
+        iov[iov_count].iov_len = left;
+        iov_count++;
+        *size += left;
+    }
+    return iov_count;
+}
+
+/*
+ * Function: output_queue_advance
+ *
+ * ------------------------------
+ *
+ *  Drops written bytes from the head of the queue, file ranges included.
+ *
+ *  queue: pointer to the output queue.
+ *  sent: number of bytes written.
+ */
+void output_queue_advance(OutputQueue* queue, size_t sent) {
+    while (queue->head != NULL) {
+        OutputSegment* written = queue->head;
+        size_t pending = written->type == OUTPUT_SEGMENT_FILE ? written->length
+                                                              : written->buffer.size - written->sent;
+        if (sent < pending) {
+            if (written->type == OUTPUT_SEGMENT_FILE) {
+                written->offset += sent;
+                written->length -= sent;
+            } else {
+                written->sent += sent;
+            }
+            return;
+        }
+        if (written->type == OUTPUT_SEGMENT_FILE) {
+            written->length = 0;
+        } else {
+            written->sent += pending;
+        }
+        sent -= pending;
+        pop_segment(queue);
+        if (queue->head == written) return;
+    }
+}
+
+/*
+ * Function: output_queue_seal
+ *
+ * ---------------------------
+ *
+ *  Stops appending to the last segment, whose bytes a send in flight may
+ *  still read. Later writes start a new segment.
+ *
+ *  queue: pointer to the output queue.
+ */
+void output_queue_seal(OutputQueue* queue) {
+    if (queue->tail != NULL) {
+        queue->tail->sealed = 1;
+    }
+}
+
+/*
+ * Function: output_queue_send
+ *
+ * ---------------------------
+ *
+ *  Writes as much of the queue as the socket takes without blocking.
+ *  Consecutive buffers go out together in one gathered send, files with
+ *  sendfile. The socket is corked meanwhile so a header shares its
+ *  segments with the file data that follows it.
+ *
+ *  queue: pointer to the output queue.
+ *  socket_fd: non-blocking socket.
+ *
+ *  returns: number of bytes sent. if failed (-1).
+ */
+ssize_t output_queue_send(OutputQueue* queue, int socket_fd) {
+    ssize_t total = 0;
+
+    // headers leave in the same segments as the start of the file that follows them
+    int corked = 0;
+    for (OutputSegment* segment = queue->head; segment != NULL; segment = segment->next) {
+        if (segment->type == OUTPUT_SEGMENT_FILE) {
+            int enable = 1;
+            corked = setsockopt(socket_fd, IPPROTO_TCP, TCP_CORK, &enable, sizeof(enable)) == 0;
+            break;
+        }
+    }
+
+    while (1) {
+        struct iovec iov[OUTPUT_IOV_MAX];
+        size_t size;
+        size_t iov_count = output_queue_gather(queue, iov, OUTPUT_IOV_MAX, &size);
+        if (iov_count == 0) {
+            OutputSegment* segment = queue->head;
+            if (segment == NULL || segment->type != OUTPUT_SEGMENT_FILE) {
+                break;
+            }
+            // straight from the page cache, the offset is advanced by the kernel
+            off_t offset = segment->offset;
+            ssize_t sent = sendfile(socket_fd, segment->fd, &offset, segment->length);
+            if (sent == -1) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                total = -1;
+                break;
+            }
+            if (sent == 0) {
+                err("output_queue_send", "File ended before its queued length!");
+                total = -1;
+                break;
+            }
+            total += sent;
+            int full = (size_t) sent < segment->length;
+            output_queue_advance(queue, sent);
+            if (full) {
+                // the socket is full
+                break;
+            }
+            continue;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+        ssize_t sent = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            total = -1;
+            break;
+        }
+        total += sent;
+        output_queue_advance(queue, sent);
+
+        if ((size_t) sent < size) {
+            // the socket is full
+            break;
+        }
+    }
+
+    // a partial frame left in the cork would wait for the kernel's timer
+    if (corked) {
+        int disable = 0;
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_CORK, &disable, sizeof(disable));
+    }
+    return total;
+}
+
+/*
+ * Function: free_output_queue
+ *
+ * ---------------------------
+ *
+ *  Frees every segment and closes their files.
+ *
+ *  queue: pointer to the output queue.
+ */
+void free_output_queue(OutputQueue* queue) {
+    OutputSegment* segment = queue->head;
+    while (segment != NULL) {
+        OutputSegment* next = segment->next;
+        free_segment(queue, segment);
+        segment = next;
+    }
+    queue->head = NULL;
+    queue->tail = NULL;
+}
@@ -1,12 +1,287 @@
 #include "../include/polls.h"
 #include "../include/utils.h"
+#include "../include/uring.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
+#include <stdint.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#ifdef __linux__
+static unsigned int to_epoll_events(short events, PollTrigger trigger) {
+    unsigned int epoll_events = 0;
+    if (events & POLLIN) epoll_events |= EPOLLIN | EPOLLRDHUP;
+    if (events & POLLOUT) epoll_events |= EPOLLOUT;
+    if (trigger == POLL_TRIGGER_EDGE) epoll_events |= EPOLLET;
+    return epoll_events;
+}
+
+static short from_epoll_events(unsigned int epoll_events) {
+    short events = 0;
+    if (epoll_events & EPOLLIN) events |= POLLIN;
+    if (epoll_events & EPOLLOUT) events |= POLLOUT;
+    if (epoll_events & (EPOLLHUP | EPOLLRDHUP)) events |= POLLHUP;
+    if (epoll_events & EPOLLERR) events |= POLLERR;
+    return events;
+}
+
+// io_uring poll masks use the epoll bits.
+// One registered fd. The kernel holds user_data until the poll request
+// completes for good, so a deleted entry lives until then.
+struct uring_poll {
+    int fd;
+    short events;
+    void* data;
+    int armed;      // a poll request is in flight
+    int multishot;  // the request in flight keeps posting completions
+    int cancelling; // removal of the request in flight is queued
+    int deleted;    // fd removed from the list
+    int queued;     // on the unarmed list
+    size_t event_index;        // slot in pfds->events for this wait round
+    unsigned long long round;
+    struct uring_poll* next_unarmed;
+    struct uring_poll* prev;
+    struct uring_poll* next;
+};
+
+// The kernel always reports EPOLLRDHUP to io_uring polls, a one shot poll
+// without POLLIN would complete again as soon as it is re-armed after a
+// half close. Those are kept multishot so they only fire on wakeups.
+#define URING_CANCEL_TAG 1ULL
+// user data of the I/O requests, the pointer given to pfds_prepare
+#define URING_IO_TAG 2ULL
+#define URING_TAG_MASK 3ULL
+
+static int uring_poll_multishot(PollFd* pfds, short events) {
+    return pfds->trigger == POLL_TRIGGER_EDGE || !(events & POLLIN);
+}
+
+static int uring_poll_cancel(PollFd* pfds, struct uring_poll* poll) {
+    if (poll->cancelling) return 1;
+    struct io_uring_sqe* sqe = uring_get_sqe(pfds->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = (unsigned long long) (uintptr_t) poll;
+    // tagged so its completion can be told apart from the poll's own
+    sqe->user_data = (unsigned long long) (uintptr_t) poll | URING_CANCEL_TAG;
+    poll->cancelling = 1;
+    return 1;
+}
+
+static void uring_poll_queue(PollFd* pfds, struct uring_poll* poll) {
+    if (poll->queued) return;
+    poll->queued = 1;
+    poll->next_unarmed = pfds->unarmed;
+    pfds->unarmed = poll;
+}
+
+static void uring_poll_release(PollFd* pfds, struct uring_poll* poll) {
+    if (poll->prev != NULL) {
+        poll->prev->next = poll->next;
+    } else {
+        pfds->all = poll->next;
+    }
+    if (poll->next != NULL) poll->next->prev = poll->prev;
+    free(poll);
+}
+
+static int uring_poll_add(PollFd* pfds, int fd, short events, void* data) {
+    if ((size_t) fd >= pfds->max_polls) {
+        size_t new_size = pfds->max_polls > 0 ? pfds->max_polls : 64;
+        while (new_size <= (size_t) fd) new_size *= 2;
+        struct uring_poll** polls = realloc(pfds->polls, new_size * sizeof(struct uring_poll*));
+        if (polls == NULL) {
+            err("pfds_add", "Unable to allocate memory for io_uring polls!");
+            return -1;
+        }
+        memset(polls + pfds->max_polls, 0, (new_size - pfds->max_polls) * sizeof(struct uring_poll*));
+        pfds->polls = polls;
+        pfds->max_polls = new_size;
+    }
+
+    struct uring_poll* poll = calloc(1, sizeof(struct uring_poll));
+    if (poll == NULL) {
+        err("pfds_add", "Unable to allocate memory for io_uring poll!");
+        return -1;
+    }
+    poll->fd = fd;
+    poll->events = events;
+    poll->data = data;
+    poll->next = pfds->all;
+    if (pfds->all != NULL) pfds->all->prev = poll;
+    pfds->all = poll;
+    pfds->polls[fd] = poll;
+
+    // armed together with every other change on the next wait
+    uring_poll_queue(pfds, poll);
+    pfds->size++;
+    return 1;
+}
+
+static int uring_poll_mod(PollFd* pfds, int fd, short events, void* data) {
+    if ((size_t) fd >= pfds->max_polls || pfds->polls[fd] == NULL) {
+        return -1;
+    }
+
+    struct uring_poll* poll = pfds->polls[fd];
+    poll->data = data;
+    if (poll->events == events) {
+        return 1;
+    }
+    poll->events = events;
+    if (!poll->armed || poll->cancelling) {
+        // picked up when the poll is armed again
+        return 1;
+    }
+
+    int multishot = uring_poll_multishot(pfds, events);
+    if (multishot != poll->multishot) {
+        // updates only change the mask, the request is replaced instead
+        if (uring_poll_cancel(pfds, poll) == -1) {
+            err("pfds_mod", "Unable to queue io_uring poll removal!");
+            return -1;
+        }
+        return 1;
+    }
+
+    // updated in place, an already completed request is re-armed with the new mask anyway
+    struct io_uring_sqe* sqe = uring_get_sqe(pfds->ring);
+    if (sqe == NULL) {
+        err("pfds_mod", "Unable to queue io_uring poll update!");
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = (unsigned long long) (uintptr_t) poll;
+    sqe->poll32_events = to_epoll_events(events, POLL_TRIGGER_LEVEL);
+    sqe->len = IORING_POLL_UPDATE_EVENTS;
+    if (multishot) sqe->len |= IORING_POLL_ADD_MULTI;
+    return 1;
+}
+
+static int uring_poll_del(PollFd* pfds, int fd) {
+    if ((size_t) fd >= pfds->max_polls || pfds->polls[fd] == NULL) {
+        return -1;
+    }
+
+    struct uring_poll* poll = pfds->polls[fd];
+    pfds->polls[fd] = NULL;
+    poll->deleted = 1;
+    if (poll->armed) {
+        // the request pins the socket, it has to go before the close takes effect
+        uring_poll_cancel(pfds, poll);
+    } else if (!poll->queued && !poll->cancelling) {
+        uring_poll_release(pfds, poll);
+    }
+    pfds->size--;
+    return 1;
+}
+
+static int uring_poll_wait(PollFd* pfds, int timeout) {
+    pfds->wait_round++;
+
+    while (pfds->unarmed != NULL) {
+        struct uring_poll* poll = pfds->unarmed;
+        pfds->unarmed = poll->next_unarmed;
+        poll->queued = 0;
+        if (poll->deleted) {
+            if (!poll->cancelling) uring_poll_release(pfds, poll);
+            continue;
+        }
+
+        struct io_uring_sqe* sqe = uring_get_sqe(pfds->ring);
+        if (sqe == NULL) {
+            uring_poll_queue(pfds, poll);
+            err("pfds_wait", "Unable to queue io_uring poll!");
+            return -1;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = poll->fd;
+        sqe->poll32_events = to_epoll_events(poll->events, POLL_TRIGGER_LEVEL);
+        // one shot requests re-armed every round behave level triggered
+        poll->multishot = uring_poll_multishot(pfds, poll->events);
+        if (poll->multishot) sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = (unsigned long long) (uintptr_t) poll;
+        poll->armed = 1;
+    }
+
+    // submission of every change and the wait share one syscall
+    int result = uring_submit_and_wait(pfds->ring, timeout);
+    if (result <= 0) {
+        return result;
+    }
+
+    struct io_uring_cqe* cqe;
+    // what does not fit is left in the ring for the next wait
+    while (pfds->event_count < pfds->max_events && pfds->completion_count < POLL_MAX_EVENTS &&
+           (cqe = uring_peek_cqe(pfds->ring)) != NULL) {
+        unsigned long long user_data = cqe->user_data;
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+        int more = flags & IORING_CQE_F_MORE;
+        uring_cqe_seen(pfds->ring);
+
+        if (user_data & URING_IO_TAG) {
+            PollCompletion* completion = &pfds->completions[pfds->completion_count++];
+            completion->data = (void*) (uintptr_t) (user_data & ~URING_TAG_MASK);
+            completion->result = res;
+            completion->flags = flags;
+            if (!more) pfds->io_pending--;
+            continue;
+        }
+
+        // updates and cancellations of I/O requests complete with no user data
+        struct uring_poll* poll = (struct uring_poll*) (uintptr_t) (user_data & ~URING_TAG_MASK);
+        if (poll == NULL) continue;
+
+        if (user_data & URING_CANCEL_TAG) {
+            poll->cancelling = 0;
+            if (poll->armed && res != 0) {
+                // raced with an update still re-arming the request
+                uring_poll_cancel(pfds, poll);
+            } else if (!poll->armed && poll->deleted) {
+                uring_poll_release(pfds, poll);
+            }
+            continue;
+        }
+
+        if (!more) {
+            poll->armed = 0;
+            if (poll->deleted) {
+                if (!poll->cancelling) uring_poll_release(pfds, poll);
+                continue;
+            }
+            uring_poll_queue(pfds, poll);
+        }
+        if (poll->deleted || res <= 0) continue;
+
+        // drop the bits epoll would not have reported for this mask
+        res &= to_epoll_events(poll->events, POLL_TRIGGER_LEVEL) | EPOLLERR | EPOLLHUP;
+        if (res == 0) continue;
+
+        // multishot requests may complete more than once per round
+        if (poll->round == pfds->wait_round) {
+            pfds->events[poll->event_index].revents |= from_epoll_events(res);
+            continue;
+        }
+        poll->round = pfds->wait_round;
+        poll->event_index = pfds->event_count;
+        PollEvent* event = &pfds->events[pfds->event_count++];
+        event->data = poll->data;
+        event->revents = from_epoll_events(res);
+    }
+    return pfds->event_count + pfds->completion_count;
+}
+#endif
 
 /*
  * Function: init_pfds
@@ -17,22 +292,85 @@
  *
  *  pfds: pointer to the poll file descriptor list struct.
  *  initial_size: list's initial size.
+ *  backend: readiness backend (poll, epoll or io_uring).
+ *  trigger: level or edge triggered notifications.
  *
  *  returns: if failed (-1), on success (1).
  */
-int init_pfds(PollFd* pfds, size_t initial_size) {
-    if (pfds == NULL) {
+int init_pfds(PollFd* pfds, size_t initial_size, PollBackend backend, PollTrigger trigger) {
+    if (pfds == NULL || initial_size == 0) {
         return -1;
     }
 
-    pfds->items = malloc(sizeof(struct pollfd) * initial_size);
-    if (pfds->items == NULL) {
-        err("init_pfds", "Unable to allocate memory for pfds!");
-        return -1;
+#ifndef __linux__
+    if (backend == POLL_BACKEND_EPOLL || backend == POLL_BACKEND_URING) {
+        err("init_pfds", "epoll is not available, falling back to poll!");
+        backend = POLL_BACKEND_POLL;
     }
+#endif
 
-    pfds->max_size = initial_size;
+    pfds->backend = backend;
+    pfds->trigger = backend == POLL_BACKEND_POLL ? POLL_TRIGGER_LEVEL : trigger;
+    pfds->epoll_fd = -1;
+    pfds->items = NULL;
+    pfds->data = NULL;
+    pfds->events = NULL;
     pfds->size = 0;
+    pfds->max_size = 0;
+    pfds->event_count = 0;
+    pfds->ring = NULL;
+    pfds->polls = NULL;
+    pfds->max_polls = 0;
+    pfds->all = NULL;
+    pfds->unarmed = NULL;
+    pfds->wait_round = 0;
+    pfds->completion_io = 0;
+    pfds->buffers = NULL;
+    pfds->completions = NULL;
+    pfds->completion_count = 0;
+    pfds->io_pending = 0;
+
+    if (backend == POLL_BACKEND_POLL) {
+        pfds->items = malloc(sizeof(struct pollfd) * initial_size);
+        pfds->data = malloc(sizeof(void*) * initial_size);
+        pfds->events = malloc(sizeof(PollEvent) * initial_size);
+        if (pfds->items == NULL || pfds->data == NULL || pfds->events == NULL) {
+            err("init_pfds", "Unable to allocate memory for pfds!");
+            free_pfds(pfds);
+            return -1;
+        }
+        pfds->max_size = initial_size;
+        pfds->max_events = initial_size;
+        return 1;
+    }
+
+#ifdef __linux__
+    if (backend == POLL_BACKEND_URING) {
+        pfds->ring = malloc(sizeof(Uring));
+        if (pfds->ring == NULL || init_uring(pfds->ring) == -1) {
+            err("init_pfds", "io_uring is not available, falling back to epoll!");
+            free(pfds->ring);
+            pfds->ring = NULL;
+            pfds->backend = POLL_BACKEND_EPOLL;
+        }
+    }
+
+    if (pfds->backend == POLL_BACKEND_EPOLL) {
+        pfds->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (pfds->epoll_fd == -1) {
+            err("init_pfds", "Unable to create epoll instance!");
+            return -1;
+        }
+    }
+#endif
+
+    pfds->events = malloc(sizeof(PollEvent) * POLL_MAX_EVENTS);
+    if (pfds->events == NULL) {
+        err("init_pfds", "Unable to allocate memory for pfds events!");
+        free_pfds(pfds);
+        return -1;
+    }
+    pfds->max_events = POLL_MAX_EVENTS;
     return 1;
 }
 
@@ -45,87 +383,455 @@ int init_pfds(PollFd* pfds, size_t initial_size) {
  *
  *  pfds: Pointer to the Poll list.
  *  new_fd: File descriptor.
+ *  events: Requested events (POLLIN, POLLOUT).
+ *  data: Pointer returned with every ready event of the fd.
  *
  *  returns: if failed (-1), on success (1).
  */
-int pfds_add(PollFd* pfds, int new_fd) {
+int pfds_add(PollFd* pfds, int new_fd, short events, void* data) {
     if (pfds == NULL || new_fd < 0) {
         return -1;
     }
 
+#ifdef __linux__
+    if (pfds->backend == POLL_BACKEND_URING) {
+        return uring_poll_add(pfds, new_fd, events, data);
+    } else if (pfds->backend == POLL_BACKEND_EPOLL) {
+        struct epoll_event event;
+        event.events = to_epoll_events(events, pfds->trigger);
+        event.data.ptr = data;
+        if (epoll_ctl(pfds->epoll_fd, EPOLL_CTL_ADD, new_fd, &event) == -1) {
+            err("pfds_add", "Unable to add fd to the epoll instance!");
+            return -1;
+        }
+        pfds->size++;
+        return 1;
+    }
+#endif
+
     if (pfds->size + 1 >= pfds->max_size) {
         size_t new_size = pfds->max_size * 2;
-        pfds->items = realloc(pfds->items, new_size * sizeof(struct pollfd));
-        if (pfds->items == NULL) {
+        struct pollfd* items = realloc(pfds->items, new_size * sizeof(struct pollfd));
+        void** data_items = realloc(pfds->data, new_size * sizeof(void*));
+        PollEvent* poll_events = realloc(pfds->events, new_size * sizeof(PollEvent));
+        if (items != NULL) pfds->items = items;
+        if (data_items != NULL) pfds->data = data_items;
+        if (poll_events != NULL) pfds->events = poll_events;
+        if (items == NULL || data_items == NULL || poll_events == NULL) {
             err("pfds_add", "Unable to allocate memory for pfds list!");
             return -1;
         }
-        printf("pfds resized to max_size=%zu\n", new_size);
         pfds->max_size = new_size;
+        pfds->max_events = new_size;
     }
 
     pfds->items[pfds->size].fd = new_fd;
-    pfds->items[pfds->size].events = POLLIN;
+    pfds->items[pfds->size].events = events;
     pfds->items[pfds->size].revents = 0;
+    pfds->data[pfds->size] = data;
     pfds->size++;
-    printf("Added fd %d to pfds, size=%zu\n", new_fd, pfds->size);
     return 1;
 }
 
 /*
- * Function: pfds_del
+ * Function pfds_mod
  *
- * ------------------
+ * -----------------
+ *
+ *  Changes the requested events of a registered file descriptor.
+ *
+ *  pfds: Pointer to the Poll list.
+ *  fd: File descriptor.
+ *  events: Requested events (POLLIN, POLLOUT).
+ *  data: Pointer returned with every ready event of the fd.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_mod(PollFd* pfds, int fd, short events, void* data) {
+    if (pfds == NULL || fd < 0) {
+        return -1;
+    }
+
+#ifdef __linux__
+    if (pfds->backend == POLL_BACKEND_URING) {
+        return uring_poll_mod(pfds, fd, events, data);
+    } else if (pfds->backend == POLL_BACKEND_EPOLL) {
+        struct epoll_event event;
+        event.events = to_epoll_events(events, pfds->trigger);
+        event.data.ptr = data;
+        if (epoll_ctl(pfds->epoll_fd, EPOLL_CTL_MOD, fd, &event) == -1) {
+            err("pfds_mod", "Unable to modify fd in the epoll instance!");
+            return -1;
+        }
+        return 1;
+    }
+#endif
+
+    for (size_t i = 0; i < pfds->size; i++) {
+        if (pfds->items[i].fd == fd) {
+            pfds->items[i].events = events;
+            pfds->data[i] = data;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Function: pfds_unwatch
+ *
+ * ----------------------
  *
- *  Deletes and closes desired polls item.
+ *  Deletes desired polls item without closing its fd, for fds the
+ *  caller closes itself.
  *
  *  pfds: pointer to the polls list.
- *  index: item index.
+ *  fd: file descriptor of the item.
  *
  *  returns: if failed (-1), on success (1).
  */
-int pfds_del(PollFd* pfds, int index) {
-    if (pfds == NULL || index < 0 || index >= (int)pfds->size || pfds->size == 0) {
+int pfds_unwatch(PollFd* pfds, int fd) {
+    if (pfds == NULL || fd < 0 || pfds->size == 0) {
         return -1;
     }
 
-    if (pfds->items[index].fd >= 0) {
-        close(pfds->items[index].fd);
-        printf("Closed fd %d at index %d\n", pfds->items[index].fd, index);
+#ifdef __linux__
+    if (pfds->backend == POLL_BACKEND_URING) {
+        return uring_poll_del(pfds, fd);
+    } else if (pfds->backend == POLL_BACKEND_EPOLL) {
+        if (epoll_ctl(pfds->epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1) {
+            return -1;
+        }
+        pfds->size--;
+        return 1;
+    }
+#endif
+
+    size_t index;
+    for (index = 0; index < pfds->size; index++) {
+        if (pfds->items[index].fd == fd) break;
+    }
+    if (index == pfds->size) {
+        return -1;
     }
 
-    if (index < (int)(pfds->size - 1)) {
+    if (index < pfds->size - 1) {
         pfds->items[index] = pfds->items[pfds->size - 1];
+        pfds->data[index] = pfds->data[pfds->size - 1];
     }
 
     pfds->size--;
+    return 1;
+}
 
-    if (pfds->size > 0) {
-        pfds->items[pfds->size].fd = -1;
-        pfds->items[pfds->size].events = 0;
-        pfds->items[pfds->size].revents = 0;
+/*
+ * Function: pfds_del
+ *
+ * ------------------
+ *
+ *  Deletes and closes desired polls item. An fd that is not in the
+ *  list is left open.
+ *
+ *  pfds: pointer to the polls list.
+ *  fd: file descriptor of the item.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_del(PollFd* pfds, int fd) {
+    if (pfds_unwatch(pfds, fd) == -1) {
+        return -1;
     }
+    close(fd);
     return 1;
 }
 
+/*
+ * Function: pfds_wait
+ *
+ * -------------------
+ *
+ *  Waits for events and stores the ready ones in pfds->events, the
+ *  finished I/O requests in pfds->completions.
+ *
+ *  pfds: pointer to the poll list.
+ *  timeout: timeout in milliseconds, (-1) waits forever.
+ *
+ *  returns: number of ready events and completions. if failed (-1).
+ */
+int pfds_wait(PollFd* pfds, int timeout) {
+    if (pfds == NULL) {
+        return -1;
+    }
+    pfds->event_count = 0;
+    pfds->completion_count = 0;
+
+#ifdef __linux__
+    if (pfds->backend == POLL_BACKEND_URING) {
+        return uring_poll_wait(pfds, timeout);
+    } else if (pfds->backend == POLL_BACKEND_EPOLL) {
+        struct epoll_event epoll_events[POLL_MAX_EVENTS];
+        int ready = epoll_wait(pfds->epoll_fd, epoll_events, POLL_MAX_EVENTS, timeout);
+        if (ready == -1) {
+            return -1;
+        }
+        for (int i = 0; i < ready; i++) {
+            PollEvent* event = &pfds->events[i];
+            event->data = epoll_events[i].data.ptr;
+            event->revents = from_epoll_events(epoll_events[i].events);
+        }
+        pfds->event_count = ready;
+        return ready;
+    }
+#endif
+
+    int ready = poll(pfds->items, pfds->size, timeout);
+    if (ready <= 0) {
+        return ready;
+    }
+
+    // poll reports readiness in place, so the whole list has to be scanned.
+    for (size_t i = 0; i < pfds->size && pfds->event_count < (size_t) ready; i++) {
+        if (pfds->items[i].revents == 0) continue;
+        PollEvent* event = &pfds->events[pfds->event_count++];
+        event->revents = pfds->items[i].revents;
+        event->data = pfds->data[i];
+    }
+    return pfds->event_count;
+}
+
+/*
+ * Function: pfds_enable_io
+ *
+ * ------------------------
+ *
+ *  Lets the io_uring backend run socket I/O as requests whose completions
+ *  pfds_wait collects in pfds->completions, next to the ready events of
+ *  the polled fds. Registers the receive buffers the kernel picks from.
+ *
+ *  pfds: pointer to the poll list.
+ *  buffer_count: number of receive buffers, a power of two.
+ *  buffer_size: bytes per receive buffer.
+ *
+ *  returns: if failed or not supported (-1), on success (1).
+ */
+int pfds_enable_io(PollFd* pfds, size_t buffer_count, size_t buffer_size) {
+    if (pfds == NULL || pfds->backend != POLL_BACKEND_URING) {
+        return -1;
+    }
+#ifdef __linux__
+    pfds->completions = malloc(sizeof(PollCompletion) * POLL_MAX_EVENTS);
+    pfds->buffers = malloc(sizeof(UringBuffers));
+    // buffer rings came with Linux 5.19, like multishot accept
+    if (pfds->completions == NULL || pfds->buffers == NULL ||
+        init_uring_buffers(pfds->ring, pfds->buffers, POLL_BUFFER_GROUP, buffer_count, buffer_size) == -1) {
+        free(pfds->completions);
+        free(pfds->buffers);
+        pfds->completions = NULL;
+        pfds->buffers = NULL;
+        return -1;
+    }
+    pfds->completion_io = 1;
+    return 1;
+#else
+    (void) buffer_count;
+    (void) buffer_size;
+    return -1;
+#endif
+}
+
+/*
+ * Function: pfds_reserve
+ *
+ * ----------------------
+ *
+ *  Makes room for count requests, so linked ones are submitted together.
+ *
+ *  pfds: pointer to the poll list.
+ *  count: number of requests.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_reserve(PollFd* pfds, unsigned count) {
+#ifdef __linux__
+    if (pfds != NULL && pfds->completion_io) {
+        return uring_reserve(pfds->ring, count);
+    }
+#endif
+    (void) count;
+    return -1;
+}
+
+/*
+ * Function: pfds_prepare
+ *
+ * ----------------------
+ *
+ *  Queues an I/O request, submitted with the next wait. The caller fills
+ *  in the operation, its completions are reported with data.
+ *
+ *  pfds: pointer to the poll list.
+ *  data: pointer reported with the completions, 4 byte aligned.
+ *
+ *  returns: pointer to the submission entry. if failed, NULL.
+ */
+struct io_uring_sqe* pfds_prepare(PollFd* pfds, void* data) {
+#ifdef __linux__
+    if (pfds != NULL && pfds->completion_io && data != NULL) {
+        struct io_uring_sqe* sqe = uring_get_sqe(pfds->ring);
+        if (sqe == NULL) {
+            err("pfds_prepare", "Unable to queue io_uring request!");
+            return NULL;
+        }
+        sqe->user_data = (unsigned long long) (uintptr_t) data | URING_IO_TAG;
+        pfds->io_pending++;
+        return sqe;
+    }
+#endif
+    (void) data;
+    return NULL;
+}
+
+/*
+ * Function: pfds_cancel
+ *
+ * ---------------------
+ *
+ *  Queues the cancellation of the request made with data. The request
+ *  still completes, with -ECANCELED unless it finished first.
+ *
+ *  pfds: pointer to the poll list.
+ *  data: pointer the request was prepared with.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_cancel(PollFd* pfds, void* data) {
+#ifdef __linux__
+    if (pfds != NULL && pfds->completion_io) {
+        struct io_uring_sqe* sqe = uring_get_sqe(pfds->ring);
+        if (sqe == NULL) {
+            err("pfds_cancel", "Unable to queue io_uring cancellation!");
+            return -1;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (unsigned long long) (uintptr_t) data | URING_IO_TAG;
+        return 1;
+    }
+#endif
+    (void) data;
+    return -1;
+}
+
+/*
+ * Function: pfds_submit
+ *
+ * ---------------------
+ *
+ *  Submits the queued requests right away instead of with the next wait.
+ *
+ *  pfds: pointer to the poll list.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int pfds_submit(PollFd* pfds) {
+#ifdef __linux__
+    if (pfds != NULL && pfds->ring != NULL) {
+        return uring_submit(pfds->ring);
+    }
+#endif
+    return pfds != NULL ? 1 : -1;
+}
+
+/*
+ * Function: pfds_buffer
+ *
+ * ---------------------
+ *
+ *  Returns the receive buffer holding a completion's data.
+ *
+ *  pfds: pointer to the poll list.
+ *  completion: finished receive request.
+ *
+ *  returns: pointer to the data. NULL if the completion has no buffer.
+ */
+char* pfds_buffer(PollFd* pfds, const PollCompletion* completion) {
+#ifdef __linux__
+    if (pfds != NULL && pfds->buffers != NULL && (completion->flags & IORING_CQE_F_BUFFER)) {
+        return uring_buffer(pfds->buffers, (unsigned short) (completion->flags >> IORING_CQE_BUFFER_SHIFT));
+    }
+#endif
+    (void) completion;
+    return NULL;
+}
+
+/*
+ * Function: pfds_release_buffer
+ *
+ * -----------------------------
+ *
+ *  Hands a completion's receive buffer back to the kernel, if it has one.
+ *
+ *  pfds: pointer to the poll list.
+ *  completion: finished receive request.
+ */
+void pfds_release_buffer(PollFd* pfds, const PollCompletion* completion) {
+#ifdef __linux__
+    if (pfds != NULL && pfds->buffers != NULL && (completion->flags & IORING_CQE_F_BUFFER)) {
+        uring_buffer_release(pfds->buffers, (unsigned short) (completion->flags >> IORING_CQE_BUFFER_SHIFT));
+    }
+#endif
+    (void) completion;
+}
+
 /*
  * Function: free_pfds
  *
  * -------------------
  *
- *  Frees poll list.
+ *  Frees poll list. Registered file descriptors are left open.
  *
  *  pfds: pointer to the poll list.
  */
 void free_pfds(PollFd* pfds) {
-if (pfds == NULL) return;
-    for (size_t i = 0; i < pfds->size; i++) {
-        if (pfds->items[i].fd >= 0) {
-            close(pfds->items[i].fd);
-        }
+    if (pfds == NULL) return;
+    if (pfds->epoll_fd >= 0) {
+        close(pfds->epoll_fd);
+    }
+#ifdef __linux__
+    if (pfds->buffers != NULL) {
+        free_uring_buffers(pfds->ring, pfds->buffers);
+        free(pfds->buffers);
+    }
+    // closing the ring cancels the requests still holding polls
+    if (pfds->ring != NULL) {
+        free_uring(pfds->ring);
+        free(pfds->ring);
+    }
+    while (pfds->all != NULL) {
+        struct uring_poll* poll = pfds->all;
+        pfds->all = poll->next;
+        free(poll);
     }
+    free(pfds->polls);
+    pfds->ring = NULL;
+    pfds->polls = NULL;
+    pfds->max_polls = 0;
+    pfds->unarmed = NULL;
+    pfds->buffers = NULL;
+    pfds->completion_io = 0;
+    pfds->io_pending = 0;
+#endif
     free(pfds->items);
+    free(pfds->completions);
+    pfds->completions = NULL;
+    pfds->completion_count = 0;
+    free(pfds->data);
+    free(pfds->events);
     pfds->items = NULL;
+    pfds->data = NULL;
+    pfds->events = NULL;
+    pfds->epoll_fd = -1;
     pfds->size = 0;
     pfds->max_size = 0;
+    pfds->event_count = 0;
 }
@@ -0,0 +1,124 @@
+#include "../include/range.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <strings.h>
+
+// reads a run of digits, (0) if there is none, (-1) on overflow
+static int parse_position(const char** cursor, size_t* value) {
+    const char* c = *cursor;
+    size_t result = 0;
+    if (!isdigit((unsigned char) *c)) {
+        return 0;
+    }
+    for (; isdigit((unsigned char) *c); c++) {
+        size_t digit = *c - '0';
+        if (result > (SIZE_MAX - digit) / 10) {
+            return -1;
+        }
+        result = result * 10 + digit;
+    }
+    *cursor = c;
+    *value = result;
+    return 1;
+}
+
+static const char* skip_whitespace(const char* c) {
+    while (*c == ' ' || *c == '\t') c++;
+    return c;
+}
+
+/*
+ * Function: parse_byte_ranges
+ *
+ * ---------------------------
+ *
+ *  Parses the value of a Range header against a representation of the
+ *  given size. Ranges past the end are dropped, ends past it are clamped
+ *  and suffix ranges are resolved from the end.
+ *
+ *  value: Range header value, e.g. "bytes=0-99, -500".
+ *  size: size of the representation in bytes.
+ *  ranges: receives the satisfiable ranges, in request order.
+ *  max_ranges: capacity of ranges.
+ *
+ *  returns: number of satisfiable ranges, none of them (0). if the header
+ *           is malformed or asks for too many ranges (-1), it is ignored.
+ */
+int parse_byte_ranges(const char* value, size_t size, ByteRange* ranges, size_t max_ranges) {
+    if (value == NULL || ranges == NULL) {
+        return -1;
+    }
+
+    const char* c = skip_whitespace(value);
+    if (strncasecmp(c, "bytes", 5) != 0) {
+        return -1;
+    }
+    c = skip_whitespace(c + 5);
+    if (*c != '=') {
+        return -1;
+    }
+    c++;
+
+    size_t count = 0;
+    size_t specs = 0;
+    while (1) {
+        c = skip_whitespace(c);
+        // empty list elements are allowed
+        if (*c == ',') {
+            c++;
+            continue;
+        }
+        if (*c == '\0') {
+            break;
+        }
+        if (++specs > max_ranges) {
+            return -1;
+        }
+
+        size_t first = 0;
+        size_t last = 0;
+        int has_first = parse_position(&c, &first);
+        if (has_first == -1 || *c != '-') {
+            return -1;
+        }
+        c++;
+        int has_last = parse_position(&c, &last);
+        if (has_last == -1 || (has_first == 0 && has_last == 0)) {
+            return -1;
+        }
+        c = skip_whitespace(c);
+        if (*c != ',' && *c != '\0') {
+            return -1;
+        }
+
+        if (has_first) {
+            if (has_last && last < first) {
+                return -1;
+            }
+            if (first >= size) {
+                continue;
+            }
+            if (!has_last || last >= size) {
+                last = size - 1;
+            }
+            ranges[count].start = first;
+            ranges[count].length = last - first + 1;
+            count++;
+        } else {
+            // the last bytes of the representation
+            if (last == 0 || size == 0) {
+                continue;
+            }
+            size_t length = last < size ? last : size;
+            ranges[count].start = size - length;
+            ranges[count].length = length;
+            count++;
+        }
+    }
+
+    if (specs == 0) {
+        return -1;
+    }
+    return count;
+}
@@ -1,415 +1,353 @@
 #include "../include/request.h"
+#include "../include/scan.h"
 #include "../include/utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 
+static void set_view(StringView* view, size_t start, size_t end) {
+    view->offset = start;
+    view->size = end - start;
+}
+
 /*
- * Function: init_lines
+ * Function: init_http_parser
  *
- * --------------------
+ * --------------------------
  *
- *  Initiates line list.
+ *  Prepares the parser for a new request.
  *
- *  line_arr: pointer to the line list.
- *  initial_size: initial list size.
- *
- *  returns: if failed (-1), on success (1).
+ *  parser: pointer to the parser.
  */
-int init_lines(LineArray* line_arr, size_t initial_size) {
-    if (line_arr == NULL) {
-        return -1;
-    }
-
-    line_arr->lines = malloc(sizeof(char*) * initial_size);
-    if (line_arr->lines == NULL) {
-        err("init_lines", "Unable to allocate memory for lines!");
-        return -1;
-    }
-    // Initialize pointers to NULL
-    for (size_t i = 0; i < initial_size; i++) {
-        line_arr->lines[i] = NULL;
-    }
-
-    line_arr->max_size = initial_size;
-    line_arr->size = 0;
-    return 1;
+void init_http_parser(HTTPParser* parser) {
+    parser->state = HTTP_PARSE_METHOD;
+    parser->offset = 0;
+    parser->token_start = 0;
 }
 
 /*
- * Function: insert_line
+ * Function: parse_header
  *
- * ---------------------
+ * ----------------------
  *
- *  Adds line to the list.
+ *  Parses the request line and header fields in a single pass, resuming
+ *  where the previous call stopped. Nothing is copied or allocated, the
+ *  request records views into data and terminates them in place. Long
+ *  tokens are skipped with the vectorized scanners.
  *
- *  line_arr: pointer to the list.
- *  data: line data.
- *  size: line lenght.
+ *  parser: pointer to the parser state.
+ *  req: pointer to the HTTPRequest struct.
+ *  data: raw request bytes, may have moved since the previous call.
+ *  size: number of bytes received so far.
  *
- *  returns: length of the inserted line.
+ *  returns: if malformed (-1), incomplete (0), header complete (1).
  */
-ssize_t insert_line(LineArray* line_arr, const char* data, size_t size) {
-    if (line_arr == NULL || line_arr->lines == NULL) {
+int parse_header(HTTPParser* parser, HTTPRequest* req, char* data, size_t size) {
+    if (parser == NULL || req == NULL || data == NULL) {
         return -1;
     }
 
-    // check overflow
-    if (line_arr->size >= line_arr->max_size) {
-        // increase line_arr size
-        size_t new_size =  2 * line_arr->max_size;
-        // printf("new_size = %zu; 2 * %zu -> %zu : %p->%p\n", new_size, line_arr->max_size, new_size * sizeof(char*), line_arr->lines, *(line_arr->lines));
-        line_arr->lines = realloc(line_arr->lines, new_size * sizeof(char*));
-        if (line_arr->lines == NULL) {
-            err("insert_line", "Unable to allocate memory for lines!");
-            return -1;
-        }
-        line_arr->max_size = new_size;
+    HTTPRequestHeader* req_header = &req->http_header;
+    req->data = data;
+    size_t i = parser->offset;
+    while (i < size && parser->state != HTTP_PARSE_DONE) {
+        unsigned char c;
+        switch (parser->state) {
+        case HTTP_PARSE_METHOD:
+            i += scan_name_end(data + i, size - i);
+            if (i == size) continue;
+            c = data[i];
+            if (c == ' ' && i > parser->token_start) {
+                set_view(&req_header->method, parser->token_start, i);
+                data[i] = '\0';
+                parser->token_start = i + 1;
+                parser->state = HTTP_PARSE_PATH;
+            } else if ((c == '\r' || c == '\n') && i == parser->token_start) {
+                // empty lines before the request line are ignored
+                parser->token_start = i + 1;
+            } else {
+                return -1;
+            }
+            break;
 
-        // Initialize new pointers to NULL
-        for (size_t i = line_arr->size; i < line_arr->max_size; i++) {
-            line_arr->lines[i] = NULL;
+        case HTTP_PARSE_PATH:
+            i += scan_token_end(data + i, size - i);
+            if (i == size) continue;
+            if (data[i] != ' ' || i == parser->token_start) {
+                return -1;
+            }
+            set_view(&req_header->path, parser->token_start, i);
+            data[i] = '\0';
+            parser->token_start = i + 1;
+            parser->state = HTTP_PARSE_VERSION;
+            break;
+
+        case HTTP_PARSE_VERSION:
+            i += scan_token_end(data + i, size - i);
+            if (i == size) continue;
+            c = data[i];
+            if (c != '\r' && c != '\n') {
+                return -1;
+            }
+            size_t version_size = i - parser->token_start;
+            if (version_size < 6 || version_size > 10 || strncmp(data + parser->token_start, "HTTP/", 5) != 0) {
+                return -1;
+            }
+            set_view(&req_header->http_version, parser->token_start, i);
+            data[i] = '\0';
+            parser->state = c == '\r' ? HTTP_PARSE_LINE_LF : HTTP_PARSE_FIELD_START;
+            break;
+
+        case HTTP_PARSE_LINE_LF:
+            if (data[i] != '\n') {
+                return -1;
+            }
+            parser->state = HTTP_PARSE_FIELD_START;
+            break;
+
+        case HTTP_PARSE_FIELD_START:
+            c = data[i];
+            if (c == '\r') {
+                parser->state = HTTP_PARSE_HEADER_LF;
+                break;
+            } else if (c == '\n') {
+                parser->state = HTTP_PARSE_DONE;
+                break;
+            }
+            if (req_header->field_count == MAX_HEADER_FIELDS) {
+                return -1;
+            }
+            parser->token_start = i;
+            parser->state = HTTP_PARSE_FIELD_NAME;
+            /* fall through */
+
+        case HTTP_PARSE_FIELD_NAME:
+            i += scan_name_end(data + i, size - i);
+            if (i == size) continue;
+            // obsolete line folding starts with whitespace and ends up here as an empty name
+            if (data[i] != ':' || i == parser->token_start) {
+                return -1;
+            }
+            set_view(&req_header->fields[req_header->field_count].name, parser->token_start, i);
+            data[i] = '\0';
+            int id = http_header_id(data + parser->token_start, i - parser->token_start);
+            if (id != -1) {
+                // a second length, coding or host could be read differently by another hop
+                if (req_header->known[id] != 0 && (id == HTTP_HEADER_CONTENT_LENGTH || id == HTTP_HEADER_HOST ||
+                                                   id == HTTP_HEADER_TRANSFER_ENCODING)) {
+                    return -1;
+                }
+                if (req_header->known[id] == 0) {
+                    req_header->known[id] = req_header->field_count + 1;
+                }
+            }
+            parser->state = HTTP_PARSE_VALUE_START;
+            break;
+
+        case HTTP_PARSE_VALUE_START:
+            c = data[i];
+            if (c == ' ' || c == '\t') {
+                break;
+            }
+            parser->token_start = i;
+            parser->state = HTTP_PARSE_FIELD_VALUE;
+            /* fall through */
+
+        case HTTP_PARSE_FIELD_VALUE:
+            i += scan_field_end(data + i, size - i);
+            if (i == size) continue;
+            c = data[i];
+            if (c != '\r' && c != '\n') {
+                return -1;
+            }
+            // trailing whitespace is not part of the value
+            size_t value_end = i;
+            while (value_end > parser->token_start && (data[value_end - 1] == ' ' || data[value_end - 1] == '\t')) {
+                value_end--;
+            }
+            set_view(&req_header->fields[req_header->field_count].value, parser->token_start, value_end);
+            data[value_end] = '\0';
+            req_header->field_count++;
+            parser->state = c == '\r' ? HTTP_PARSE_LINE_LF : HTTP_PARSE_FIELD_START;
+            break;
+
+        case HTTP_PARSE_HEADER_LF:
+            if (data[i] != '\n') {
+                return -1;
+            }
+            parser->state = HTTP_PARSE_DONE;
+            break;
+
+        case HTTP_PARSE_DONE:
+            break;
         }
+        i++;
     }
 
-    // insert new line
-    line_arr->lines[line_arr->size] = malloc(size + 1);
-    if (line_arr->lines[line_arr->size] == NULL) {
-        err("insert_line", "Unable to allocate memory for the new line!");
-        return -1;
-    }
-    strncpy(line_arr->lines[line_arr->size], data, size);
-    line_arr->lines[line_arr->size++][size] = '\0';
-    return strlen(line_arr->lines[line_arr->size - 1]);
+    parser->offset = i;
+    return parser->state == HTTP_PARSE_DONE ? 1 : 0;
 }
 
 /*
- * Function: free_lines
+ * Function: http_req_method
+ *
+ * -------------------------
  *
- * --------------------
+ *  Returns the request method.
  *
- *  Frees line list.
+ *  req: pointer to the parsed http request.
  *
- *  line_arr: pointer to the line list.
+ *  returns: method string.
  */
-void free_lines(LineArray* line_arr) {
-    if (line_arr == NULL || line_arr->lines == NULL) {
-        return;
-    }
-
-    // Free each string
-    for (size_t i = 0; i < line_arr->size; i++) {
-        free(line_arr->lines[i]);
-    }
-
-    // Free the array of pointers
-    free(line_arr->lines);
-    line_arr->lines = NULL;
-    line_arr->size = 0;
-    line_arr->max_size = 0;
+const char* http_req_method(const HTTPRequest* req) {
+    return req->data ? req->data + req->http_header.method.offset : "";
 }
 
 /*
- * Function: print_http_req
+ * Function: http_req_path
  *
- * ------------------------
+ * -----------------------
  *
- *  Prints HTTP request data.
+ *  Returns the request target.
  *
- *  req: pointer to the http request.
+ *  req: pointer to the parsed http request.
+ *
+ *  returns: path string.
  */
-void print_http_req(HTTPRequest* req) {
-    HTTPRequestHeader* req_header = &req->http_header;
-    printf("Method: [%s]\n", req_header->method);
-    printf("URI: [%s]\n", req_header->path);
-    printf("HTTP Version: [%s]\n", req_header->http_version);
-
-    for (ListItem* i = req_header->header_fields->items; i != NULL; i = i->next) {
-        printf("[%s]:[%s]\n", i->key, (char*) i->value);
-    }
+const char* http_req_path(const HTTPRequest* req) {
+    return req->data ? req->data + req->http_header.path.offset : "";
 }
 
 /*
- * Function: http_req_to_LineArray
+ * Function: http_req_version
  *
- * -------------------------------
+ * --------------------------
  *
- *  Converts raw http requests to lines.
+ *  Returns the protocol version of the request line.
  *
- *  req_raw: raw http request.
- *  line_arr: pointer to the line list.
+ *  req: pointer to the parsed http request.
  *
- *  returns: number of lines.
+ *  returns: version string.
  */
-size_t http_req_to_LineArray(const char* req_raw, LineArray* line_arr) {
-    short line_condition = 0; // if = 2, line has ended with '\r\n'
-    ssize_t line_size = 0;
-    const char* line_start = req_raw;
-
-    for (const char* i_ptr = req_raw; i_ptr != NULL && *i_ptr != '\0'; i_ptr++) {
-        if (*i_ptr == '\r') {
-            line_condition = 1;
-            continue;
-        } else if (*i_ptr == '\n' && line_condition == 1) {
-            line_condition = 2;
-        } else {
-            line_condition = 0;
-        }
-
-        if (line_condition == 2 || *(i_ptr + 1) == '\0') {
-            if (line_size > 0) {
-                if (insert_line(line_arr, line_start, line_size) != line_size) {
-                    err("http_req_to_LineArray", "Unable to insert new line!");
-                    printf("\tline: %zu\n", line_arr->size + 1);
-                    continue;
-                }
-                line_condition = 0;
-                line_size = 0;
-                line_start = i_ptr + 1;
-                continue;
-            }
-        }
-        line_size++;
-    }
-
-    return line_arr->size;
+const char* http_req_version(const HTTPRequest* req) {
+    return req->data ? req->data + req->http_header.http_version.offset : "";
 }
 
 /*
- * Function: parse_request_line
+ * Function: http_req_known_header
  *
- * ----------------------------
+ * -------------------------------
  *
- *  Parses the first line of the HTTP request.
+ *  Returns a well-known header from its fixed slot.
  *
- *  req_line: pointer to the string data of the first line.
- *  req_header: pointer to the HTTPRequestHeader struct.
+ *  req: pointer to the parsed http request.
+ *  id: header id.
  *
- *  returns: if failed (-1), on success (1).
+ *  returns: field value of its first occurrence. if not sent, NULL.
  */
-int parse_request_line(const char* req_line, HTTPRequestHeader* req_header) {
-    // printf("line: %s\n", req_line);
-    size_t keyword_size = 0;
-    int keyword_counter = 0;
-    for (const char* i = req_line; i != NULL && *i != '\0'; i++) {
-        if (*i == ' ' || *(i + 1) == '\0') {
-            // ignore trailing whitespaces
-            if (keyword_size == 0) continue;
-
-            keyword_counter++;
-
-            char* dest;
-            size_t dest_size;
-            if (keyword_counter == 1) {
-                dest = req_header->method;
-                dest_size = sizeof(req_header->method);
-            } else if (keyword_counter == 2) {
-                req_header->path = malloc(sizeof(char) * keyword_size + 1);
-                if (req_header->path  == NULL) {
-                    err("parse_header", "Unable to allocate memory for path!");
-                    return -1;
-                }
-                dest = req_header->path;
-                dest_size = sizeof(char) * keyword_size + 1;
-            } else if (keyword_counter == 3) {
-                dest = req_header->http_version;
-                dest_size = sizeof(req_header->http_version);
-            } else {
-                break;
-            }
-
-            if (keyword_size > dest_size) {
-                if (keyword_counter == 2) {
-                    free(dest);
-                    err("parse_request_line", "Keyword is larger than destination size!");
-                    return -1;
-                }
-            }
-
-            const char* keyword_beg = i - keyword_size;
-            strncpy(dest, keyword_beg, keyword_size + 1);
-
-            // if i is near the end of cstring, include i
-            if (*(i + 1) == '\0') keyword_size++; 
-            dest[keyword_size] = '\0';
-            keyword_size = 0;
-            continue;
-        }
-        keyword_size++;
+const char* http_req_known_header(const HTTPRequest* req, HTTPHeaderId id) {
+    if (req == NULL || req->data == NULL || id < 0 || id >= HTTP_HEADER_COUNT) {
+        return NULL;
     }
 
-    if (keyword_counter != 3) {
-        err("parse_request_line", "Invalid request line!");
-        return -1;
+    unsigned char slot = req->http_header.known[id];
+    if (slot == 0) {
+        return NULL;
     }
-    return 1;
+    return req->data + req->http_header.fields[slot - 1].value.offset;
 }
 
 /*
- * Function: parse_header_fields
+ * Function: http_req_header
  *
- * -----------------------------
+ * -------------------------
  *
- *  Parse's HTTP Request headers to a list of key-values.
+ *  Looks up a header field, names are compared case-insensitively. Known
+ *  headers are read from their slot, others are searched for.
  *
- *  line_arr: pointer to the line list.
- *  header_fields: pointer to the header fields list.
+ *  req: pointer to the parsed http request.
+ *  name: field name.
  *
- *  returns: number of header fields. if failed (-1).
+ *  returns: field value of the first match. if not found, NULL.
  */
-int parse_header_fields(const LineArray* line_arr, List* header_fields) {
-    for (size_t i = 1; i < line_arr->size; i++) {
-        // printf("[%s]\n", line_arr->lines[i]);
-
-        // Check for empty line
-        if (strlen(line_arr->lines[i]) == 0) {
-            break;
-        }
-
-        size_t value_size = 0;
-        char* key = NULL;
-        char* value = NULL;
-        char* j_ptr;
-
-        // get header key
-        for (j_ptr = line_arr->lines[i]; j_ptr != NULL && *j_ptr != '\0'; j_ptr++) {
-            if (*j_ptr == ':') {
-                char* key_beg = j_ptr - value_size;
-
-                key = malloc(sizeof(char) * value_size + 1);
-                if (key == NULL) {
-                    err("parse_header", "Unable to allocate memory for header key!");
-                    return -1;
-                }
-
-                // store field-name
-                strncpy(key, key_beg, value_size);
-                key[value_size] = '\0';
+const char* http_req_header(const HTTPRequest* req, const char* name) {
+    if (req == NULL || req->data == NULL || name == NULL) {
+        return NULL;
+    }
 
-                // prepare for recording value of the field
-                value_size = 0;
-                j_ptr++;
-                break;
-            }
-            value_size++;
-        }
+    size_t name_size = strlen(name);
+    int id = http_header_id(name, name_size);
+    if (id != -1) {
+        return http_req_known_header(req, id);
+    }
 
-        // check if field-name is stored (i.e incomplete requests)
-        if (key == NULL) {
-            err("parse_header_fields", "Invalid Header!");
-            printf("\tline[%zu]: %s\n", i, line_arr->lines[i]);
-            continue;
+    const HTTPRequestHeader* req_header = &req->http_header;
+    for (size_t i = 0; i < req_header->field_count; i++) {
+        const HTTPHeaderField* field = &req_header->fields[i];
+        if (field->name.size == name_size && strncasecmp(req->data + field->name.offset, name, name_size) == 0) {
+            return req->data + field->value.offset;
         }
+    }
+    return NULL;
+}
 
-        // get field value
-        int beg_ows_counter = 0; // number of optional whitespaces in the begining
-        int end_ows_counter = 0; // number of optional whitespaces at the end
-        int recording_beg_ows = 1; // flag for counting whitespaces in the begining
-        for (; j_ptr != NULL && *j_ptr != '\0'; j_ptr++) {
-            // trim begining and ending whitespaces
-            if (*j_ptr == ' ') {
-                // if ows is in the begining
-                if (recording_beg_ows == 1) {
-                    beg_ows_counter++;
-                } else {
-                    end_ows_counter++;
-                }
-            } else {
-                // reset counter on non whitespace character
-                recording_beg_ows = 0;
-                end_ows_counter = 0;
-            }
-            value_size++;
-        }
-
-        if (value_size > 0) {
-            char* value_beg = j_ptr + beg_ows_counter - value_size;
-            size_t trimed_value_size = value_size - beg_ows_counter - end_ows_counter;
-
-            value = malloc(sizeof(char) * trimed_value_size + 1);
-            if (value == NULL) {
-                err("parse_header", "Unable to allocate memory for header key!");
-                free(key);
-                return -1;
-            }
-
-            // store field-value
-            strncpy(value, value_beg, trimed_value_size);
-            value[trimed_value_size] = '\0';
-        }
+/*
+ * Function: print_http_req
+ *
+ * ------------------------
+ *
+ *  Prints HTTP request data.
+ *
+ *  req: pointer to the http request.
+ */
+void print_http_req(HTTPRequest* req) {
+    HTTPRequestHeader* req_header = &req->http_header;
+    printf("Method: [%s]\n", http_req_method(req));
+    printf("URI: [%s]\n", http_req_path(req));
+    printf("HTTP Version: [%s]\n", req->data ? req->data + req_header->http_version.offset : "");
 
-        // Add field to the list
-        if (list_set_item(header_fields, key, value, value_size) == -1) {
-            err("parse_header", "Unable to insert the item!");
-            printf("\tline[%zu]: %s\n", i, line_arr->lines[i]);
-            free(key);
-            free(value);
-            continue;
-        }
-        free(key);
-        free(value);
+    for (size_t i = 0; i < req_header->field_count; i++) {
+        printf("[%s]:[%s]\n", req->data + req_header->fields[i].name.offset,
+               req->data + req_header->fields[i].value.offset);
     }
-
-    return header_fields->size;
 }
 
 /*
- * Function: parse_header
+ * Function: http_req_keep_alive
  *
- * ----------------------
+ * -----------------------------
  *
- *  Parses raw http request headers.
+ *  Checks whether the client wants a persistent connection. HTTP/1.1
+ *  connections persist unless "Connection: close" is sent, HTTP/1.0 ones
+ *  only with "Connection: keep-alive".
  *
- *  req: pointer to the HTTPRequest struct.
- *  req_data: pointer to the raw request data.
+ *  req: pointer to the parsed http request.
  *
- *  returns: if failed (-1), on success (1). 
+ *  returns: persistent (1), close after the response (0).
  */
-int parse_header(HTTPRequest* req, const char* req_data) {
-    LineArray line_arr;
-    int result = init_lines(&line_arr, 4);
-    if (result == -1) {
-        return -1;
-    }
+int http_req_keep_alive(HTTPRequest* req) {
+    int keep_alive = strcmp(http_req_version(req), "HTTP/1.1") == 0;
 
-    http_req_to_LineArray(req_data, &line_arr);
-
-    if (line_arr.size == 0) {
-        err("parse_header", "No lines parsed!");
-        free_lines(&line_arr);
-        return -1;
-    }
-
-    // Parse first line
-    result = parse_request_line(line_arr.lines[0], &req->http_header);
-    if (result == -1) {
-        free_lines(&line_arr);
-        return -1;
+    const char* token = http_req_known_header(req, HTTP_HEADER_CONNECTION);
+    if (token == NULL) {
+        return keep_alive;
     }
 
-    List* header_fields = malloc(sizeof(List));
-    if (header_fields == NULL) {
-        err("parse_header", "Unable to allocate memory for header fields!");
-        free_lines(&line_arr);
-        return -1;
-    }
-    header_fields->items = NULL;
-    header_fields->size = 0;
-
-    // Parse the rest of the fields
-    result = parse_header_fields(&line_arr, header_fields);
-    if (result == -1) {
-        free_lines(&line_arr);
-        free(header_fields);
-        return -1;
+    // the field is a comma separated list of options
+    while (*token != '\0') {
+        while (*token == ' ' || *token == ',') token++;
+        size_t token_size = strcspn(token, ", ");
+        if (token_size == 5 && strncasecmp(token, "close", 5) == 0) {
+            return 0;
+        } else if (token_size == 10 && strncasecmp(token, "keep-alive", 10) == 0) {
+            keep_alive = 1;
+        }
+        token += token_size;
     }
-
-    req->http_header.header_fields = header_fields;
-
-    free_lines(&line_arr);
-    return 1;
+    return keep_alive;
 }
 
 /*
@@ -417,124 +355,120 @@ int parse_header(HTTPRequest* req, const char* req_data) {
  *
  * -----------------------
  *
- *  Frees HTTP Request struct.
+ *  Frees HTTP Request struct and forgets its parsed views. Everything
+ *  allocated from the request's arena goes with it.
  *
  *  req: pointer to the http request struct.
  */
 void free_http_req(HTTPRequest* req) {
-    if (req->body != NULL) {
-        free(req->body);
-    }
+    free_request_body(&req->body);
 
+    // the views point into the connection's buffer, nothing else to free
     HTTPRequestHeader* req_header = &req->http_header;
-    if (req_header->path != NULL) {
-        free(req_header->path);
-    }
-    if (req_header->header_fields != NULL) {
-        free_list(req_header->header_fields);
-        free(req_header->header_fields);
+    memset(&req_header->method, 0, sizeof(StringView));
+    memset(&req_header->path, 0, sizeof(StringView));
+    memset(&req_header->http_version, 0, sizeof(StringView));
+    req_header->field_count = 0;
+    memset(req_header->known, 0, sizeof(req_header->known));
+    req->data = NULL;
+    if (req->arena != NULL) {
+        reset_arena(req->arena);
     }
 }
 
 /*
- * Function: http_response_to_string
+ * Function: http_response_header_to_string
  *
- * ---------------------------------
+ * ----------------------------------------
  *
- *  Stringifies the HTTP Response struct.
+ *  Stringifies the status line and header fields, up to and including
+ *  the empty line.
  *
- *  res: pointer to the http response struct.
+ *  res_header: pointer to the http response header struct.
  *  res_string: pointer to the string buffer.
  *
  *  returns: size of response string. if failed (-1).
  */
-ssize_t http_response_to_string(HTTPResponse* res, StringBuffer* res_string) {
-    if (res == NULL) {
-        return -1;
-    }
-
-    HTTPResponseHeader* res_header = &res->http_header;
-
-    // Temperory buffer for lines.
-    size_t max_line_size = 1024 * sizeof(char);
-    char* line = malloc(max_line_size);
-    if (line == NULL) {
-        err("http_response_to_string", "Unable to allocate memory for line buffer!");
+ssize_t http_response_header_to_string(HTTPResponseHeader* res_header, StringBuffer* res_string) {
+    if (res_header == NULL) {
         return -1;
     }
 
-    // write response line
-    int written_bytes = snprintf(line, max_line_size, "%s %d %s\r\n", 
-                                 res_header->http_version, res_header->code, res_header->desc);
-    // printf("1. [%s]\n", line);
-    ssize_t result = write_to_string_buffer(res_string, line, strlen(line));
-    if (result == -1) {
+    // the pieces go straight into the output buffer, only the status line is formatted
+    char status_line[64];
+    int status_size = snprintf(status_line, sizeof(status_line), "%s %d %s\r\n",
+                               res_header->http_version, res_header->code, res_header->desc);
+    if (status_size < 0 || status_size >= (int) sizeof(status_line) ||
+        write_to_string_buffer(res_string, status_line, status_size) == -1 ||
+        write_to_string_buffer(res_string, res_header->date, res_header->date_size) == -1) {
         err("http_response_to_string", "Unable to write to the string buffer!");
-        printf("\tline: %s\n", line);
-        free(line);
         return -1;
     }
-    // printf("1-1. [%s]\n", res_string->data);
 
-    // write response date
-    written_bytes += snprintf(line, max_line_size,"%s\r\n", res_header->date);
-    // printf("2. [%s]\n", line);
-    result = write_to_string_buffer(res_string, line, strlen(line));
-    if (result == -1) {
-        err("http_response_to_string", "Unable to write to the string buffer!");
-        printf("\tline: %s\n", line);
-        free(line);
-        return -1;
-    }
-    // printf("2-1. [%s]\n", res_string->data);
-
-    // write headers
     for (ListItem* field = res_header->header_fields->items; field != NULL; field = field->next) {
-        written_bytes += snprintf(line, max_line_size, "%s: %s\r\n", field->key, (char*) field->value);
-        // printf("3. [%s]\n", line);
-        result = write_to_string_buffer(res_string, line, strlen(line));
-        if (result == -1) {
+        if (write_to_string_buffer(res_string, field->key, strlen(field->key)) == -1 ||
+            write_to_string_buffer(res_string, ": ", 2) == -1 ||
+            write_to_string_buffer(res_string, field->value, strlen(field->value)) == -1 ||
+            write_to_string_buffer(res_string, "\r\n", 2) == -1) {
             err("http_response_to_string", "Unable to write to the string buffer!");
-            printf("\tline: %s\n", line);
-            free(line);
+            printf("\tfield: %s\n", field->key);
             return -1;
         }
-        // printf("3-1. [%s]\n", res_string->data);
     }
 
-    written_bytes += sprintf(line, "\r\n");
-    // printf("4. [%s]\n", line);
-    result = write_to_string_buffer(res_string, line, strlen(line));
-    if (result == -1) {
+    if (write_to_string_buffer(res_string, "\r\n", 2) == -1) {
         err("http_response_to_string", "Unable to write to the string buffer!");
-        printf("\tline: %s\n", line);
-        free(line);
         return -1;
     }
-    // printf("4-1. [%s]\n", res_string->data);
-    // print_buffer(res_string->data, res_string->max_size, 8);
+    return res_string->size;
+}
 
-    ListItem* content_length = list_get_item(res_header->header_fields, "Content-Length");
-    if (content_length == NULL) {
-        err("http_response_to_string", "No content-length!");
-        free(line);
+/*
+ * Function: http_response_to_string
+ *
+ * ---------------------------------
+ *
+ *  Stringifies the HTTP Response struct. Without a Content-Length field
+ *  the body is taken as a string, written as one chunk when the header
+ *  has Transfer-Encoding: chunked.
+ *
+ *  res: pointer to the http response struct.
+ *  res_string: pointer to the string buffer.
+ *
+ *  returns: size of response string. if failed (-1).
+ */
+ssize_t http_response_to_string(HTTPResponse* res, StringBuffer* res_string) {
+    if (res == NULL) {
         return -1;
     }
 
-    size_t body_size = strtoull((char*) content_length->value, NULL, 10);
-    // printf("--- %zu\n", body_size);
+    HTTPResponseHeader* res_header = &res->http_header;
+    if (http_response_header_to_string(res_header, res_string) == -1) {
+        return -1;
+    }
+
+    // without a length the body is a string, sent as one chunk if the header asks for chunked
+    ListItem* content_length = list_get_item(res_header->header_fields, "Content-Length");
+    ListItem* transfer_encoding = list_get_item(res_header->header_fields, "Transfer-Encoding");
+    size_t body_size = 0;
+    if (content_length != NULL) {
+        body_size = strtoull((char*) content_length->value, NULL, 10);
+    } else if (res->body != NULL) {
+        body_size = strlen((char*) res->body);
+    }
 
-    // write body
-    result = write_to_string_buffer(res_string, res->body, body_size);
-    if (result == -1) {
+    int chunked = content_length == NULL && transfer_encoding != NULL &&
+                  strcasecmp((char*) transfer_encoding->value, "chunked") == 0;
+    char chunk_size[24];
+    int chunk_size_length = snprintf(chunk_size, sizeof(chunk_size), "%zx\r\n", body_size);
+    if ((chunked && body_size > 0 && write_to_string_buffer(res_string, chunk_size, chunk_size_length) == -1) ||
+        (body_size > 0 && write_to_string_buffer(res_string, (char*) res->body, body_size) == -1) ||
+        (chunked && body_size > 0 && write_to_string_buffer(res_string, "\r\n", 2) == -1) ||
+        (chunked && write_to_string_buffer(res_string, "0\r\n\r\n", 5) == -1)) {
         err("http_response_to_string", "Unable to write to the string buffer!");
-        printf("\tline: %s\n", line);
-        free(line);
         return -1;
     }
-    // printf("\n\r\n4.[%s]\n", res_string->data);
 
-    free(line);
     return res_string->size;
 }
 
@@ -543,7 +477,7 @@ ssize_t http_response_to_string(HTTPResponse* res, StringBuffer* res_string) {
  *
  * ----------------------------
  *
- *  Generates date string.
+ *  Generates the Date header line, CRLF included.
  *
  *  timer: pointer to the current time.
  *  date_string: pointer to the date string.
@@ -551,13 +485,42 @@ ssize_t http_response_to_string(HTTPResponse* res, StringBuffer* res_string) {
  *  returns: date string length.
  */
 size_t generate_http_date(const time_t* timer, char* date_string) {
-    struct tm* gmt = gmtime(timer);
+    // workers format dates concurrently, gmtime's static buffer is not an option
+    struct tm gmt;
+    gmtime_r(timer, &gmt);
 
     size_t result = strftime(date_string, DATE_BUFFER_SIZE * sizeof(char), 
-                          "Date: %a, %d %b %Y %H:%M:%S GMT", gmt);
+                          "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &gmt);
     if (result == 0) {
         err("generate_http_date", "Unable to generate date string (overflow)!");
     }
 
     return result;
 }
+
+/*
+ * Function: update_date_cache
+ *
+ * ---------------------------
+ *
+ *  Reformats the cached Date line if the second has changed since the
+ *  last update.
+ *
+ *  cache: pointer to the date cache.
+ *  now: current time.
+ *
+ *  returns: if failed (-1), still current (0), reformatted (1).
+ */
+int update_date_cache(DateCache* cache, time_t now) {
+    if (cache->size > 0 && cache->second == now) {
+        return 0;
+    }
+
+    size_t size = generate_http_date(&now, cache->line);
+    if (size == 0) {
+        return -1;
+    }
+    cache->second = now;
+    cache->size = size;
+    return 1;
+}
@@ -2,17 +2,30 @@
 #include "../include/buffer.h"
 #include "../include/file_manager.h"
 #include "../include/utils.h"
+#include "../include/stats.h"
+#include "../include/range.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
+#include <stdatomic.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 
-char* generate_route_key(const char* method, const char* path) {
+// memory from the request's arena goes with the request, the rest is freed here
+static void release_request_memory(HTTPRequest* req, void* memory) {
+    if (req->arena == NULL) {
+        free(memory);
+    }
+}
+
+char* generate_route_key(Arena* arena, const char* method, const char* path) {
     size_t route_key_size = strlen(path) + strlen(method) + 2;
-    char* route_key = malloc(route_key_size * sizeof(char));
+    char* route_key = arena ? arena_alloc(arena, route_key_size) : malloc(route_key_size * sizeof(char));
     if (route_key == NULL) {
         err("setup_routes", "Unable to allocate memory for route key!");
         printf("\t%s %s\n", method, path);
@@ -27,7 +40,7 @@ char* generate_route_key(const char* method, const char* path) {
 int setup_routes(List* route_list, Route routes[], size_t route_count) {
     size_t failed_routes = 0;
     for (size_t i = 0; i < route_count; i++) {
-        char* route_key = generate_route_key(routes[i].method, routes[i].path);
+        char* route_key = generate_route_key(NULL, routes[i].method, routes[i].path);
         printf("route -> %s\n", route_key);
         if (route_key == NULL) {
             failed_routes++;
@@ -46,58 +59,361 @@ int setup_routes(List* route_list, Route routes[], size_t route_count) {
     return route_count - failed_routes;
 }
 
-int router(List* route_list, HTTPRequest* req, int* client_fd, HashTable* file_table) {
-    char* route_key = generate_route_key(req->http_header.method, req->http_header.path);
+Route* match_route(List* route_list, HTTPRequest* req) {
+    // HEAD is answered by the GET handler, the writer leaves out the body
+    const char* method = http_req_method(req);
+    if (strcmp(method, "HEAD") == 0) {
+        method = "GET";
+    }
+    char* route_key = generate_route_key(req->arena, method, http_req_path(req));
     if (route_key == NULL) {
-        return -1;
+        return NULL;
     }
 
     ListItem* route = list_get_item(route_list, route_key);
+    release_request_memory(req, route_key);
+    return route ? (Route*) route->value : NULL;
+}
+
+int router(List* route_list, HTTPRequest* req, ResponseWriter* writer, HashTable* file_table) {
+    Route* route = match_route(route_list, req);
     if (route != NULL) {
-        Route* selected_route = (Route*) route->value;
-        selected_route->handler(client_fd, req);
+        route->handler(writer, req);
     } else {
-        undefined_route_handler(client_fd, req, file_table);
+        undefined_route_handler(writer, req, file_table);
     }
-    free(route_key);
     return 1;
 }
 
-int send_response(int* client_fd, HTTPResponseHeader* res_header, unsigned char* body, size_t body_size, const char* content_type) {
-    time_t raw_time;
-    time(&raw_time);
-    ssize_t result = generate_http_date(&raw_time, res_header->date);
-    if (result == 0) {
+// serializes the header at the end of the writer's output, the body follows it separately
+static int write_response_header(ResponseWriter* writer, HTTPResponseHeader* res_header, ssize_t body_size,
+                                 const char* content_type) {
+    // workers refresh the line once a second, formatting it here is the fallback
+    DateCache fallback = {0};
+    const DateCache* date = writer->date;
+    if (date == NULL || date->size == 0) {
+        if (update_date_cache(&fallback, time(NULL)) == -1) {
+            return -1;
+        }
+        date = &fallback;
+    }
+    memcpy(res_header->date, date->line, date->size);
+    res_header->date_size = date->size;
+
+    // a streamed body has no length, it is chunked or ends with the connection
+    if (body_size != STREAMED_BODY_SIZE) {
+        char content_length[32] = {'\0'};
+        snprintf(content_length, sizeof(content_length), "%zd", body_size);
+        list_set_item(res_header->header_fields, "Content-Length", content_length, strlen(content_length) + 1);
+    } else if (writer->chunked) {
+        list_set_item(res_header->header_fields, "Transfer-Encoding", "chunked", strlen("chunked") + 1);
+    } else {
+        writer->keep_alive = 0;
+    }
+
+    list_set_item(res_header->header_fields, "Content-Type", content_type, strlen(content_type) + 1);
+
+    if (writer->keep_alive) {
+        char keep_alive[64] = {'\0'};
+        snprintf(keep_alive, sizeof(keep_alive), "timeout=%d, max=%d",
+                 writer->keep_alive_timeout, writer->keep_alive_max);
+        list_set_item(res_header->header_fields, "Connection", "keep-alive", strlen("keep-alive") + 1);
+        list_set_item(res_header->header_fields, "Keep-Alive", keep_alive, strlen(keep_alive) + 1);
+    } else {
+        list_set_item(res_header->header_fields, "Connection", "close", strlen("close") + 1);
+    }
+
+    // the connection writes every batched response of a wakeup at once
+    StringBuffer* output = output_queue_buffer(writer->output);
+    if (output == NULL) {
         return -1;
     }
+    size_t output_size = output->size;
+    if (http_response_header_to_string(res_header, output) == -1) {
+        err("write_response_header", "Unable to convert response header to string!");
+        output->size = output_size;
+        return -1;
+    }
+    return 1;
+}
 
-    char content_length[32] = {'\0'};
-    snprintf(content_length, sizeof(content_length), "%zu", body_size);
-    list_set_item(res_header->header_fields, "Content-Length", content_length, strlen(content_length) + 1);
+int send_response(ResponseWriter* writer, HTTPResponseHeader* res_header, unsigned char* body, size_t body_size, const char* content_type) {
+    if (write_response_header(writer, res_header, body_size, content_type) == -1) {
+        return -1;
+    }
+    if (body_size > 0 && !writer->head && output_queue_write(writer->output, (char*) body, body_size) == -1) {
+        err("send_response", "Unable to queue response body!");
+        // the header is out, the connection can not be reused
+        writer->keep_alive = 0;
+        return -1;
+    }
+    return 1;
+}
 
-    list_set_item(res_header->header_fields, "Content-Type", content_type, strlen(content_type) + 1);
+int send_buffer_response(ResponseWriter* writer, HTTPResponseHeader* res_header, unsigned char* body,
+                         size_t body_size, const char* content_type) {
+    if (write_response_header(writer, res_header, body_size, content_type) == -1) {
+        free(body);
+        return -1;
+    }
+    if (writer->head) {
+        free(body);
+        return 1;
+    }
+    // sent straight from the handler's buffer along with the header
+    if (output_queue_take(writer->output, (char*) body, body_size) == -1) {
+        err("send_buffer_response", "Unable to queue response body!");
+        writer->keep_alive = 0;
+        return -1;
+    }
+    return 1;
+}
 
-    HTTPResponse res = {*res_header, body};
+int send_file_response(ResponseWriter* writer, HTTPResponseHeader* res_header, int fd, size_t offset,
+                       size_t length, const char* content_type) {
+    if (write_response_header(writer, res_header, length, content_type) == -1) {
+        close(fd);
+        return -1;
+    }
+    if (writer->head) {
+        close(fd);
+        return 1;
+    }
 
-    StringBuffer response_string;
-    init_string_buffer(&response_string, 256 + body_size);
+    // the body stays in the file until the socket can take it
+    if (output_queue_file(writer->output, fd, offset, length) == -1) {
+        writer->keep_alive = 0;
+        return -1;
+    }
+    return 1;
+}
 
-    if (http_response_to_string(&res, &response_string) == -1) {
-        err("send_response", "Unable to convert response to string!");
-        free_string_buffer(&response_string);
-        // free_list(&header_fields);
+// streamed output goes out as it is produced when the writer can reach the socket
+static int send_chunk_flush(ResponseWriter* writer) {
+    if (writer->flush != NULL && writer->flush(writer->flush_context) == -1) {
+        err("send_chunk", "Unable to send response chunk!");
+        writer->keep_alive = 0;
         return -1;
     }
+    return 1;
+}
+
+int send_chunked_response(ResponseWriter* writer, HTTPResponseHeader* res_header, const char* content_type) {
+    if (write_response_header(writer, res_header, STREAMED_BODY_SIZE, content_type) == -1) {
+        return -1;
+    }
+    return send_chunk_flush(writer);
+}
+
+int send_chunk(ResponseWriter* writer, const void* data, size_t size) {
+    // an empty chunk would end the body
+    if (size == 0 || writer->head) {
+        return 1;
+    }
+
+    if (writer->chunked) {
+        char chunk_size[24];
+        int chunk_size_length = snprintf(chunk_size, sizeof(chunk_size), "%zx\r\n", size);
+        if (output_queue_write(writer->output, chunk_size, chunk_size_length) == -1 ||
+            output_queue_write(writer->output, data, size) == -1 ||
+            output_queue_write(writer->output, "\r\n", 2) == -1) {
+            err("send_chunk", "Unable to queue response chunk!");
+            writer->keep_alive = 0;
+            return -1;
+        }
+    } else if (output_queue_write(writer->output, data, size) == -1) {
+        err("send_chunk", "Unable to queue response chunk!");
+        return -1;
+    }
+    return send_chunk_flush(writer);
+}
+
+int end_chunked_response(ResponseWriter* writer) {
+    // the last chunk without trailer fields, close delimited bodies end with the connection
+    if (writer->chunked && !writer->head && output_queue_write(writer->output, "0\r\n\r\n", 5) == -1) {
+        err("end_chunked_response", "Unable to queue the last chunk!");
+        writer->keep_alive = 0;
+        return -1;
+    }
+    return 1;
+}
+
+// reads into the arena when given one, otherwise into a malloc'd buffer for the caller to free
+static unsigned char* read_fd_content(Arena* arena, int fd, size_t size) {
+    // never zero sized, an empty file still needs a buffer to hand over
+    unsigned char* buffer = arena ? arena_alloc(arena, size + 1) : malloc(size + 1);
+    if (buffer == NULL) {
+        err("read_fd_content", "Unable to allocate memory for file buffer!");
+        return NULL;
+    }
 
-    int send_status = send(*client_fd, response_string.data, response_string.size, 0);
-    if (send_status == -1) {
-        err("send_response", "Unable to respond to request!");
-        printf("\t%d,\n%s\n", send_status, response_string.data);
+    size_t total = 0;
+    while (total < size) {
+        ssize_t read_bytes = pread(fd, buffer + total, size - total, total);
+        if (read_bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (read_bytes <= 0) {
+            err("read_fd_content", "Unable to read file content!");
+            if (arena == NULL) {
+                free(buffer);
+            }
+            return NULL;
+        }
+        total += read_bytes;
     }
+    return buffer;
+}
 
-    free_string_buffer(&response_string);
-    // free_list(&header_fields);
-    return send_status != -1 ? 1 : -1;
+static void format_http_date(time_t timer, char* date_string, size_t date_size) {
+    struct tm gmt;
+    gmtime_r(&timer, &gmt);
+    strftime(date_string, date_size, "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+}
+
+// If-Range only holds with a strong validator that still matches, otherwise the whole file is sent
+static int if_range_matches(HTTPRequest* req, const char* etag, const char* last_modified) {
+    const char* value = http_req_known_header(req, HTTP_HEADER_IF_RANGE);
+    if (value == NULL) {
+        return 1;
+    }
+    if (value[0] == '"') {
+        return strcmp(value, etag) == 0;
+    }
+    return strcmp(value, last_modified) == 0;
+}
+
+static int send_byteranges_response(ResponseWriter* writer, HTTPResponseHeader* res_header, int fd, size_t file_size,
+                                    ByteRange* ranges, size_t range_count, const char* content_type) {
+    static atomic_uint boundary_counter;
+    char boundary[32];
+    snprintf(boundary, sizeof(boundary), "%08llx%08x", (unsigned long long) time(NULL),
+             atomic_fetch_add(&boundary_counter, 1));
+
+    // every part header is known up front, the body length has to be
+    size_t body_size = 0;
+    char part[256];
+    for (size_t i = 0; i < range_count; i++) {
+        int part_size = snprintf(part, sizeof(part), "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n\r\n",
+                                 boundary, content_type, ranges[i].start,
+                                 ranges[i].start + ranges[i].length - 1, file_size);
+        body_size += part_size + ranges[i].length;
+    }
+    body_size += snprintf(part, sizeof(part), "\r\n--%s--\r\n", boundary);
+
+    char multipart_type[64];
+    snprintf(multipart_type, sizeof(multipart_type), "multipart/byteranges; boundary=%s", boundary);
+    if (write_response_header(writer, res_header, body_size, multipart_type) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    // each part is its own file segment, sent from its offset
+    int status = 1;
+    for (size_t i = 0; i < range_count && status == 1; i++) {
+        int part_size = snprintf(part, sizeof(part), "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n\r\n",
+                                 boundary, content_type, ranges[i].start,
+                                 ranges[i].start + ranges[i].length - 1, file_size);
+        int part_fd = dup(fd);
+        if (part_fd == -1 || output_queue_write(writer->output, part, part_size) == -1 ||
+            output_queue_file(writer->output, part_fd, ranges[i].start, ranges[i].length) == -1) {
+            if (part_fd != -1) close(part_fd);
+            status = -1;
+        }
+    }
+    int end_size = snprintf(part, sizeof(part), "\r\n--%s--\r\n", boundary);
+    if (status == 1 && output_queue_write(writer->output, part, end_size) == -1) {
+        status = -1;
+    }
+    close(fd);
+
+    if (status == -1) {
+        err("send_byteranges_response", "Unable to queue the ranges!");
+        // the header is out, the connection can not be reused
+        writer->keep_alive = 0;
+    }
+    return status;
+}
+
+static int send_static_file(ResponseWriter* writer, HTTPRequest* req, File* file) {
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        err("send_static_file", "Unable to open file!");
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        err("send_static_file", "Unable to read file size!");
+        close(fd);
+        return -1;
+    }
+    size_t file_size = file_stat.st_size;
+
+    // validators for If-Range, and for caches
+    char etag[64];
+    char last_modified[DATE_BUFFER_SIZE];
+    snprintf(etag, sizeof(etag), "\"%llx-%llx\"", (unsigned long long) file_stat.st_mtime,
+             (unsigned long long) file_size);
+    format_http_date(file_stat.st_mtime, last_modified, sizeof(last_modified));
+
+    List header_fields = {0, NULL, req->arena};
+    HTTPResponseHeader res_header = {
+        {0},
+        "OK",
+        "HTTP/1.1",
+        &header_fields,
+        200,
+        0,
+    };
+    list_set_item(&header_fields, "Accept-Ranges", "bytes", strlen("bytes") + 1);
+    list_set_item(&header_fields, "ETag", etag, strlen(etag) + 1);
+    list_set_item(&header_fields, "Last-Modified", last_modified, strlen(last_modified) + 1);
+    char* content_type = get_content_type(file->extension);
+
+    ByteRange ranges[MAX_BYTE_RANGES];
+    int range_count = -1;
+    const char* range = http_req_known_header(req, HTTP_HEADER_RANGE);
+    if (range != NULL && strcmp(http_req_method(req), "GET") == 0 &&
+        if_range_matches(req, etag, last_modified)) {
+        range_count = parse_byte_ranges(range, file_size, ranges, MAX_BYTE_RANGES);
+    }
+
+    int status;
+    char content_range[96];
+    if (range_count == 0) {
+        close(fd);
+        res_header.code = 416;
+        snprintf(res_header.desc, sizeof(res_header.desc), "Range Not Satisfiable");
+        snprintf(content_range, sizeof(content_range), "bytes */%zu", file_size);
+        list_set_item(&header_fields, "Content-Range", content_range, strlen(content_range) + 1);
+        status = send_response(writer, &res_header, NULL, 0, content_type);
+    } else if (range_count == 1) {
+        res_header.code = 206;
+        snprintf(res_header.desc, sizeof(res_header.desc), "Partial Content");
+        snprintf(content_range, sizeof(content_range), "bytes %zu-%zu/%zu", ranges[0].start,
+                 ranges[0].start + ranges[0].length - 1, file_size);
+        list_set_item(&header_fields, "Content-Range", content_range, strlen(content_range) + 1);
+        status = send_file_response(writer, &res_header, fd, ranges[0].start, ranges[0].length, content_type);
+    } else if (range_count > 1) {
+        res_header.code = 206;
+        snprintf(res_header.desc, sizeof(res_header.desc), "Partial Content");
+        status = send_byteranges_response(writer, &res_header, fd, file_size, ranges, range_count, content_type);
+    } else if (file_size >= writer->sendfile_threshold) {
+        status = send_file_response(writer, &res_header, fd, 0, file_size, content_type);
+    } else if (file_size < OUTPUT_COPY_LIMIT && req->arena != NULL) {
+        // copied into the output anyway, the read goes through the arena
+        unsigned char* body = read_fd_content(req->arena, fd, file_size);
+        close(fd);
+        status = body ? send_response(writer, &res_header, body, file_size, content_type) : -1;
+    } else {
+        // one read beats the cork and sendfile round trips for small files
+        unsigned char* body = read_fd_content(NULL, fd, file_size);
+        close(fd);
+        status = body ? send_buffer_response(writer, &res_header, body, file_size, content_type) : -1;
+    }
+    free_list(&header_fields);
+    return status;
 }
 
 char* get_content_type(const char* extension) {
@@ -109,12 +425,13 @@ char* get_content_type(const char* extension) {
     return "application/octet-stream";
 }
 
-int undefined_route_handler(int* client_fd, HTTPRequest* req, HashTable* file_table) {
+int undefined_route_handler(ResponseWriter* writer, HTTPRequest* req, HashTable* file_table) {
     char* requested_path = NULL;
-    int requested_path_size = req_path_to_local(req->http_header.path, strlen(req->http_header.path), &requested_path);
+    int requested_path_size = req_path_to_local(req->arena, http_req_path(req), req->http_header.path.size,
+                                                &requested_path);
 
     if (requested_path_size < 1 || requested_path == NULL) {
-        free(requested_path);
+        release_request_memory(req, requested_path);
         return -1;
     }
 
@@ -123,35 +440,16 @@ int undefined_route_handler(int* client_fd, HTTPRequest* req, HashTable* file_ta
     File* file = file_entry ? (File*) file_entry->data : NULL;
 
     if (file != NULL) {
-        unsigned char* body = NULL;
-        size_t read_bytes = read_file_content(file->path, &body);
-        if (body == NULL) {
-            err("undefined_route_handler", "Unable to read file content!");
-            free(requested_path);
-            free(body);
-            return -1;
-        }
-
-        List header_fields = {0, NULL};
-        HTTPResponseHeader res_header = {
-            {0},
-            "OK", 
-            "HTTP/1.1", 
-            &header_fields, 
-            200, 
-        };
-        char* content_type = get_content_type(file->extension);
-        int status = send_response(client_fd, &res_header, body, read_bytes, content_type);
-        free(body);
-        free(requested_path);
-        free_list(&header_fields);
+        int status = send_static_file(writer, req, file);
+        release_request_memory(req, requested_path);
         return status;
-    } else if (strcmp(req->http_header.method, "GET") == 0 && requested_path[requested_path_size - 1] == '/') {
+    } else if ((writer->head || strcmp(http_req_method(req), "GET") == 0) && requested_path[requested_path_size - 1] == '/') {
         size_t index_path_size = (size_t)requested_path_size + strlen("index.html") + 1;
-        char* index_path = malloc(index_path_size * sizeof(char));
+        char* index_path = req->arena ? arena_alloc(req->arena, index_path_size)
+                                      : malloc(index_path_size * sizeof(char));
         if (index_path == NULL) {
             err("undefined_route_handler", "Unable to allocate memory for index path!");
-            free(requested_path);
+            release_request_memory(req, requested_path);
             return -1;
         }
         snprintf(index_path, index_path_size, "%sindex.html", requested_path);
@@ -159,62 +457,61 @@ int undefined_route_handler(int* client_fd, HTTPRequest* req, HashTable* file_ta
         HashEntry* index_entry = file_table->entry[index_hash_value];
         file = index_entry ? (File*) index_entry->data : NULL;
         if (file != NULL) {
-            unsigned char* body = NULL;
-            size_t read_bytes = read_file_content(file->path, &body);
-            if (body == NULL) {
-                err("undefined_route_handler", "Unable to read index file content!");
-                free(index_path);
-                free(requested_path);
-                free(body);
-                return -1;
-            }
-
-            List header_fields = {0, NULL};
-            HTTPResponseHeader res_header = {
-                {0},
-                "OK", 
-                "HTTP/1.1", 
-                &header_fields, 
-                200, 
-            };
-            char* content_type = get_content_type(file->extension);
-            int status = send_response(client_fd, &res_header, body, read_bytes, content_type);
-            free(body);
-            free(index_path);
-            free(requested_path);
-            free_list(&header_fields);
+            int status = send_static_file(writer, req, file);
+            release_request_memory(req, index_path);
+            release_request_memory(req, requested_path);
             return status;
         }
-        free(index_path);
+        release_request_memory(req, index_path);
     }
 
-    free(requested_path);
-    not_found_route_handler(client_fd, req);
+    release_request_memory(req, requested_path);
+    not_found_route_handler(writer, req);
     return 1;
 }
 
-ssize_t load_page(unsigned char** body, const char* page_path) {
+ssize_t load_page(Arena* arena, unsigned char** body, const char* page_path) {
     size_t file_path_size = strlen(DEFAULT_SERVER_PATH) + strlen(page_path) + 1;
-    char* file_path = malloc(file_path_size * sizeof(char));
-    if (file_path == NULL) {
-        err("home_route_handler", "Unable to allocate memory for file path!");
+    char file_path[file_path_size];
+    snprintf(file_path, file_path_size, "%s%s", DEFAULT_SERVER_PATH, page_path);
+
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        err("load_page", "File not found!");
+        printf("\tfile: %s\n", file_path);
+        return -1;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        err("load_page", "Unable to read file size!");
+        close(fd);
         return -1;
     }
 
-    snprintf(file_path, file_path_size, "%s%s", DEFAULT_SERVER_PATH, page_path);
-    size_t read_bytes = read_file_content(file_path, body);
-    free(file_path);
-    return read_bytes;
+    *body = read_fd_content(arena, fd, file_stat.st_size);
+    close(fd);
+    return *body ? file_stat.st_size : -1;
+}
+
+// pages read into the arena are copied out with the header, malloc'd ones are handed over
+static void send_page_response(ResponseWriter* writer, HTTPRequest* req, HTTPResponseHeader* res_header,
+                               unsigned char* body, size_t body_size) {
+    const char* content_type = "text/html; charset=UTF-8";
+    if (req->arena != NULL) {
+        send_response(writer, res_header, body, body_size, content_type);
+    } else {
+        send_buffer_response(writer, res_header, body, body_size, content_type);
+    }
 }
 
-void generic_route_handler(int* client_fd, HTTPRequest* req, const char* page_path, int status_code, const char* status_desc) {
+void generic_route_handler(ResponseWriter* writer, HTTPRequest* req, const char* page_path, int status_code, const char* status_desc) {
     unsigned char* body = NULL;
-    ssize_t read_bytes = load_page(&body, page_path);
+    ssize_t read_bytes = load_page(req->arena, &body, page_path);
     if (body == NULL) {
         err("generic_route_handler", "Unable to read file content!");
         return;
     }
-    List header_fields = {0, NULL};
+    List header_fields = {0, NULL, req->arena};
     HTTPResponseHeader res_header = {
         .date = {0},
         .desc = *status_desc,
@@ -223,77 +520,206 @@ void generic_route_handler(int* client_fd, HTTPRequest* req, const char* page_pa
         .code = status_code,
     };
 
-    const char* content_type = "text/html; charset=UTF-8";
-    send_response(client_fd, &res_header, body, read_bytes, content_type);
-    free(body);
+    send_page_response(writer, req, &res_header, body, read_bytes);
     free_list(&header_fields);
 }
 
-void home_route_handler(int* client_fd, HTTPRequest* req) {
+void home_route_handler(ResponseWriter* writer, HTTPRequest* req) {
     unsigned char* body = NULL;
-    ssize_t read_bytes = load_page(&body, "/index.html");
+    ssize_t read_bytes = load_page(req->arena, &body, "/index.html");
     if (body == NULL) {
         err("home_route_handler", "Unable to read file content!");
-        free(body);
         return;
     }
 
-    List header_fields = {0, NULL};
+    List header_fields = {0, NULL, req->arena};
     HTTPResponseHeader res_header = {
         {0},
         "OK", 
         "HTTP/1.1", 
         &header_fields, 
         200, 
+        0,
     };
-    char* content_type = "text/html; charset=UTF-8";
-    send_response(client_fd, &res_header, body, read_bytes, content_type);
-    free(body);
+    send_page_response(writer, req, &res_header, body, read_bytes);
     free_list(&header_fields);
 }
 
-void posts_route_handler(int* client_fd, HTTPRequest* req) {
+void posts_route_handler(ResponseWriter* writer, HTTPRequest* req) {
     unsigned char* body = NULL;
-    ssize_t read_bytes = load_page(&body, "/posts/index.html");
+    ssize_t read_bytes = load_page(req->arena, &body, "/posts/index.html");
     if (body == NULL) {
         err("home_route_handler", "Unable to read file content!");
-        free(body);
         return;
     }
 
-    List header_fields = {0, NULL};
+    List header_fields = {0, NULL, req->arena};
     HTTPResponseHeader res_header = {
         {0},
         "OK", 
         "HTTP/1.1", 
         &header_fields, 
         200, 
+        0,
     };
-    char* content_type = "text/html; charset=UTF-8";
-    send_response(client_fd, &res_header, body, read_bytes, content_type);
-    free(body);
+    send_page_response(writer, req, &res_header, body, read_bytes);
     free_list(&header_fields);
 }
 
-void not_found_route_handler(int* client_fd, HTTPRequest* req) {
+void not_found_route_handler(ResponseWriter* writer, HTTPRequest* req) {
     unsigned char* body = NULL;
-    ssize_t read_bytes = load_page(&body, "/404.html");
+    ssize_t read_bytes = load_page(req->arena, &body, "/404.html");
     if (body == NULL) {
         err("home_route_handler", "Unable to read file content!");
-        free(body);
         return;
     }
 
-    List header_fields = {0, NULL};
+    List header_fields = {0, NULL, req->arena};
     HTTPResponseHeader res_header = {
         {0},
         "Not Found",
         "HTTP/1.1",
         &header_fields,
-        404
+        404,
+        0,
+    };
+    send_page_response(writer, req, &res_header, body, read_bytes);
+    free_list(&header_fields);
+}
+
+void server_status_route_handler(ResponseWriter* writer, HTTPRequest* req) {
+    ServerStats stats;
+    stats_collect(&stats);
+    unsigned long long uptime = stats_uptime_ms();
+    unsigned long long accepted = STATS_GET(&stats, accepted);
+    unsigned long long accept_wakeups = STATS_GET(&stats, accept_wakeups);
+
+    char body[1024];
+    int body_size = snprintf(body, sizeof(body),
+        "uptime_ms: %llu\n"
+        "connections_accepted: %llu\n"
+        "accept_rate: %.1f/s\n"
+        "accept_wakeups: %llu\n"
+        "accepts_per_wakeup: %.2f\n"
+        "accept_batch_full: %llu\n"
+        "accept_errors: %llu\n"
+        "timeouts_idle: %llu\n"
+        "timeouts_header: %llu\n"
+        "timeouts_body: %llu\n"
+        "timeouts_write: %llu\n"
+        "shed_connections: %llu\n"
+        "shed_requests: %llu\n"
+        "pool_hits: %llu\n"
+        "pool_misses: %llu\n"
+        "bodies_rejected: %llu\n"
+        "bodies_spilled: %llu\n",
+        uptime, accepted,
+        uptime > 0 ? accepted * 1000.0 / uptime : 0.0,
+        accept_wakeups,
+        accept_wakeups > 0 ? (double) accepted / accept_wakeups : 0.0,
+        (unsigned long long) STATS_GET(&stats, accept_batch_full),
+        (unsigned long long) STATS_GET(&stats, accept_errors),
+        (unsigned long long) STATS_GET(&stats, timeouts_idle),
+        (unsigned long long) STATS_GET(&stats, timeouts_header),
+        (unsigned long long) STATS_GET(&stats, timeouts_body),
+        (unsigned long long) STATS_GET(&stats, timeouts_write),
+        (unsigned long long) STATS_GET(&stats, shed_connections),
+        (unsigned long long) STATS_GET(&stats, shed_requests),
+        (unsigned long long) STATS_GET(&stats, pool_hits),
+        (unsigned long long) STATS_GET(&stats, pool_misses),
+        (unsigned long long) STATS_GET(&stats, bodies_rejected),
+        (unsigned long long) STATS_GET(&stats, bodies_spilled));
+
+    // kernel counters, shared by every listener in the network namespace
+    unsigned long long overflows = 0;
+    unsigned long long drops = 0;
+    if (read_listen_overflows(&overflows, &drops) == 1 && body_size < (int) sizeof(body)) {
+        body_size += snprintf(body + body_size, sizeof(body) - body_size,
+                              "listen_overflows: %llu\nlisten_drops: %llu\n", overflows, drops);
+    }
+    if (body_size >= (int) sizeof(body)) {
+        body_size = sizeof(body) - 1;
+    }
+
+    List header_fields = {0, NULL, req->arena};
+    HTTPResponseHeader res_header = {
+        {0},
+        "OK",
+        "HTTP/1.1",
+        &header_fields,
+        200,
+        0,
+    };
+    send_response(writer, &res_header, (unsigned char*) body, body_size, "text/plain; charset=UTF-8");
+    free_list(&header_fields);
+}
+
+void upload_route_handler(ResponseWriter* writer, HTTPRequest* req) {
+    // the body is complete by now, pulled in pieces so a spilled one never sits in memory whole
+    char chunk[16 * 1024];
+    size_t received = 0;
+    unsigned long long checksum = 0xcbf29ce484222325ULL; // FNV-1a
+    ssize_t read_bytes;
+    while ((read_bytes = request_body_read(&req->body, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < read_bytes; i++) {
+            checksum = (checksum ^ (unsigned char) chunk[i]) * 0x100000001b3ULL;
+        }
+        received += read_bytes;
+    }
+
+    List header_fields = {0, NULL, req->arena};
+    HTTPResponseHeader res_header = {
+        {0},
+        "OK",
+        "HTTP/1.1",
+        &header_fields,
+        200,
+        0,
     };
-    char* content_type = "text/html; charset=UTF-8";
-    send_response(client_fd, &res_header, body, read_bytes, content_type);
-    free(body);
+    char body[128];
+    int body_size;
+    if (read_bytes == -1) {
+        err("upload_route_handler", "Unable to read the request body!");
+        strcpy(res_header.desc, "Internal Server Error");
+        res_header.code = 500;
+        writer->keep_alive = 0;
+        body_size = snprintf(body, sizeof(body), "upload failed\n");
+    } else {
+        body_size = snprintf(body, sizeof(body), "received_bytes: %zu\nfnv1a: %016llx\n", received, checksum);
+    }
+    send_response(writer, &res_header, (unsigned char*) body, body_size, "text/plain; charset=UTF-8");
     free_list(&header_fields);
 }
+
+void echo_route_handler(ResponseWriter* writer, HTTPRequest* req) {
+    List header_fields = {0, NULL, req->arena};
+    HTTPResponseHeader res_header = {
+        {0},
+        "OK",
+        "HTTP/1.1",
+        &header_fields,
+        200,
+        0,
+    };
+    // the length is known, but streaming keeps a spilled body out of memory
+    if (send_chunked_response(writer, &res_header, "application/octet-stream") == -1) {
+        free_list(&header_fields);
+        return;
+    }
+    free_list(&header_fields);
+
+    char chunk[16 * 1024];
+    ssize_t read_bytes;
+    while ((read_bytes = request_body_read(&req->body, chunk, sizeof(chunk))) > 0) {
+        if (send_chunk(writer, chunk, read_bytes) == -1) {
+            return;
+        }
+    }
+    if (read_bytes == -1) {
+        // the body is cut short, the client sees the missing last chunk
+        err("echo_route_handler", "Unable to read the request body!");
+        writer->keep_alive = 0;
+        return;
+    }
+    end_chunked_response(writer);
+}
@@ -0,0 +1,314 @@
+#include "../include/scan.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+typedef size_t (*ScanFunction)(const char* data, size_t size);
+
+// tchar of RFC 9110, the characters of methods and field names
+static const unsigned char token_chars[256] = {
+    ['!'] = 1, ['#'] = 1, ['$'] = 1, ['%'] = 1, ['&'] = 1, ['\''] = 1, ['*'] = 1, ['+'] = 1,
+    ['-'] = 1, ['.'] = 1, ['^'] = 1, ['_'] = 1, ['`'] = 1, ['|'] = 1, ['~'] = 1,
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1, ['H'] = 1, ['I'] = 1,
+    ['J'] = 1, ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1, ['Q'] = 1, ['R'] = 1,
+    ['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1, ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1, ['h'] = 1, ['i'] = 1,
+    ['j'] = 1, ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1, ['q'] = 1, ['r'] = 1,
+    ['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1, ['y'] = 1, ['z'] = 1,
+};
+
+static size_t scan_name_end_scalar(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (!token_chars[(unsigned char) data[i]]) return i;
+    }
+    return size;
+}
+
+static size_t scan_token_end_scalar(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = data[i];
+        if (c <= ' ' || c == 0x7f) return i;
+    }
+    return size;
+}
+
+static size_t scan_field_end_scalar(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = data[i];
+        if ((c < ' ' && c != '\t') || c == 0x7f) return i;
+    }
+    return size;
+}
+
+#ifdef SCAN_X86
+// SSE2 is part of x86-64, no check is needed. The byte compares are
+// signed, so "at most" is tested as min(byte, limit) == byte. Inlined into
+// the AVX2 scanners for their tails, so those stay VEX encoded and do not
+// pay for switching between SSE and AVX state.
+__attribute__((always_inline))
+static inline size_t scan_token_end_sse2(const char* data, size_t size) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(bytes, space), bytes);
+        int mask = _mm_movemask_epi8(_mm_or_si128(low, _mm_cmpeq_epi8(bytes, del)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return i + scan_token_end_scalar(data + i, size - i);
+}
+
+__attribute__((always_inline))
+static inline size_t scan_field_end_sse2(const char* data, size_t size) {
+    const __m128i control = _mm_set1_epi8(0x1f);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(bytes, control), bytes);
+        low = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, tab), low);
+        int mask = _mm_movemask_epi8(_mm_or_si128(low, _mm_cmpeq_epi8(bytes, del)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return i + scan_field_end_scalar(data + i, size - i);
+}
+
+// tchar is no range, so the vectors only pass letters, digits and '-', the
+// bytes of nearly every name. Anything else is looked up in the table, and
+// the scan carries on past the rare '_' or '.'.
+__attribute__((always_inline))
+static inline size_t scan_name_end_sse2(const char* data, size_t size) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i before_a = _mm_set1_epi8('a' - 1);
+    const __m128i after_z = _mm_set1_epi8('z' + 1);
+    const __m128i before_0 = _mm_set1_epi8('0' - 1);
+    const __m128i after_9 = _mm_set1_epi8('9' + 1);
+    const __m128i dash = _mm_set1_epi8('-');
+    size_t i = 0;
+    while (i + 16 <= size) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (data + i));
+        // signed compares, bytes over 0x7f are negative and fall outside both ranges
+        __m128i lower = _mm_or_si128(bytes, case_bit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a), _mm_cmpgt_epi8(after_z, lower));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(bytes, before_0), _mm_cmpgt_epi8(after_9, bytes));
+        __m128i common = _mm_or_si128(_mm_or_si128(letter, digit), _mm_cmpeq_epi8(bytes, dash));
+        int mask = ~_mm_movemask_epi8(common) & 0xffff;
+        if (mask == 0) {
+            i += 16;
+            continue;
+        }
+        i += __builtin_ctz(mask);
+        if (!token_chars[(unsigned char) data[i]]) return i;
+        i++;
+    }
+    return i + scan_name_end_scalar(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_token_end_avx2(const char* data, size_t size) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, space), bytes);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(low, _mm256_cmpeq_epi8(bytes, del)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return i + scan_token_end_sse2(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_field_end_avx2(const char* data, size_t size) {
+    const __m256i control = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, control), bytes);
+        low = _mm256_andnot_si256(_mm256_cmpeq_epi8(bytes, tab), low);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(low, _mm256_cmpeq_epi8(bytes, del)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return i + scan_field_end_sse2(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_name_end_avx2(const char* data, size_t size) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i before_a = _mm256_set1_epi8('a' - 1);
+    const __m256i after_z = _mm256_set1_epi8('z' + 1);
+    const __m256i before_0 = _mm256_set1_epi8('0' - 1);
+    const __m256i after_9 = _mm256_set1_epi8('9' + 1);
+    const __m256i dash = _mm256_set1_epi8('-');
+    size_t i = 0;
+    while (i + 32 <= size) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i lower = _mm256_or_si256(bytes, case_bit);
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, before_a), _mm256_cmpgt_epi8(after_z, lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, before_0), _mm256_cmpgt_epi8(after_9, bytes));
+        __m256i common = _mm256_or_si256(_mm256_or_si256(letter, digit), _mm256_cmpeq_epi8(bytes, dash));
+        unsigned int mask = ~(unsigned int) _mm256_movemask_epi8(common);
+        if (mask == 0) {
+            i += 32;
+            continue;
+        }
+        i += __builtin_ctz(mask);
+        if (!token_chars[(unsigned char) data[i]]) return i;
+        i++;
+    }
+    return i + scan_name_end_sse2(data + i, size - i);
+}
+#endif
+
+static ScanLevel scan_level = SCAN_SCALAR;
+static ScanFunction token_end_scanner = scan_token_end_scalar;
+static ScanFunction field_end_scanner = scan_field_end_scalar;
+static ScanFunction name_end_scanner = scan_name_end_scalar;
+
+/*
+ * Function: init_scanner
+ *
+ * ----------------------
+ *
+ *  Selects the widest scanner the CPU supports. Until it is called the
+ *  scalar scanner is used.
+ */
+void init_scanner(void) {
+    if (set_scan_level(SCAN_AVX2) == -1 && set_scan_level(SCAN_SSE2) == -1) {
+        set_scan_level(SCAN_SCALAR);
+    }
+}
+
+/*
+ * Function: set_scan_level
+ *
+ * ------------------------
+ *
+ *  Forces a scanner, for benchmarks and comparisons.
+ *
+ *  level: instruction set to use.
+ *
+ *  returns: if not supported by this CPU (-1), on success (1).
+ */
+int set_scan_level(ScanLevel level) {
+    switch (level) {
+    case SCAN_SCALAR:
+        token_end_scanner = scan_token_end_scalar;
+        field_end_scanner = scan_field_end_scalar;
+        name_end_scanner = scan_name_end_scalar;
+        break;
+#ifdef SCAN_X86
+    case SCAN_SSE2:
+        token_end_scanner = scan_token_end_sse2;
+        field_end_scanner = scan_field_end_sse2;
+        name_end_scanner = scan_name_end_sse2;
+        break;
+    case SCAN_AVX2:
+        if (!__builtin_cpu_supports("avx2")) {
+            return -1;
+        }
+        token_end_scanner = scan_token_end_avx2;
+        field_end_scanner = scan_field_end_avx2;
+        name_end_scanner = scan_name_end_avx2;
+        break;
+#endif
+    default:
+        return -1;
+    }
+    scan_level = level;
+    return 1;
+}
+
+/*
+ * Function: get_scan_level
+ *
+ * ------------------------
+ *
+ *  Returns the scanner in use.
+ *
+ *  returns: current scan level.
+ */
+ScanLevel get_scan_level(void) {
+    return scan_level;
+}
+
+/*
+ * Function: scan_level_name
+ *
+ * -------------------------
+ *
+ *  Names a scan level.
+ *
+ *  level: scan level.
+ *
+ *  returns: "scalar", "sse2" or "avx2".
+ */
+const char* scan_level_name(ScanLevel level) {
+    switch (level) {
+    case SCAN_SSE2:
+        return "sse2";
+    case SCAN_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+/*
+ * Function: scan_token_end
+ *
+ * ------------------------
+ *
+ *  Finds the first space, control character or DEL, the end of a request
+ *  target or version.
+ *
+ *  data: bytes to scan.
+ *  size: number of bytes.
+ *
+ *  returns: offset of the delimiter. if there is none, size.
+ */
+size_t scan_token_end(const char* data, size_t size) {
+    return token_end_scanner(data, size);
+}
+
+/*
+ * Function: scan_field_end
+ *
+ * ------------------------
+ *
+ *  Finds the first control character other than HTAB, or DEL. In a field
+ *  value that is the CR or LF ending the line, anything else is invalid.
+ *
+ *  data: bytes to scan.
+ *  size: number of bytes.
+ *
+ *  returns: offset of the delimiter. if there is none, size.
+ */
+size_t scan_field_end(const char* data, size_t size) {
+    return field_end_scanner(data, size);
+}
+
+/*
+ * Function: scan_name_end
+ *
+ * -----------------------
+ *
+ *  Finds the first byte that is not a tchar, the end of a method or field
+ *  name: the space after a method, the colon after a field name, or an
+ *  invalid byte.
+ *
+ *  data: bytes to scan.
+ *  size: number of bytes.
+ *
+ *  returns: offset of the delimiter. if there is none, size.
+ */
+size_t scan_name_end(const char* data, size_t size) {
+    return name_end_scanner(data, size);
+}
@@ -0,0 +1,212 @@
+#include "../include/slab.h"
+#include "../include/utils.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define SLAB_ALIGN _Alignof(max_align_t)
+#define SLAB_ROUND(size) (((size) + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN)
+
+/*
+ * Function: init_slab_pool
+ *
+ * ------------------------
+ *
+ *  Initializes an empty pool, nothing is allocated before the first use.
+ *
+ *  pool: pointer to the pool.
+ *  object_size: size of one object.
+ *  stats: counters receiving the hits and misses, may be NULL.
+ */
+void init_slab_pool(SlabPool* pool, size_t object_size, ServerStats* stats) {
+    // a free object holds the list link
+    if (object_size < sizeof(PoolEntry)) {
+        object_size = sizeof(PoolEntry);
+    }
+    pool->object_size = SLAB_ROUND(object_size);
+    pool->free = NULL;
+    pool->slabs = NULL;
+    pool->stats = stats;
+}
+
+/*
+ * Function: slab_alloc
+ *
+ * --------------------
+ *
+ *  Takes an object from the pool, carving a new slab when it is empty.
+ *  The object is not cleared.
+ *
+ *  pool: pointer to the pool.
+ *
+ *  returns: pointer to the object. if failed, NULL.
+ */
+void* slab_alloc(SlabPool* pool) {
+    if (pool->free != NULL) {
+        PoolEntry* object = pool->free;
+        pool->free = object->next;
+        if (pool->stats != NULL) STATS_ADD(pool->stats, pool_hits, 1);
+        return object;
+    }
+
+    // the slab starts with its own link, the objects follow aligned
+    char* slab = malloc(SLAB_ROUND(sizeof(PoolEntry)) + pool->object_size * SLAB_OBJECTS);
+    if (slab == NULL) {
+        err("slab_alloc", "Unable to allocate memory for slab!");
+        return NULL;
+    }
+    ((PoolEntry*) slab)->next = pool->slabs;
+    pool->slabs = (PoolEntry*) slab;
+    if (pool->stats != NULL) STATS_ADD(pool->stats, pool_misses, 1);
+
+    char* objects = slab + SLAB_ROUND(sizeof(PoolEntry));
+    // pushed back to front, so the first object is handed out first next time
+    for (size_t i = SLAB_OBJECTS - 1; i > 0; i--) {
+        PoolEntry* object = (PoolEntry*) (objects + i * pool->object_size);
+        object->next = pool->free;
+        pool->free = object;
+    }
+    return objects;
+}
+
+/*
+ * Function: slab_free
+ *
+ * -------------------
+ *
+ *  Returns an object taken from the same pool.
+ *
+ *  pool: pointer to the pool.
+ *  object: pointer to the object.
+ */
+void slab_free(SlabPool* pool, void* object) {
+    if (object == NULL) {
+        return;
+    }
+    PoolEntry* entry = (PoolEntry*) object;
+    entry->next = pool->free;
+    pool->free = entry;
+}
+
+/*
+ * Function: free_slab_pool
+ *
+ * ------------------------
+ *
+ *  Releases every slab, objects still in use become invalid.
+ *
+ *  pool: pointer to the pool.
+ */
+void free_slab_pool(SlabPool* pool) {
+    PoolEntry* slab = pool->slabs;
+    while (slab != NULL) {
+        PoolEntry* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    pool->slabs = NULL;
+    pool->free = NULL;
+}
+
+/*
+ * Function: init_buffer_pool
+ *
+ * --------------------------
+ *
+ *  Initializes an empty buffer pool.
+ *
+ *  pool: pointer to the pool.
+ *  buffer_size: capacity of the pooled buffers.
+ *  stats: counters receiving the hits and misses, may be NULL.
+ */
+void init_buffer_pool(BufferPool* pool, size_t buffer_size, ServerStats* stats) {
+    pool->buffer_size = buffer_size < sizeof(PoolEntry) ? sizeof(PoolEntry) : buffer_size;
+    pool->free = NULL;
+    pool->free_count = 0;
+    pool->stats = stats;
+}
+
+/*
+ * Function: buffer_pool_acquire
+ *
+ * -----------------------------
+ *
+ *  Prepares an empty buffer, reusing an idle one when there is any.
+ *
+ *  pool: pointer to the pool.
+ *  buffer: pointer to the StringBuffer to fill in.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int buffer_pool_acquire(BufferPool* pool, StringBuffer* buffer) {
+    if (pool == NULL || buffer == NULL) {
+        return -1;
+    }
+
+    if (pool->free != NULL) {
+        buffer->data = (char*) pool->free;
+        pool->free = pool->free->next;
+        pool->free_count--;
+        if (pool->stats != NULL) STATS_ADD(pool->stats, pool_hits, 1);
+    } else {
+        buffer->data = malloc(pool->buffer_size);
+        if (buffer->data == NULL) {
+            err("buffer_pool_acquire", "Unable to allocate memory for buffer!");
+            return -1;
+        }
+        if (pool->stats != NULL) STATS_ADD(pool->stats, pool_misses, 1);
+    }
+    buffer->max_size = pool->buffer_size;
+    buffer->size = 0;
+    buffer->data[0] = '\0';
+    return 1;
+}
+
+/*
+ * Function: buffer_pool_release
+ *
+ * -----------------------------
+ *
+ *  Keeps the buffer for reuse if it still has the pool's capacity and the
+ *  pool is not full, frees it otherwise.
+ *
+ *  pool: pointer to the pool, NULL frees the buffer.
+ *  buffer: pointer to the StringBuffer, emptied.
+ */
+void buffer_pool_release(BufferPool* pool, StringBuffer* buffer) {
+    if (buffer->data == NULL) {
+        return;
+    }
+    if (pool == NULL || buffer->max_size != pool->buffer_size || pool->free_count >= BUFFER_POOL_MAX_FREE) {
+        free_string_buffer(buffer);
+        return;
+    }
+
+    PoolEntry* entry = (PoolEntry*) buffer->data;
+    entry->next = pool->free;
+    pool->free = entry;
+    pool->free_count++;
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->max_size = 0;
+}
+
+/*
+ * Function: free_buffer_pool
+ *
+ * --------------------------
+ *
+ *  Frees the idle buffers.
+ *
+ *  pool: pointer to the pool.
+ */
+void free_buffer_pool(BufferPool* pool) {
+    PoolEntry* entry = pool->free;
+    while (entry != NULL) {
+        PoolEntry* next = entry->next;
+        free(entry);
+        entry = next;
+    }
+    pool->free = NULL;
+    pool->free_count = 0;
+}
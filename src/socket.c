@@ -1,18 +1,34 @@
+#define _GNU_SOURCE // accept4
 #include "../include/socket.h"
 #include "../include/request.h"
 #include "../include/router.h"
 #include "../include/polls.h"
+#include "../include/connection.h"
 #include "../include/utils.h"
+#include "../include/thread_pool.h"
+#include "../include/mpsc_queue.h"
+#include "../include/stats.h"
+#include "../include/codel.h"
+#include "../include/lifecycle.h"
+#include "../include/uring.h"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/poll.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 void* get_server_ip(struct sockaddr* server_addr) {
     if (server_addr->sa_family == AF_INET) {
@@ -35,7 +51,15 @@ void get_server_address(struct addrinfo* server, char* host, char* port) {
     if (port != NULL) inet_ntop(server->ai_family, get_server_port(server->ai_addr), port, 6);
 }
 
-int init_tcp_server_address(struct addrinfo* hints, struct addrinfo** res,
+int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        return -1;
+    }
+    return 1;
+}
+
+int init_tcp_server_address(struct addrinfo* hints, struct addrinfo** res, const char* host,
                             const char* service, int address_family) {
     if (service == NULL) {
         err("init_tcp_server_address", "Port is not defined!");
@@ -46,14 +70,14 @@ int init_tcp_server_address(struct addrinfo* hints, struct addrinfo** res,
     hints->ai_flags = AI_PASSIVE;
     hints->ai_socktype = SOCK_STREAM;
 
-    int result = getaddrinfo(NULL, service, hints, res);
+    int result = getaddrinfo(host, service, hints, res);
     if (result != 0) {
         err("init_tcp_server", gai_strerror(result));
     }
     return result;
 }
 
-int init_socket(struct addrinfo* res, char* host) {
+int init_socket(struct addrinfo* res, int reuse_port, int v6only, const SocketOptions* options) {
     int socket_fd = -1;
     int yes = 1;
     struct addrinfo* ptr;
@@ -68,14 +92,30 @@ int init_socket(struct addrinfo* res, char* host) {
             exit(1);
         }
 
+        // every worker binds its own listener, the kernel balances between them
+        if (reuse_port && setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(int)) == -1) {
+            err("init_socket", "Unable to set SO_REUSEPORT!");
+            close(socket_fd);
+            continue;
+        }
+
+        // dual-stack unless asked otherwise, whatever net.ipv6.bindv6only says
+        if (ptr->ai_family == AF_INET6 &&
+            setsockopt(socket_fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(int)) == -1) {
+            err("init_socket", "Unable to set IPV6_V6ONLY!");
+            close(socket_fd);
+            continue;
+        }
+
         int status = -1;
         if ((status = bind(socket_fd, ptr->ai_addr, ptr->ai_addrlen) == -1)) {
             err("init_socket", "Unable to bind socket!");
+            close(socket_fd);
             continue;
         }
 
-        get_server_address(ptr, host, NULL);
-
+        // a failed option is reported, the listener still works without it
+        apply_listener_options(socket_fd, options);
         break;
     }
 
@@ -89,200 +129,1777 @@ int init_socket(struct addrinfo* res, char* host) {
     return socket_fd;
 }
 
-int process_connections(PollFd* pfds, Server* server) {
-    if (pfds == NULL || server == NULL) {
+int init_unix_socket(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        err("init_unix_socket", "Socket path is too long!");
         return -1;
     }
+    strcpy(addr.sun_path, path);
 
-    for (size_t i = 0; i < pfds->size; i++) {
-        if (pfds->items[i].revents & (POLLIN | POLLHUP)) {
-            printf("Event on fd %d: revents=%d\n", pfds->items[i].fd, pfds->items[i].revents);
-            if (pfds->items[i].fd == server->socket_fd) {
-                handle_new_connection(pfds, server->socket_fd);
-                printf("New connection on server socket\n");
-            } else {
-                printf("Client data on fd %d\n", pfds->items[i].fd);
-
-                int client_fd = pfds->items[i].fd;
-                HTTPRequest req = {{0}, NULL};
-                ssize_t received_bytes = handle_client_data(client_fd, &req);
-                if (received_bytes <= 0) {
-                    pfds_del(pfds, i);
-                    i--;
-                    printf("Client fd %d: read failed or closed (bytes=%zd)\n", client_fd, received_bytes);
-                    free_http_req(&req);
-                    continue;
-                }
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd == -1) {
+        err("init_unix_socket", "Unable to create socket!");
+        return -1;
+    }
+
+    // a socket left behind by a previous run would make bind fail
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(path);
+    }
+
+    if (bind(socket_fd, (struct sockaddr*) &addr, sizeof(addr)) == -1) {
+        err("init_unix_socket", "Unable to bind socket!");
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+// Sent in place of a body over the route's limit.
+static const char PAYLOAD_TOO_LARGE_RESPONSE[] =
+    "HTTP/1.1 413 Content Too Large\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 19\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Content Too Large\r\n";
+
+// digits only, a sign, spaces or an overflow make the request invalid
+static int parse_content_length(const char* value, size_t* length) {
+    size_t result = 0;
+    if (*value == '\0') {
+        return -1;
+    }
+    for (; *value != '\0'; value++) {
+        if (*value < '0' || *value > '9' || result > (SIZE_MAX - 9) / 10) {
+            return -1;
+        }
+        result = result * 10 + (*value - '0');
+    }
+    *length = result;
+    return 1;
+}
+
+// the route's own limit, the server's for routes without one and for static files
+static size_t request_body_limit(Worker* worker, HTTPRequest* req) {
+    Route* route = match_route(worker->server->routes, req);
+    if (route != NULL && route->max_body_size > 0) {
+        return route->max_body_size;
+    }
+    return worker->server->config->max_body_size;
+}
+
+// answered before the rest of the body is read, the connection is closed after it
+static int reject_request_body(Worker* worker, Connection* conn) {
+    STATS_ADD(&worker->stats, bodies_rejected, 1);
+    output_queue_write(&conn->output, PAYLOAD_TOO_LARGE_RESPONSE, sizeof(PAYLOAD_TOO_LARGE_RESPONSE) - 1);
+    conn->closing = 1;
+    return 0;
+}
+
+/*
+ * Function: advance_request_state
+ *
+ * -------------------------------
+ *
+ *  Moves the connection through header and body reading using the bytes
+ *  buffered so far. Headers are parsed as they arrive, continuing from
+ *  the previous call. Body bytes are moved out of the request buffer into
+ *  the request's body as they arrive, so the buffer stays small whatever
+ *  the upload size, chunked ones are decoded on the way. A body over the
+ *  route's limit is refused with a 413 once that is known.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *
+ *  returns: if failed (-1), incomplete request (0), complete request (1).
+ */
+static int advance_request_state(Worker* worker, Connection* conn) {
+    StringBuffer* request_buffer = &conn->request_buffer;
+    const ServerConfig* config = worker->server->config;
+
+    if (conn->state == CONNECTION_READING_HEADER) {
+        // stops at the end of the header, a pipelined request after it is left alone
+        int result = parse_header(&conn->parser, &conn->req, request_buffer->data, request_buffer->size);
+        if (result == -1) {
+            err("handle_client_data", "Failed to parse headers for client");
+            return -1;
+        }
+        if (result == 0) {
+            if (request_buffer->size > MAX_REQ_HEADER_SIZE) {
+                err("handle_client_data", "Request header is too large!");
+                return -1;
+            }
+            return 0;
+        }
 
-                printf("Client fd %d: Received %zd bytes\n", client_fd, received_bytes);
+        conn->header_size = conn->parser.offset;
+        const char* content_length = http_req_known_header(&conn->req, HTTP_HEADER_CONTENT_LENGTH);
+        if (content_length != NULL && parse_content_length(content_length, &conn->content_length) == -1) {
+            err("handle_client_data", "Invalid Content-Length!");
+            return -1;
+        }
+        const char* transfer_encoding = http_req_known_header(&conn->req, HTTP_HEADER_TRANSFER_ENCODING);
+        if (transfer_encoding != NULL) {
+            // chunked is the only coding understood, a length next to it could frame the body twice
+            if (strcasecmp(transfer_encoding, "chunked") != 0 || content_length != NULL) {
+                err("handle_client_data", "Unsupported Transfer-Encoding!");
+                return -1;
+            }
+            conn->chunked = 1;
+            init_chunked_decoder(&conn->chunks);
+        }
 
-                router(server->routes, &req, &client_fd, server->file_table);
+        // a chunked body is checked as it is decoded
+        conn->body_limit = request_body_limit(worker, &conn->req);
+        if (conn->body_limit > 0 && conn->content_length > conn->body_limit) {
+            return reject_request_body(worker, conn);
+        }
+        if (init_request_body(&conn->req.body, conn->req.arena, conn->content_length, config->body_memory_limit,
+                              config->body_temp_dir) == -1) {
+            return -1;
+        }
+        if (conn->req.body.spilled) {
+            STATS_ADD(&worker->stats, bodies_spilled, 1);
+        }
+        conn->state = CONNECTION_READING_BODY;
+    }
 
-                pfds_del(pfds, i);
-                i--;
-                free_http_req(&req);
-                printf("----------------\n");
+    if (conn->state == CONNECTION_READING_BODY) {
+        // anything after the body belongs to the next request and stays
+        char* received = request_buffer->data + conn->header_size;
+        size_t available = request_buffer->size - conn->header_size;
+        size_t taken;
+        if (conn->chunked) {
+            int was_spilled = conn->req.body.spilled;
+            ssize_t decoded = chunked_decode(&conn->chunks, received, available, &taken);
+            if (decoded == -1) {
+                err("handle_client_data", "Malformed chunked body!");
+                return -1;
+            }
+            if (conn->body_limit > 0 && conn->req.body.size + decoded > conn->body_limit) {
+                return reject_request_body(worker, conn);
+            }
+            if (request_body_append(&conn->req.body, received, decoded) == -1) {
+                return -1;
+            }
+            if (!was_spilled && conn->req.body.spilled) {
+                STATS_ADD(&worker->stats, bodies_spilled, 1);
+            }
+        } else {
+            size_t missing = conn->content_length - conn->req.body.size;
+            taken = available < missing ? available : missing;
+            if (request_body_append(&conn->req.body, received, taken) == -1) {
+                return -1;
             }
         }
+        memmove(received, received + taken, available - taken);
+        request_buffer->size -= taken;
+        request_buffer->data[request_buffer->size] = '\0';
+
+        if (conn->chunked ? !chunked_decoder_done(&conn->chunks) : conn->req.body.size < conn->content_length) {
+            return 0;
+        }
+        conn->state = CONNECTION_REQUEST_READY;
     }
+    // reading the body may have moved the buffer the views point into
+    conn->req.data = request_buffer->data;
     return 1;
 }
 
-int start_server(Server* server, int queue_size) {
-    int status = -1;
-    if ((status = listen(server->socket_fd, queue_size))) {
-        err("start_server", "Unable to bind socket!");
+static int acquire_request_buffer(Connection* conn) {
+    StringBuffer* request_buffer = &conn->request_buffer;
+    if (request_buffer->data == NULL &&
+        (conn->pools ? buffer_pool_acquire(&conn->pools->buffers, request_buffer)
+                     : init_string_buffer(request_buffer, MAX_REQ_BUFFER_SIZE)) == -1) {
+        err("handle_client_data", "Unable to initialize request_buffer!");
         return -1;
     }
+    return 1;
+}
 
-    printf("LISTENING ON %s:%s...\n", server->host, server->port);
+// counts bytes just placed after the buffered ones, a complete request waits, what follows it is pipelined
+static int take_received_data(Worker* worker, Connection* conn, size_t received_bytes) {
+    StringBuffer* request_buffer = &conn->request_buffer;
+    request_buffer->size += received_bytes;
+    request_buffer->data[request_buffer->size] = '\0';
+    conn->read_progress = 1;
+    if (conn->state != CONNECTION_REQUEST_READY && advance_request_state(worker, conn) == -1) {
+        return -1;
+    }
+    return 1;
+}
 
-    PollFd pfds;
-    if (init_pfds(&pfds, 10) == -1) {
+/*
+ * Function: append_client_data
+ *
+ * ----------------------------
+ *
+ *  Copies bytes a receive request brought in to the request buffer and
+ *  advances the request state, like handle_client_data does after every
+ *  read. No bytes stand for a peer shutdown already recorded.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *  data: received bytes.
+ *  size: number of bytes.
+ *
+ *  returns: if failed (-1), incomplete request (0), complete request (1).
+ */
+static int append_client_data(Worker* worker, Connection* conn, const char* data, size_t size) {
+    if (acquire_request_buffer(conn) == -1) {
         return -1;
     }
+    if (size > 0) {
+        StringBuffer* request_buffer = &conn->request_buffer;
+        if (reserve_string_buffer(request_buffer, size) == -1) {
+            return -1;
+        }
+        memcpy(request_buffer->data + request_buffer->size, data, size);
+        if (take_received_data(worker, conn, size) == -1) {
+            return -1;
+        }
+        if (conn->closing) {
+            return 0;
+        }
+    }
+    return advance_request_state(worker, conn);
+}
 
-    pfds_add(&pfds, server->socket_fd);
+// Route handler invocation running on the thread pool.
+typedef struct {
+    MpscNode node; // first, completions are popped as nodes
+    Worker* worker;
+    Connection* conn;
+    OutputQueue output;
+    ResponseWriter writer;
+    unsigned long long queued_at; // wakeup that revealed the request
+    DateCache date;               // the worker's line at dispatch, it changes under a running handler
+    int partial;                  // streamed output of a running task, malloc'd, the task itself follows
+} HandlerTask;
 
-    // int i = 0;
-    while (1) {
-        int poll_count = poll(pfds.items, pfds.size, -1);
+// Sent as is to shed load, building it would cost what shedding saves.
+static const char SERVICE_UNAVAILABLE_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 20\r\n"
+    "Retry-After: " SHED_RETRY_AFTER "\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Service Unavailable\n";
 
-        if (poll_count == -1) {
-            err("start_server", "Poll Error!");
-            break;
-        }
+// the listener's accept stays armed across connections until it fails or is cancelled
+static int arm_accept(Worker* worker, Connection* listener) {
+    struct io_uring_sqe* sqe = pfds_prepare(&worker->pfds, &listener->input_op);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listener->fd;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    listener->input_op.active = 1;
+    return 1;
+}
 
-        process_connections(&pfds, server);
-        // if (i++ == 4) break;
+// the kernel picks a receive buffer once data is there, an idle connection holds none
+static int arm_recv(Worker* worker, Connection* conn) {
+    struct io_uring_sqe* sqe = pfds_prepare(&worker->pfds, &conn->input_op);
+    if (sqe == NULL) {
+        return -1;
     }
-    free_pfds(&pfds);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->len = RECV_BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = POLL_BUFFER_GROUP;
+    conn->input_op.active = 1;
     return 1;
 }
 
 /*
- * Function: handle_new_connection
+ * Function: start_send
  *
- * -------------------------------
+ * --------------------
  *
- *  Handles new coming connection and adds it to the list.
+ *  Queues a send of the connection's output as io_uring requests. The
+ *  memory segments at the head go out in one gathered send, a file at the
+ *  head is read into the connection's file buffer by a read linked ahead
+ *  of the send. A send with more output behind it carries MSG_MORE, so a
+ *  header shares its segments with the file data that follows it.
  *
- *  pfds: pointer to the poll list.
- *  listener_fd: listener socket file descriptor.
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection, without a send in flight.
  *
- *  returns: if failed (-1), on success (1).
+ *  returns: if failed (-1), on success or with nothing to send (1).
  */
-int handle_new_connection(PollFd* pfds, int listener_fd) {
-    if (pfds == NULL) {
-        return -1;
+static int start_send(Worker* worker, Connection* conn) {
+    PollFd* pfds = &worker->pfds;
+    OutputQueue* output = &conn->output;
+    size_t size;
+    size_t iov_count = output_queue_gather(output, conn->send_iov, OUTPUT_IOV_MAX, &size);
+    if (iov_count > 0) {
+        struct io_uring_sqe* sqe = pfds_prepare(pfds, &conn->send_op);
+        if (sqe == NULL) {
+            return -1;
+        }
+        memset(&conn->send_msg, 0, sizeof(conn->send_msg));
+        conn->send_msg.msg_iov = conn->send_iov;
+        conn->send_msg.msg_iovlen = iov_count;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = conn->fd;
+        sqe->addr = (unsigned long long) (uintptr_t) &conn->send_msg;
+        sqe->msg_flags = MSG_NOSIGNAL | (output_queue_pending(output) > size ? MSG_MORE : 0);
+        conn->send_op.active = 1;
+        conn->file_size = 0;
+        // the kernel reads the gathered bytes until the send completes, later output goes elsewhere
+        output_queue_seal(output);
+        return 1;
     }
 
-    struct sockaddr_storage client_addr;
-    socklen_t client_size = sizeof(client_addr);
+    OutputSegment* file = output->head;
+    if (file == NULL || file->type != OUTPUT_SEGMENT_FILE) {
+        return 1;
+    }
+    size = file->length < FILE_CHUNK_SIZE ? file->length : FILE_CHUNK_SIZE;
+    if (conn->file_buffer.data == NULL && init_string_buffer(&conn->file_buffer, FILE_CHUNK_SIZE) == -1) {
+        return -1;
+    }
+    // a link only holds within one submission
+    if (pfds_reserve(pfds, 2) == -1) {
+        return -1;
+    }
+    struct io_uring_sqe* read_sqe = pfds_prepare(pfds, &conn->file_op);
+    if (read_sqe == NULL) {
+        return -1;
+    }
+    read_sqe->opcode = IORING_OP_READ;
+    read_sqe->fd = file->fd;
+    read_sqe->addr = (unsigned long long) (uintptr_t) conn->file_buffer.data;
+    read_sqe->len = (unsigned) size;
+    read_sqe->off = (unsigned long long) file->offset;
+    // a failed or short read breaks the link, the send then completes with -ECANCELED
+    read_sqe->flags = IOSQE_IO_LINK;
+    conn->file_op.active = 1;
+    conn->file_size = size;
+    conn->file_result = 0;
 
-    int client_fd = accept(listener_fd, (struct sockaddr*) &client_addr, &client_size);
-    if (client_fd == -1) {
-        err("handle_new_connection", "Unable to establish a connection with the client!");
+    struct io_uring_sqe* send_sqe = pfds_prepare(pfds, &conn->send_op);
+    if (send_sqe == NULL) {
+        read_sqe->flags = 0;
         return -1;
     }
+    send_sqe->opcode = IORING_OP_SEND;
+    send_sqe->fd = conn->fd;
+    send_sqe->addr = (unsigned long long) (uintptr_t) conn->file_buffer.data;
+    send_sqe->len = (unsigned) size;
+    send_sqe->msg_flags = MSG_NOSIGNAL | (output_queue_pending(output) > size ? MSG_MORE : 0);
+    conn->send_op.active = 1;
+    return 1;
+}
 
-    pfds_add(pfds, client_fd);
-    return client_fd;
+static void close_connection(Worker* worker, Connection* conn) {
+    connection_list_remove(&worker->connections, conn);
+    timer_wheel_remove(&worker->timers, &conn->read_timer);
+    timer_wheel_remove(&worker->timers, &conn->write_timer);
+    if (worker->pfds.completion_io) {
+        // the requests in flight hold the socket until they are cancelled
+        if (conn->input_op.active) pfds_cancel(&worker->pfds, &conn->input_op);
+        if (conn->file_op.active) pfds_cancel(&worker->pfds, &conn->file_op);
+        if (conn->send_op.active) pfds_cancel(&worker->pfds, &conn->send_op);
+        close(conn->fd);
+    } else {
+        pfds_del(&worker->pfds, conn->fd);
+    }
+    conn->fd = -1;
+    // a handler thread still reads the request or the kernel still holds a request, the last completion frees it
+    if (conn->busy || connection_io_active(conn)) {
+        return;
+    }
+    free_connection(conn);
 }
 
 /*
- * Function: handle_client_data
+ * Function: update_deadlines
+ *
+ * --------------------------
+ *
+ *  Schedules the connection's timers for what it is waiting on. The header
+ *  deadline runs from the first byte of the request, the body and write
+ *  deadlines restart whenever data moves, and the idle deadline starts
+ *  once a request has been answered.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *  now: current monotonic time in milliseconds.
+ */
+static void update_deadlines(Worker* worker, Connection* conn, unsigned long long now) {
+    const ServerConfig* config = worker->server->config;
+    TimerWheel* timers = &worker->timers;
+    int writing = output_queue_pending(&conn->output) > 0;
+
+    if (!writing) {
+        timer_wheel_remove(timers, &conn->write_timer);
+    } else if (!conn->write_timer.active || conn->write_progress) {
+        timer_wheel_add(timers, &conn->write_timer, now + (unsigned long long) config->write_timeout * 1000);
+    }
+
+    // handlers and pending responses are not the client's delay
+    ConnectionDeadline deadline = CONNECTION_DEADLINE_NONE;
+    int timeout = 0;
+    if (conn->busy || conn->closing || writing) {
+        deadline = CONNECTION_DEADLINE_NONE;
+    } else if (conn->state == CONNECTION_READING_BODY) {
+        deadline = CONNECTION_DEADLINE_BODY;
+        timeout = config->body_timeout;
+    } else if (conn->request_buffer.size > 0 || conn->requests_served == 0) {
+        deadline = CONNECTION_DEADLINE_HEADER;
+        timeout = config->header_timeout;
+    } else {
+        deadline = CONNECTION_DEADLINE_IDLE;
+        timeout = config->keep_alive_timeout;
+    }
+
+    if (deadline == CONNECTION_DEADLINE_NONE) {
+        timer_wheel_remove(timers, &conn->read_timer);
+    } else if (!conn->read_timer.active || conn->read_timer.kind != (int) deadline ||
+               conn->deadline_request != conn->requests_served ||
+               (deadline == CONNECTION_DEADLINE_BODY && conn->read_progress)) {
+        conn->read_timer.kind = deadline;
+        conn->deadline_request = conn->requests_served;
+        timer_wheel_add(timers, &conn->read_timer, now + (unsigned long long) timeout * 1000);
+    }
+    conn->read_progress = 0;
+    conn->write_progress = 0;
+}
+
+/*
+ * Function: expire_connections
  *
  * ----------------------------
  *
- *  receives client's request data.
+ *  Closes the connections whose deadline has passed. Only expired timers
+ *  are visited.
+ *
+ *  worker: pointer to the worker owning the connections.
+ *  now: current monotonic time in milliseconds.
+ *
+ *  returns: milliseconds until the loop has to wake up, (-1) if no timer is pending.
+ */
+static int expire_connections(Worker* worker, unsigned long long now) {
+    Timer* timer;
+    timer_wheel_advance(&worker->timers, now, &timer);
+    while (timer != NULL) {
+        Timer* next = timer->next;
+        Connection* conn = (Connection*) timer->data;
+        switch (timer->kind) {
+            case CONNECTION_DEADLINE_IDLE: STATS_ADD(&worker->stats, timeouts_idle, 1); break;
+            case CONNECTION_DEADLINE_HEADER: STATS_ADD(&worker->stats, timeouts_header, 1); break;
+            case CONNECTION_DEADLINE_BODY: STATS_ADD(&worker->stats, timeouts_body, 1); break;
+            case CONNECTION_DEADLINE_WRITE: STATS_ADD(&worker->stats, timeouts_write, 1); break;
+        }
+        // the connection's other timer may be further down this list
+        if (conn->fd != -1) {
+            close_connection(worker, conn);
+        }
+        timer = next;
+    }
+    return timer_wheel_timeout(&worker->timers, now);
+}
+
+/*
+ * Function: run_handler_task
+ *
+ * --------------------------
+ *
+ *  Routes the request on a pool thread and hands the response back to the
+ *  worker owning the connection. A request that waited too long in the
+ *  pool's queue is answered with a 503 instead.
+ *
+ *  arg: pointer to the handler task.
+ */
+static void notify_worker(Worker* worker) {
+    if (atomic_exchange(&worker->notified, 1) == 0) {
+        uint64_t value = 1;
+        if (write(worker->notify_fd, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+            err("run_handler_task", "Unable to notify the worker!");
+        }
+    }
+}
+
+// hands what a streaming handler produced so far to the worker, ahead of the task's completion
+static int flush_handler_task(void* context) {
+    HandlerTask* task = (HandlerTask*) context;
+    if (output_queue_pending(&task->output) == 0) {
+        return 1;
+    }
+
+    HandlerTask* part = malloc(sizeof(HandlerTask));
+    if (part == NULL) {
+        // the output stays with the task and goes out with its completion
+        return 1;
+    }
+    memset(part, 0, sizeof(HandlerTask));
+    part->partial = 1;
+    part->worker = task->worker;
+    part->conn = task->conn;
+    init_output_queue(&part->output, NULL, NULL);
+    output_queue_splice(&part->output, &task->output);
+
+    mpsc_queue_push(&task->worker->completions, &part->node);
+    notify_worker(task->worker);
+    return 1;
+}
+
+static void run_handler_task(void* arg) {
+    HandlerTask* task = (HandlerTask*) arg;
+    Worker* worker = task->worker;
+    Server* server = worker->server;
+
+    unsigned long long now = monotonic_ms();
+    if (codel_should_shed(&worker->codel, now - task->queued_at, now)) {
+        STATS_ADD(&worker->stats, shed_requests, 1);
+        output_queue_write(&task->output, SERVICE_UNAVAILABLE_RESPONSE, sizeof(SERVICE_UNAVAILABLE_RESPONSE) - 1);
+        task->writer.keep_alive = 0;
+    } else {
+        router(server->routes, &task->conn->req, &task->writer, server->file_table);
+    }
+
+    // the task belongs to the worker once pushed
+    mpsc_queue_push(&worker->completions, &task->node);
+    notify_worker(worker);
+}
+
+/*
+ * Function: dispatch_request
+ *
+ * --------------------------
  *
- *  client_fd: client's file descriptor.
- *  req: pointer to a empty initiated http request.
+ *  Queues the request on the server's thread pool. The connection stays
+ *  busy until the completion is picked up by the worker.
  *
- *  returns: received bytes. if failed (-1).
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *  writer: response settings for the request.
+ *
+ *  returns: if failed (-1), on success (1).
  */
-ssize_t handle_client_data(int client_fd, HTTPRequest* req) {
-    if (client_fd < 0 || req == NULL) {
+static int dispatch_request(Worker* worker, Connection* conn, ResponseWriter* writer) {
+    HandlerTask* task = slab_alloc(&worker->tasks);
+    if (task == NULL) {
+        err("dispatch_request", "Unable to allocate memory for handler task!");
         return -1;
     }
+    // filled on a pool thread, so not from the worker's pools
+    init_output_queue(&task->output, NULL, NULL);
 
-    StringBuffer request_buffer;
-    if (init_string_buffer(&request_buffer, 4096) == 0) {
-        err("handle_client_data", "Unable to initialize request_buffer!");
+    task->worker = worker;
+    task->conn = conn;
+    task->writer = *writer;
+    task->writer.output = &task->output;
+    // the socket is the worker's, streamed output is passed to it in parts
+    task->writer.flush = flush_handler_task;
+    task->writer.flush_context = task;
+    task->date = worker->date;
+    task->writer.date = &task->date;
+    task->partial = 0;
+    task->queued_at = worker->queued_since;
+
+    conn->busy = 1;
+    if (thread_pool_submit(worker->server->pool, run_handler_task, task) == -1) {
+        conn->busy = 0;
+        slab_free(&worker->tasks, task);
         return -1;
     }
+    return 1;
+}
+
+// the connection an inline handler writes to and the worker sending its output
+typedef struct {
+    Worker* worker;
+    Connection* conn;
+} InlineFlush;
+
+// an inline handler streaming its response gets the first chunks on the wire while it builds the rest
+static int flush_handler_output(void* context) {
+    InlineFlush* target = (InlineFlush*) context;
+    Connection* conn = target->conn;
+    if (target->worker->pfds.completion_io) {
+        // one send at a time, its completion picks up what the handler adds meanwhile
+        if (conn->send_op.active) {
+            return 1;
+        }
+        if (start_send(target->worker, conn) == -1) {
+            return -1;
+        }
+        return pfds_submit(&target->worker->pfds);
+    }
 
-    // Temperory receive buffer
-    size_t receive_buffer_size = 1024 * sizeof(char);
-    char* receive_buffer = malloc(receive_buffer_size);
-    if (receive_buffer == NULL) {
-        err("handle_client_data", "Unable to allocate memory for buffer!");
-        free_string_buffer(&request_buffer);
+    ssize_t sent = output_queue_send(&conn->output, conn->fd);
+    if (sent == -1) {
         return -1;
     }
+    if (sent > 0) {
+        conn->write_progress = 1;
+    }
+    return 1;
+}
 
-    struct pollfd pfd = {client_fd, POLLIN, 0};
-    int header_end_found = 0;
-    size_t content_length = 0;
-    size_t body_received = 0;
-    size_t total_received_bytes = 0;
-    while (1) {
-        ssize_t received_bytes = recv(client_fd, receive_buffer, receive_buffer_size - 1, 0);
-        if (received_bytes <= 0) {
-            if (received_bytes == -1) {
-                printf("\t[CLIENT#%d] Unable to receive request data from client!\n", client_fd);
-            } else if (received_bytes == 0) {
-                printf("\t[CLIENT#%d] Disconnected!\n", client_fd);
-            }
-            free(receive_buffer);
-            free_string_buffer(&request_buffer);
-            return received_bytes;
+/*
+ * Function: finish_request
+ *
+ * ------------------------
+ *
+ *  Routes a complete request, appending its response to the connection's
+ *  output batch, and decides whether the connection persists. With a
+ *  thread pool the handler runs there instead. Requests that queued for
+ *  too long are shed with a 503.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *
+ *  returns: close after flushing (-1), handed to the pool (0), keep it open (1).
+ */
+static int finish_request(Worker* worker, Connection* conn) {
+    Server* server = worker->server;
+    const ServerConfig* config = server->config;
+    conn->requests_served++;
+
+    InlineFlush inline_flush = {worker, conn};
+    ResponseWriter writer = {
+        .output = &conn->output,
+        .keep_alive = !worker->draining && http_req_keep_alive(&conn->req) &&
+                      conn->requests_served < config->max_keep_alive_requests,
+        .keep_alive_timeout = config->keep_alive_timeout,
+        .keep_alive_max = (int) (config->max_keep_alive_requests - conn->requests_served),
+        .sendfile_threshold = config->sendfile_threshold,
+        .chunked = strcmp(http_req_version(&conn->req), "HTTP/1.1") == 0,
+        .flush = flush_handler_output,
+        .flush_context = &inline_flush,
+        .date = &worker->date,
+        .head = strcmp(http_req_method(&conn->req), "HEAD") == 0,
+    };
+
+    // fall back to running inline if the task can not be queued
+    if (server->pool != NULL && dispatch_request(worker, conn, &writer) == 1) {
+        return 0;
+    }
+
+    unsigned long long now = monotonic_ms();
+    if (codel_should_shed(&worker->codel, now - worker->queued_since, now)) {
+        STATS_ADD(&worker->stats, shed_requests, 1);
+        output_queue_write(&conn->output, SERVICE_UNAVAILABLE_RESPONSE, sizeof(SERVICE_UNAVAILABLE_RESPONSE) - 1);
+        reset_connection_request(conn);
+        return -1;
+    }
+
+    router(server->routes, &conn->req, &writer, server->file_table);
+
+    reset_connection_request(conn);
+    return writer.keep_alive ? 1 : -1;
+}
+
+/*
+ * Function: output_throttled
+ *
+ * --------------------------
+ *
+ *  Tells whether the client has fallen so far behind that the connection
+ *  should neither be read from nor answer pipelined requests.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *
+ *  returns: keep going (0), wait for the output to drain (1).
+ */
+static int output_throttled(const Worker* worker, const Connection* conn) {
+    size_t high_water = worker->server->config->output_high_water;
+    return high_water > 0 && output_queue_pending(&conn->output) >= high_water;
+}
+
+/*
+ * Function: serve_requests
+ *
+ * ------------------------
+ *
+ *  Answers every complete request in the buffer in order, stopping early
+ *  while one of them is being handled on the thread pool or while the
+ *  client is not reading its responses. A request left waiting stays in
+ *  the ready state.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *  result: state of the request at the front of the buffer.
+ */
+static void serve_requests(Worker* worker, Connection* conn, int result) {
+    while (result == 1 && !output_throttled(worker, conn)) {
+        int finished = finish_request(worker, conn);
+        if (finished == -1) {
+            conn->closing = 1;
+            return;
+        } else if (finished == 0) {
+            // resumed by complete_handler_task
+            return;
+        }
+        result = advance_request_state(worker, conn);
+    }
+    if (result == -1 || (result == 0 && conn->read_closed)) {
+        conn->closing = 1;
+    }
+}
+
+/*
+ * Function: update_poll_events
+ *
+ * ----------------------------
+ *
+ *  Asks for POLLOUT only while a response is partially written and stops
+ *  reading from connections that are about to be closed, wait for a
+ *  handler thread or have more output pending than the high water mark.
+ *  With io_uring requests a receive is queued instead, while reading.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+static int update_poll_events(Worker* worker, Connection* conn) {
+    short events = conn->closing || conn->busy || output_throttled(worker, conn) ? 0 : POLLIN;
+    if (worker->pfds.completion_io) {
+        // a connection only turns busy or throttled while handling a receive, never with one in flight
+        if ((events & POLLIN) && !conn->read_closed && !conn->input_op.active) {
+            return arm_recv(worker, conn);
         }
+        return 1;
+    }
+    if (output_queue_pending(&conn->output) > 0) {
+        events |= POLLOUT;
+    }
+
+    if (events == conn->poll_events) {
+        return 1;
+    }
+    conn->poll_events = events;
+    return pfds_mod(&worker->pfds, conn->fd, events, conn);
+}
 
-        if (write_to_string_buffer(&request_buffer, receive_buffer, received_bytes) == -1) {
-            free(receive_buffer);
-            free_string_buffer(&request_buffer);
+/*
+ * Function: flush_connection
+ *
+ * --------------------------
+ *
+ *  Writes the queued responses and files until the socket is full. What
+ *  it does not take is kept until it becomes writable again. With
+ *  io_uring requests a send is queued instead, its completion goes on.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *
+ *  returns: if failed (-1), pending data left (0), everything sent (1).
+ */
+static int flush_connection(Worker* worker, Connection* conn) {
+    if (worker->pfds.completion_io) {
+        if (!conn->send_op.active && start_send(worker, conn) == -1) {
+            err("flush_connection", "Unable to respond to request!");
+            return -1;
+        }
+        if (update_poll_events(worker, conn) == -1) {
             return -1;
         }
+        return !conn->send_op.active && output_queue_pending(&conn->output) == 0;
+    }
 
-        total_received_bytes += received_bytes;
+    ssize_t sent = output_queue_send(&conn->output, conn->fd);
+    if (sent == -1) {
+        err("flush_connection", "Unable to respond to request!");
+        return -1;
+    }
+    if (sent > 0) {
+        conn->write_progress = 1;
+    }
 
-        // Check for header end (\r\n\r\n)
-        if (!header_end_found) {
-            char* header_end = strstr(request_buffer.data, "\r\n\r\n");
-            if (header_end) {
-                header_end_found = 1;
-                if (parse_header(req, request_buffer.data) == -1) {
-                    err("handle_client_data", "Failed to parse headers for client");
-                    free_string_buffer(&request_buffer);
-                    return -1;
-                }
-                ListItem* content_length_field = list_get_item(req->http_header.header_fields, "Content-Length");
-                if (content_length_field) {
-                    content_length = strtoull((char*) content_length_field->value, NULL, 10);
+    if (update_poll_events(worker, conn) == -1) {
+        return -1;
+    }
+    return output_queue_pending(&conn->output) == 0;
+}
+
+/*
+ * Function: complete_handler_tasks
+ *
+ * --------------------------------
+ *
+ *  Appends the responses produced by the thread pool to their connections,
+ *  resumes any pipelined requests and flushes the output. Parts of a
+ *  streamed response are sent as they come in.
+ *
+ *  worker: pointer to the worker owning the connections.
+ */
+static void complete_handler_tasks(Worker* worker) {
+    // cleared first, a task pushed after the last pop writes the eventfd again
+    atomic_store(&worker->notified, 0);
+
+    MpscNode* node;
+    while ((node = mpsc_queue_pop(&worker->completions)) != NULL) {
+        HandlerTask* task = (HandlerTask*) node;
+        Connection* conn = task->conn;
+        if (task->partial) {
+            // the connection stays busy, its task completes after its parts
+            if (conn->fd != -1) {
+                output_queue_splice(&conn->output, &task->output);
+                if (flush_connection(worker, conn) == -1) {
+                    close_connection(worker, conn);
+                } else {
+                    update_deadlines(worker, conn, monotonic_ms());
                 }
-                body_received = request_buffer.size - (header_end - request_buffer.data + 4);
             }
+            free_output_queue(&task->output);
+            free(task);
+            continue;
         }
+        conn->busy = 0;
 
-        // Check if full request is received
-        if (header_end_found && body_received == content_length) {
+        if (conn->fd == -1) {
+            if (!connection_io_active(conn)) free_connection(conn);
+        } else {
+            output_queue_splice(&conn->output, &task->output);
+            reset_connection_request(conn);
+            if (!task->writer.keep_alive || worker->draining) {
+                conn->closing = 1;
+            } else {
+                serve_requests(worker, conn, advance_request_state(worker, conn));
+            }
+
+            int flushed = flush_connection(worker, conn);
+            if (flushed == -1 || (flushed == 1 && conn->closing && !conn->busy)) {
+                close_connection(worker, conn);
+            } else {
+                update_deadlines(worker, conn, monotonic_ms());
+            }
+        }
+        free_output_queue(&task->output);
+        slab_free(&worker->tasks, task);
+    }
+}
+
+/*
+ * Function: settle_connection
+ *
+ * ---------------------------
+ *
+ *  Flushes the connection after its socket was served, answers a request
+ *  held back for a slow reader once it caught up, then closes the
+ *  connection or moves its deadlines.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *  now: current monotonic time in milliseconds.
+ */
+static void settle_connection(Worker* worker, Connection* conn, unsigned long long now) {
+    int flushed = flush_connection(worker, conn);
+    if (flushed != -1 && conn->state == CONNECTION_REQUEST_READY && !conn->busy && !conn->closing &&
+        !output_throttled(worker, conn)) {
+        serve_requests(worker, conn, 1);
+        flushed = flush_connection(worker, conn);
+    }
+    if (flushed == -1 || (flushed == 1 && conn->closing && !conn->busy)) {
+        close_connection(worker, conn);
+    } else {
+        update_deadlines(worker, conn, now);
+    }
+}
+
+/*
+ * Function: add_client
+ *
+ * --------------------
+ *
+ *  Takes an accepted client in, polled or with a receive request queued.
+ *  Clients over the worker's share of the connection limit get a 503 and
+ *  are closed right away.
+ *
+ *  worker: pointer to the worker owning the listener.
+ *  listener_config: listener the client came from.
+ *  client_fd: accepted non-blocking socket.
+ *
+ *  returns: if failed (-1), turned away (0), on success (1).
+ */
+static int add_client(Worker* worker, const ListenerConfig* listener_config, int client_fd) {
+    const ServerConfig* config = worker->server->config;
+    // the limit is split evenly, every worker owns its share of the connections
+    size_t max_connections = (config->max_connections + config->workers - 1) / config->workers;
+
+    // over the limit the client is told to come back instead of queueing behind the others
+    if (max_connections > 0 && worker->connections.size >= max_connections) {
+        send(client_fd, SERVICE_UNAVAILABLE_RESPONSE, sizeof(SERVICE_UNAVAILABLE_RESPONSE) - 1,
+             MSG_NOSIGNAL | MSG_DONTWAIT);
+        close(client_fd);
+        return 0;
+    }
+
+    if (listener_config->type != LISTENER_UNIX) {
+        apply_client_options(client_fd, &config->socket_options);
+    }
+    Connection* conn = create_connection(client_fd, CONNECTION_CLIENT, &worker->pools);
+    int registered = -1;
+    if (conn != NULL) {
+        registered = worker->pfds.completion_io ? arm_recv(worker, conn)
+                                                : pfds_add(&worker->pfds, client_fd, POLLIN, conn);
+    }
+    if (registered == -1) {
+        free_connection(conn);
+        close(client_fd);
+        return -1;
+    }
+    connection_list_push(&worker->connections, conn);
+    update_deadlines(worker, conn, monotonic_ms());
+    return 1;
+}
+
+/*
+ * Function: complete_accept
+ *
+ * -------------------------
+ *
+ *  Takes in a client the listener's multishot accept brought in. The
+ *  accept is armed again once the kernel ends it, unless draining.
+ *
+ *  worker: pointer to the worker owning the listener.
+ *  listener: listener connection.
+ *  result: accepted socket, -errno if accepting failed.
+ */
+static void complete_accept(Worker* worker, Connection* listener, int result) {
+    const ListenerConfig* listener_config = &worker->server->config->listeners[listener->listener_index];
+    if (result >= 0) {
+        int added = add_client(worker, listener_config, result);
+        if (added == 1) {
+            STATS_ADD(&worker->stats, accepted, 1);
+        } else if (added == 0) {
+            STATS_ADD(&worker->stats, shed_connections, 1);
+        } else {
+            STATS_ADD(&worker->stats, accept_errors, 1);
+        }
+    } else if (result != -ECANCELED) {
+        STATS_ADD(&worker->stats, accept_errors, 1);
+        err("handle_new_connection", "Unable to establish a connection with the client!");
+    }
+
+    if (!listener->input_op.active && !worker->draining && arm_accept(worker, listener) == -1) {
+        err("handle_new_connection", "Unable to accept on the listener again!");
+    }
+}
+
+/*
+ * Function: complete_io_request
+ *
+ * -----------------------------
+ *
+ *  Dispatches a finished io_uring request by its kind. Accepted clients
+ *  are taken in, received bytes advance the request and sent bytes leave
+ *  the output queue. The connection is then settled like after a
+ *  readiness event. A closed connection is freed with the completion of
+ *  its last request.
+ *
+ *  worker: pointer to the worker owning the requests.
+ *  completion: finished request.
+ *  now: current monotonic time in milliseconds.
+ */
+static void complete_io_request(Worker* worker, const PollCompletion* completion, unsigned long long now) {
+    IoOp* op = (IoOp*) completion->data;
+    Connection* conn = op->conn;
+    int result = completion->result;
+    if (!(completion->flags & IORING_CQE_F_MORE)) {
+        op->active = 0;
+    }
+
+    if (op->type == IO_OP_ACCEPT) {
+        complete_accept(worker, conn, result);
+        return;
+    }
+    if (conn->fd == -1) {
+        pfds_release_buffer(&worker->pfds, completion);
+        if (!conn->busy && !connection_io_active(conn)) {
+            free_connection(conn);
+        }
+        return;
+    }
+
+    if (op->type == IO_OP_RECV) {
+        int state = 0;
+        if (result > 0) {
+            const char* data = pfds_buffer(&worker->pfds, completion);
+            state = conn->closing ? 0 : append_client_data(worker, conn, data, (size_t) result);
+            pfds_release_buffer(&worker->pfds, completion);
+            // the rest is read right away like a readiness event would, so nothing is left unread at close
+            if (state != -1 && !conn->closing && (completion->flags & IORING_CQE_F_SOCK_NONEMPTY)) {
+                state = (int) handle_client_data(worker, conn);
+            }
+        } else if (result == 0) {
+            // answer what was already sent before closing
+            conn->read_closed = 1;
+            state = conn->closing ? 0 : append_client_data(worker, conn, NULL, 0);
+        } else if (result != -ENOBUFS) {
+            printf("\t[CLIENT#%d] Unable to receive request data from client!\n", conn->fd);
+            state = -1;
+        }
+        // out of buffers, the receive is queued again after this pass handed them back
+        if (state == -1) {
+            close_connection(worker, conn);
+            return;
+        }
+        serve_requests(worker, conn, state);
+    } else if (op->type == IO_OP_FILE_READ) {
+        // the linked send completes next
+        conn->file_result = result;
+        return;
+    } else {
+        // a file read that failed or came up short cancelled the send
+        if (result < 0 || (conn->file_size > 0 && conn->file_result != (int) conn->file_size)) {
+            err("flush_connection", conn->file_size > 0 && conn->file_result >= 0
+                                        ? "File ended before its queued length!"
+                                        : "Unable to respond to request!");
+            close_connection(worker, conn);
+            return;
+        }
+        output_queue_advance(&conn->output, (size_t) result);
+        if (result > 0) {
+            conn->write_progress = 1;
+        }
+    }
+    settle_connection(worker, conn, now);
+}
+
+int process_connections(Worker* worker) {
+    if (worker == NULL) {
+        return -1;
+    }
+
+    PollFd* pfds = &worker->pfds;
+    unsigned long long now = monotonic_ms();
+    int completions = 0;
+
+    // an edge triggered listener is not reported again until it is drained
+    for (size_t i = 0; worker->accept_pending != 0 && i < MAX_LISTENERS; i++) {
+        if (worker->accept_pending & (1u << i)) {
+            handle_new_connection(worker, worker->listeners[i]);
+        }
+    }
+
+    // io_uring requests finished since the last wait, in the order the kernel posted them
+    for (size_t i = 0; i < pfds->completion_count; i++) {
+        complete_io_request(worker, &pfds->completions[i], now);
+    }
+
+    // only the ready descriptors are visited
+    for (size_t i = 0; i < pfds->event_count; i++) {
+        PollEvent* event = &pfds->events[i];
+        Connection* conn = (Connection*) event->data;
+
+        if (conn->type == CONNECTION_LISTENER) {
+            handle_new_connection(worker, conn);
+            continue;
+        } else if (conn->type == CONNECTION_NOTIFY) {
+            uint64_t value;
+            while (read(conn->fd, &value, sizeof(value)) > 0);
+            // handled after the loop, completions may close connections still in this batch
+            completions = 1;
+            continue;
+        }
+
+        if (conn->busy) {
+            if (event->revents & (POLLHUP | POLLERR)) {
+                close_connection(worker, conn);
+                continue;
+            }
+        } else if (event->revents & (POLLIN | POLLHUP | POLLERR)) {
+            int result = conn->closing ? 0 : handle_client_data(worker, conn);
+            if (result == -1) {
+                close_connection(worker, conn);
+                continue;
+            }
+            serve_requests(worker, conn, result);
+        }
+        settle_connection(worker, conn, now);
+    }
+
+    if (completions) {
+        complete_handler_tasks(worker);
+    }
+    return 1;
+}
+
+/*
+ * Function: close_listener
+ *
+ * ------------------------
+ *
+ *  Closes a drained worker's listener and removes it from the server's
+ *  list, so a reload on another worker does not hand its number down
+ *  after it was closed or reused.
+ *
+ *  server: pointer to the server holding the open listeners.
+ *  socket_fd: listener file descriptor.
+ */
+static void close_listener(Server* server, int socket_fd) {
+    pthread_mutex_lock(&server->listener_lock);
+    for (size_t i = 0; i < server->listener_count; i++) {
+        if (server->listener_fds[i] == socket_fd) {
+            server->listener_fds[i] = -1;
+            break;
+        }
+    }
+    close(socket_fd);
+    pthread_mutex_unlock(&server->listener_lock);
+}
+
+/*
+ * Function: start_drain
+ *
+ * ---------------------
+ *
+ *  Stops accepting after taking in what is already in the backlog and
+ *  closes the idle keep-alive connections. The others are closed once
+ *  their current request or response is done.
+ *
+ *  worker: pointer to the worker.
+ *  now: current monotonic time in milliseconds.
+ */
+static void start_drain(Worker* worker, unsigned long long now) {
+    worker->draining = 1;
+    worker->drain_deadline = now + (unsigned long long) worker->server->config->drain_timeout * 1000;
+
+    for (size_t i = 0; i < worker->server->config->listener_count; i++) {
+        Connection* listener = worker->listeners[i];
+        int batch = (int) worker->server->config->listeners[i].accept_batch;
+        while (handle_new_connection(worker, listener) == batch);
+        if (worker->pfds.completion_io) {
+            // clients the accept brings in until the cancellation lands are served like the backlog
+            if (listener->input_op.active) pfds_cancel(&worker->pfds, &listener->input_op);
+        } else {
+            pfds_unwatch(&worker->pfds, listener->fd);
+        }
+        // new clients are refused from here on, a shared unix listener is left to start_server
+        if (worker->server->config->listeners[i].type != LISTENER_UNIX) {
+            close_listener(worker->server, listener->fd);
+            worker->listener_fds[i] = -1;
+        }
+    }
+    worker->accept_pending = 0;
+
+    Connection* conn = worker->connections.head;
+    while (conn != NULL) {
+        Connection* next = conn->next;
+        // busy connections and partial requests are closed after their response
+        if (!conn->busy && conn->requests_served > 0 && conn->request_buffer.size == 0) {
+            if (output_queue_pending(&conn->output) > 0) {
+                conn->closing = 1;
+            } else {
+                close_connection(worker, conn);
+            }
+        }
+        conn = next;
+    }
+}
+
+/*
+ * Function: finish_io_requests
+ *
+ * ----------------------------
+ *
+ *  Cancels the accepts still armed and waits for every io_uring request of
+ *  the exiting worker to complete, so no buffer or connection is freed
+ *  while the kernel may still use it. Clients accepted meanwhile are
+ *  closed right away.
+ *
+ *  worker: pointer to the worker, its connections already closed.
+ */
+static void finish_io_requests(Worker* worker) {
+    PollFd* pfds = &worker->pfds;
+    if (!pfds->completion_io) {
+        return;
+    }
+    for (size_t i = 0; i < MAX_LISTENERS; i++) {
+        Connection* listener = worker->listeners[i];
+        if (listener != NULL && listener->input_op.active) {
+            pfds_cancel(pfds, &listener->input_op);
+        }
+    }
+
+    unsigned long long deadline = monotonic_ms() + IO_FINISH_TIMEOUT;
+    while (pfds->io_pending > 0 && monotonic_ms() < deadline) {
+        if (pfds_wait(pfds, IO_FINISH_TIMEOUT) == -1 && errno != EINTR) {
+            break;
+        }
+        for (size_t i = 0; i < pfds->completion_count; i++) {
+            const PollCompletion* completion = &pfds->completions[i];
+            IoOp* op = (IoOp*) completion->data;
+            if (!(completion->flags & IORING_CQE_F_MORE)) {
+                op->active = 0;
+            }
+            if (op->type == IO_OP_ACCEPT) {
+                if (completion->result >= 0) close(completion->result);
+                continue;
+            }
+            pfds_release_buffer(pfds, completion);
+            // busy ones are freed with their handler task
+            if (!op->conn->busy && !connection_io_active(op->conn)) {
+                free_connection(op->conn);
+            }
+        }
+    }
+    if (pfds->io_pending > 0) {
+        err("run_worker", "io_uring requests did not complete in time!");
+    }
+}
+
+static void free_worker_listeners(Worker* worker) {
+    for (size_t i = 0; i < MAX_LISTENERS; i++) {
+        free_connection(worker->listeners[i]);
+        worker->listeners[i] = NULL;
+    }
+}
+
+/*
+ * Function: run_worker
+ *
+ * --------------------
+ *
+ *  Runs one event loop over the worker's own listener and connections
+ *  until a requested drain is complete.
+ *
+ *  arg: pointer to the worker.
+ *
+ *  returns: NULL.
+ */
+static void* run_worker(void* arg) {
+    Worker* worker = (Worker*) arg;
+    const ServerConfig* config = worker->server->config;
+    worker->status = -1;
+    worker->accept_pending = 0;
+
+    if (init_pfds(&worker->pfds, 10, config->poll_backend, config->poll_trigger) == -1) {
+        return NULL;
+    }
+    // io_uring accepts, receives and sends itself where the kernel has buffer rings, it polls otherwise
+    if (worker->pfds.backend == POLL_BACKEND_URING &&
+        pfds_enable_io(&worker->pfds, RECV_BUFFER_COUNT, RECV_BUFFER_SIZE) == -1) {
+        err("run_worker", "io_uring can not run the socket I/O, polling the sockets instead!");
+    }
+
+    for (size_t i = 0; i < config->listener_count; i++) {
+        Connection* listener = create_connection(worker->listener_fds[i], CONNECTION_LISTENER, NULL);
+        int registered = -1;
+        if (listener != NULL) {
+            listener->listener_index = i;
+            registered = worker->pfds.completion_io ? arm_accept(worker, listener)
+                                                    : pfds_add(&worker->pfds, listener->fd, POLLIN, listener);
+        }
+        if (registered == -1) {
+            free_connection(listener);
+            finish_io_requests(worker);
+            free_worker_listeners(worker);
+            free_pfds(&worker->pfds);
+            return NULL;
+        }
+        worker->listeners[i] = listener;
+    }
+
+    Connection* notify = NULL;
+    if (worker->notify_fd != -1) {
+        notify = create_connection(worker->notify_fd, CONNECTION_NOTIFY, NULL);
+        if (notify == NULL || pfds_add(&worker->pfds, worker->notify_fd, POLLIN, notify) == -1) {
+            free_connection(notify);
+            finish_io_requests(worker);
+            free_worker_listeners(worker);
+            free_pfds(&worker->pfds);
+            return NULL;
+        }
+    }
+
+    init_timer_wheel(&worker->timers, monotonic_ms());
+    stats_register(&worker->stats);
+    int timeout = -1;
+    worker->pass_start = monotonic_ms();
+    update_date_cache(&worker->date, time(NULL));
+    while (1) {
+        unsigned long long wait_start = monotonic_ms();
+        int poll_count = pfds_wait(&worker->pfds, timeout);
+
+        if (poll_count == -1) {
+            if (errno == EINTR) continue;
+            err("run_worker", "Poll Error!");
+            break;
+        }
+
+        // events ready without waiting piled up while the previous pass ran
+        unsigned long long now = monotonic_ms();
+        worker->queued_since = now > wait_start ? now : worker->pass_start;
+        worker->pass_start = now;
+        // a cheap clock read per pass, the line is only reformatted when the second changes
+        update_date_cache(&worker->date, time(NULL));
+        process_connections(worker);
+
+        now = monotonic_ms();
+        if (take_reload_request() && !worker->draining) {
+            Server* server = worker->server;
+            // the successor is forked with no listener closing underneath
+            pthread_mutex_lock(&server->listener_lock);
+            pid_t pid = spawn_successor(server->config->argv, server->listener_fds, server->listener_count);
+            pthread_mutex_unlock(&server->listener_lock);
+            if (pid != -1) printf("RELOADING: started process %d\n", (int) pid);
+        }
+        if (!worker->draining && drain_requested()) {
+            start_drain(worker, now);
+        }
+
+        timeout = expire_connections(worker, now);
+        if (worker->draining) {
+            if (worker->connections.size == 0 || now >= worker->drain_deadline) break;
+            int remaining = (int) (worker->drain_deadline - now);
+            if (timeout == -1 || timeout > remaining) timeout = remaining;
+        }
+        if (worker->accept_pending != 0) {
+            timeout = 0;
+        }
+    }
+    while (worker->connections.head != NULL) {
+        close_connection(worker, worker->connections.head);
+    }
+    finish_io_requests(worker);
+    free_connection(notify);
+    free_worker_listeners(worker);
+    free_pfds(&worker->pfds);
+    stats_unregister(&worker->stats);
+    worker->status = 1;
+    return NULL;
+}
+
+/*
+ * Function: open_listener
+ *
+ * -----------------------
+ *
+ *  Binds and listens on a configured address. TCP listeners get
+ *  SO_REUSEPORT when every worker binds its own.
+ *
+ *  listener: listener description.
+ *  config: pointer to the server config.
+ *
+ *  returns: listener file descriptor. if failed (-1).
+ */
+static int open_listener(const ListenerConfig* listener, const ServerConfig* config) {
+    int socket_fd = -1;
+    if (listener->type == LISTENER_UNIX) {
+        socket_fd = init_unix_socket(listener->address);
+    } else {
+        struct addrinfo hints;
+        struct addrinfo* res;
+        const char* host = listener->address[0] != '\0' ? listener->address : NULL;
+        int family = listener->type == LISTENER_TCP4 ? AF_INET : AF_INET6;
+        if (init_tcp_server_address(&hints, &res, host, listener->port, family) != 0) {
+            return -1;
+        }
+        socket_fd = init_socket(res, config->workers > 1, listener->v6only, &config->socket_options);
+    }
+    if (socket_fd == -1) {
+        return -1;
+    }
+
+    // accept must never block the loop (spurious wakeups, edge triggered drains)
+    if (listen(socket_fd, listener->backlog) == -1 || set_nonblocking(socket_fd) == -1) {
+        err("open_listener", "Unable to listen on socket!");
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+/*
+ * Function: listener_matches
+ *
+ * --------------------------
+ *
+ *  Checks whether an open socket is bound to a configured address.
+ *
+ *  socket_fd: listener socket file descriptor.
+ *  listener: listener description.
+ *
+ *  returns: matches (1), otherwise (0).
+ */
+static int listener_matches(int socket_fd, const ListenerConfig* listener) {
+    struct sockaddr_storage addr;
+    socklen_t addr_size = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    if (getsockname(socket_fd, (struct sockaddr*) &addr, &addr_size) == -1) {
+        return 0;
+    }
+
+    if (listener->type == LISTENER_UNIX) {
+        return addr.ss_family == AF_UNIX &&
+               strcmp(((struct sockaddr_un*) &addr)->sun_path, listener->address) == 0;
+    }
+
+    int family = listener->type == LISTENER_TCP4 ? AF_INET : AF_INET6;
+    if (addr.ss_family != family) {
+        return 0;
+    }
+    char port[6];
+    snprintf(port, sizeof(port), "%u", ntohs(*(in_port_t*) get_server_port((struct sockaddr*) &addr)));
+    if (strcmp(port, listener->port) != 0) {
+        return 0;
+    }
+
+    // an empty address is the wildcard, all zeros for both families
+    unsigned char expected[sizeof(struct in6_addr)] = {0};
+    if (listener->address[0] != '\0' && inet_pton(family, listener->address, expected) != 1) {
+        return 0;
+    }
+    return memcmp(get_server_ip((struct sockaddr*) &addr), expected,
+                  family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr)) == 0;
+}
+
+/*
+ * Function: take_inherited_listener
+ *
+ * ---------------------------------
+ *
+ *  Finds a listener handed down by a predecessor for the configured
+ *  address and removes it from the inherited list.
+ *
+ *  server: pointer to the server holding the inherited listeners.
+ *  listener: listener description.
+ *
+ *  returns: listener file descriptor. if none matches (-1).
+ */
+static int take_inherited_listener(Server* server, const ListenerConfig* listener) {
+    for (size_t i = 0; i < server->listener_count; i++) {
+        int socket_fd = server->listener_fds[i];
+        if (socket_fd == -1 || !listener_matches(socket_fd, listener)) {
+            continue;
+        }
+        server->listener_fds[i] = -1;
+
+        // already listening, this only applies the current backlog and options
+        if (listener->type != LISTENER_UNIX) {
+            apply_listener_options(socket_fd, &server->config->socket_options);
+        }
+        if (listen(socket_fd, listener->backlog) == -1 || set_nonblocking(socket_fd) == -1) {
+            err("take_inherited_listener", "Unable to listen on inherited socket!");
+            close(socket_fd);
+            return -1;
+        }
+        return socket_fd;
+    }
+    return -1;
+}
+
+static void print_listener(const ListenerConfig* listener) {
+    const char* address = listener->address[0] != '\0' ? listener->address : NULL;
+    if (listener->type == LISTENER_UNIX) {
+        printf("unix:%s", listener->address);
+    } else if (listener->type == LISTENER_TCP6) {
+        printf("[%s]:%s%s", address != NULL ? address : "::", listener->port,
+               address == NULL && !listener->v6only ? " (dual-stack)" : "");
+    } else {
+        printf("%s:%s", address != NULL ? address : "0.0.0.0", listener->port);
+    }
+}
+
+int start_server(Server* server) {
+    const ServerConfig* config = server->config;
+    size_t listener_count = config->listener_count;
+
+    // one pool serves every worker, idle handler threads steal from busy ones
+    ThreadPool pool;
+    if (config->handler_threads > 0) {
+        if (init_thread_pool(&pool, config->handler_threads) == -1) {
+            err("start_server", "Unable to start the handler thread pool!");
+            return -1;
+        }
+        server->pool = &pool;
+    }
+
+    size_t worker_count = config->workers;
+    Worker* workers = calloc(worker_count, sizeof(Worker));
+    int* listeners = calloc(worker_count * listener_count, sizeof(int));
+    int* wake_fds = calloc(worker_count, sizeof(int));
+    if (workers == NULL || listeners == NULL || wake_fds == NULL) {
+        err("start_server", "Unable to allocate memory for workers!");
+        free(workers);
+        free(listeners);
+        free(wake_fds);
+        if (server->pool != NULL) free_thread_pool(server->pool);
+        server->pool = NULL;
+        return -1;
+    }
+
+    int status = 1;
+    size_t open_count = 0;
+    for (size_t i = 0; i < worker_count; i++) {
+        workers[i].id = i;
+        workers[i].server = server;
+        workers[i].notify_fd = -1;
+        for (size_t j = 0; j < MAX_LISTENERS; j++) {
+            workers[i].listener_fds[j] = -1;
+        }
+        init_mpsc_queue(&workers[i].completions);
+        init_slab_pool(&workers[i].pools.connections, sizeof(Connection), &workers[i].stats);
+        init_slab_pool(&workers[i].pools.segments, sizeof(OutputSegment), &workers[i].stats);
+        init_buffer_pool(&workers[i].pools.buffers, MAX_REQ_BUFFER_SIZE, &workers[i].stats);
+        init_slab_pool(&workers[i].tasks, sizeof(HandlerTask), &workers[i].stats);
+        // shared with the pool threads, so it outlives the worker's loop
+        if (init_codel(&workers[i].codel, config->shed_target, config->shed_interval) == -1) {
+            worker_count = i;
+            status = -1;
+            break;
+        }
+        if ((workers[i].notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+            err("start_server", "Unable to create the worker eventfd!");
+            worker_count = i + 1;
+            status = -1;
+            break;
+        }
+        wake_fds[i] = workers[i].notify_fd;
+
+        for (size_t j = 0; j < listener_count; j++) {
+            const ListenerConfig* listener = &config->listeners[j];
+            // unix sockets have no SO_REUSEPORT, the workers share the first one. Draining
+            // workers only unwatch it, it is closed once with worker 0's listeners
+            if (listener->type == LISTENER_UNIX && i > 0) {
+                workers[i].listener_fds[j] = workers[0].listener_fds[j];
+                continue;
+            }
+            // listeners handed down by a predecessor replace freshly bound ones
+            int socket_fd = take_inherited_listener(server, listener);
+            if (socket_fd == -1 && (socket_fd = open_listener(listener, config)) == -1) {
+                status = -1;
+                break;
+            }
+            workers[i].listener_fds[j] = socket_fd;
+            listeners[open_count++] = socket_fd;
+        }
+        if (status == -1) {
+            worker_count = i + 1;
             break;
         }
+    }
+
+    // inherited listeners that are no longer configured, or for workers that are gone
+    for (size_t i = 0; i < server->listener_count; i++) {
+        if (server->listener_fds[i] != -1) close(server->listener_fds[i]);
+    }
+    server->listener_fds = listeners;
+    server->listener_count = open_count;
+
+    if (status == 1 && install_signal_handlers(wake_fds, worker_count) == -1) {
+        status = -1;
+    }
+
+    printf("LISTENING ON ");
+    for (size_t i = 0; i < listener_count; i++) {
+        if (i > 0) printf(", ");
+        print_listener(&config->listeners[i]);
+    }
+    printf(" (%zu workers)...\n", worker_count);
+
+    if (status == 1 && worker_count == 1) {
+        notify_predecessor();
+        run_worker(&workers[0]);
+        status = workers[0].status;
+    } else if (status == 1) {
+        size_t started = 0;
+        for (; started < worker_count; started++) {
+            if (pthread_create(&workers[started].thread, NULL, run_worker, &workers[started]) != 0) {
+                err("start_server", "Unable to start worker thread!");
+                status = -1;
+                break;
+            }
+        }
+        if (status == 1) {
+            notify_predecessor();
+        }
+        for (size_t i = 0; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+            if (workers[i].status == -1) status = -1;
+        }
+    }
+    remove_signal_handlers();
+
+    // tasks still running finish into the completion queues, their connections are already closed
+    if (server->pool != NULL) {
+        free_thread_pool(server->pool);
+        server->pool = NULL;
+        for (size_t i = 0; i < worker_count; i++) {
+            MpscNode* node;
+            while ((node = mpsc_queue_pop(&workers[i].completions)) != NULL) {
+                HandlerTask* task = (HandlerTask*) node;
+                free_output_queue(&task->output);
+                if (task->partial) {
+                    free(task);
+                    continue;
+                }
+                free_connection(task->conn);
+                slab_free(&workers[i].tasks, task);
+            }
+        }
+    }
+
+    // what the workers did not close while draining, the shared unix listeners once
+    for (size_t i = 0; i < worker_count; i++) {
+        for (size_t j = 0; j < listener_count; j++) {
+            if (workers[i].listener_fds[j] == -1 || (config->listeners[j].type == LISTENER_UNIX && i > 0)) {
+                continue;
+            }
+            close(workers[i].listener_fds[j]);
+        }
+    }
+    for (size_t i = 0; i < worker_count; i++) {
+        if (workers[i].notify_fd != -1) close(workers[i].notify_fd);
+        free_codel(&workers[i].codel);
+        free_slab_pool(&workers[i].pools.connections);
+        free_slab_pool(&workers[i].pools.segments);
+        free_buffer_pool(&workers[i].pools.buffers);
+        free_slab_pool(&workers[i].tasks);
+    }
+    server->listener_fds = NULL;
+    server->listener_count = 0;
+    free(listeners);
+    free(wake_fds);
+    free(workers);
+    return status;
+}
+
+/*
+ * Function: handle_new_connection
+ *
+ * -------------------------------
+ *
+ *  Accepts pending connections until the backlog is empty or the
+ *  listener's batch is reached, and adds them to the list. An edge
+ *  triggered listener stopped by the batch limit is resumed on the next
+ *  loop iteration. Clients over the worker's share of the connection
+ *  limit get a 503 and are closed right away.
+ *
+ *  worker: pointer to the worker polling the listener.
+ *  listener: listener connection.
+ *
+ *  returns: number of accepted connections. if failed (-1).
+ */
+int handle_new_connection(Worker* worker, Connection* listener) {
+    if (worker == NULL || listener == NULL) {
+        return -1;
+    }
+
+    PollFd* pfds = &worker->pfds;
+    const ServerConfig* config = worker->server->config;
+    const ListenerConfig* listener_config = &config->listeners[listener->listener_index];
+    unsigned int pending_bit = 1u << listener->listener_index;
+    size_t batch = listener_config->accept_batch;
+    int accepted = 0;
+    int rejected = 0;
+    worker->accept_pending &= ~pending_bit;
+    STATS_ADD(&worker->stats, accept_wakeups, 1);
+
+    // drain the backlog instead of going back through the poll for every client
+    while ((size_t) (accepted + rejected) < batch) {
+        struct sockaddr_storage client_addr;
+        socklen_t client_size = sizeof(client_addr);
 
-        int poll_result = poll(&pfd, 1, 5000);
-        if (poll_result <= 0) {
-            if (poll_result == -1) {
-                err("handle_cliend_data", "Unable to wait for more data!");
+        int client_fd = accept4(listener->fd, (struct sockaddr*) &client_addr, &client_size,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;
-            } else if (poll_result == 0) {
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            STATS_ADD(&worker->stats, accept_errors, 1);
+            err("handle_new_connection", "Unable to establish a connection with the client!");
+            break;
+        }
+
+        int added = add_client(worker, listener_config, client_fd);
+        if (added == -1) {
+            STATS_ADD(&worker->stats, accept_errors, 1);
+            break;
+        } else if (added == 0) {
+            rejected++;
+            continue;
+        }
+        accepted++;
+    }
+
+    STATS_ADD(&worker->stats, accepted, accepted);
+    STATS_ADD(&worker->stats, shed_connections, rejected);
+    if ((size_t) (accepted + rejected) == batch) {
+        STATS_ADD(&worker->stats, accept_batch_full, 1);
+        // level triggered listeners are reported again by the next wait
+        if (pfds->trigger == POLL_TRIGGER_EDGE) {
+            worker->accept_pending |= pending_bit;
+        }
+    }
+    return accepted;
+}
+
+/*
+ * Function: handle_client_data
+ *
+ * ----------------------------
+ *
+ *  Receives whatever the client has sent so far without blocking and
+ *  advances the connection's request state after every read, so a body
+ *  never piles up in the request buffer. A peer shutdown is recorded in
+ *  conn->read_closed.
+ *
+ *  worker: pointer to the worker owning the connection.
+ *  conn: pointer to the client connection.
+ *
+ *  returns: if failed or closed (-1), incomplete request (0), complete request (1).
+ */
+ssize_t handle_client_data(Worker* worker, Connection* conn) {
+    if (conn == NULL || conn->fd < 0) {
+        return -1;
+    }
+
+    StringBuffer* request_buffer = &conn->request_buffer;
+    if (acquire_request_buffer(conn) == -1) {
+        return -1;
+    }
+
+    // drain the socket, edge triggered notifications are not repeated
+    while (1) {
+        // a fresh pooled buffer is used as is, it only grows once mostly full
+        if (reserve_string_buffer(request_buffer, MIN_RECV_SPACE) == -1) {
+            return -1;
+        }
+
+        size_t free_space = request_buffer->max_size - request_buffer->size - 1;
+        ssize_t received_bytes = recv(conn->fd, request_buffer->data + request_buffer->size, free_space, 0);
+        if (received_bytes == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;
+            } else if (errno == EINTR) {
+                continue;
             }
+            printf("\t[CLIENT#%d] Unable to receive request data from client!\n", conn->fd);
+            return -1;
+        } else if (received_bytes == 0) {
+            // answer what was already sent before closing
+            conn->read_closed = 1;
+            break;
+        }
+
+        if (take_received_data(worker, conn, received_bytes) == -1) {
+            return -1;
+        }
+        if (conn->closing) {
+            return 0;
         }
     }
 
-    free(receive_buffer);
-    free_string_buffer(&request_buffer);
-    return total_received_bytes;
+    return advance_request_state(worker, conn);
 }
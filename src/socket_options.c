@@ -0,0 +1,102 @@
+#include "../include/socket_options.h"
+#include "../include/utils.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/*
+ * Function: init_socket_options
+ *
+ * -----------------------------
+ *
+ *  Leaves every option at the kernel default.
+ *
+ *  options: pointer to the socket options.
+ */
+void init_socket_options(SocketOptions* options) {
+    options->nodelay = 0;
+    options->quickack = 0;
+    options->defer_accept = 0;
+    options->fastopen = 0;
+    options->rcvbuf = 0;
+    options->sndbuf = 0;
+    options->busy_poll = 0;
+}
+
+/*
+ * Function: apply_listener_options
+ *
+ * --------------------------------
+ *
+ *  Sets the listener side options. Failures are reported but the
+ *  remaining options are still applied.
+ *
+ *  socket_fd: listener socket file descriptor.
+ *  options: pointer to the socket options.
+ *
+ *  returns: if any option failed (-1), on success (1).
+ */
+int apply_listener_options(int socket_fd, const SocketOptions* options) {
+    if (options == NULL) {
+        return 1;
+    }
+
+    int status = 1;
+    // buffers have to be sized before the handshake to pick the window scale
+    if (options->rcvbuf > 0 &&
+        setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &options->rcvbuf, sizeof(int)) == -1) {
+        err("apply_listener_options", "Unable to set SO_RCVBUF!");
+        status = -1;
+    }
+    if (options->sndbuf > 0 &&
+        setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &options->sndbuf, sizeof(int)) == -1) {
+        err("apply_listener_options", "Unable to set SO_SNDBUF!");
+        status = -1;
+    }
+    if (options->defer_accept > 0 &&
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &options->defer_accept, sizeof(int)) == -1) {
+        err("apply_listener_options", "Unable to set TCP_DEFER_ACCEPT!");
+        status = -1;
+    }
+    if (options->fastopen > 0 &&
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_FASTOPEN, &options->fastopen, sizeof(int)) == -1) {
+        err("apply_listener_options", "Unable to set TCP_FASTOPEN!");
+        status = -1;
+    }
+    return status;
+}
+
+/*
+ * Function: apply_client_options
+ *
+ * ------------------------------
+ *
+ *  Sets the per connection options on an accepted socket. Failures are
+ *  not reported, the connection works without them.
+ *
+ *  socket_fd: accepted socket file descriptor.
+ *  options: pointer to the socket options.
+ *
+ *  returns: if any option failed (-1), on success (1).
+ */
+int apply_client_options(int socket_fd, const SocketOptions* options) {
+    if (options == NULL) {
+        return 1;
+    }
+
+    int status = 1;
+    int yes = 1;
+    if (options->nodelay && setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(int)) == -1) {
+        status = -1;
+    }
+    // not sticky, the kernel may fall back to delayed acks later on
+    if (options->quickack && setsockopt(socket_fd, IPPROTO_TCP, TCP_QUICKACK, &yes, sizeof(int)) == -1) {
+        status = -1;
+    }
+    if (options->busy_poll > 0 &&
+        setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &options->busy_poll, sizeof(int)) == -1) {
+        status = -1;
+    }
+    return status;
+}
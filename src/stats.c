@@ -0,0 +1,155 @@
+#include "../include/stats.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static ServerStats* stats_head = NULL;
+static ServerStats stats_retired; // counters of unregistered blocks
+static unsigned long long stats_started = 0;
+
+static void stats_add_all(ServerStats* total, ServerStats* stats) {
+    STATS_ADD(total, accepted, STATS_GET(stats, accepted));
+    STATS_ADD(total, accept_wakeups, STATS_GET(stats, accept_wakeups));
+    STATS_ADD(total, accept_batch_full, STATS_GET(stats, accept_batch_full));
+    STATS_ADD(total, accept_errors, STATS_GET(stats, accept_errors));
+    STATS_ADD(total, timeouts_idle, STATS_GET(stats, timeouts_idle));
+    STATS_ADD(total, timeouts_header, STATS_GET(stats, timeouts_header));
+    STATS_ADD(total, timeouts_body, STATS_GET(stats, timeouts_body));
+    STATS_ADD(total, timeouts_write, STATS_GET(stats, timeouts_write));
+    STATS_ADD(total, shed_connections, STATS_GET(stats, shed_connections));
+    STATS_ADD(total, shed_requests, STATS_GET(stats, shed_requests));
+    STATS_ADD(total, pool_hits, STATS_GET(stats, pool_hits));
+    STATS_ADD(total, pool_misses, STATS_GET(stats, pool_misses));
+    STATS_ADD(total, bodies_rejected, STATS_GET(stats, bodies_rejected));
+    STATS_ADD(total, bodies_spilled, STATS_GET(stats, bodies_spilled));
+}
+
+/*
+ * Function: stats_register
+ *
+ * ------------------------
+ *
+ *  Clears the counters and adds them to the process wide registry.
+ *
+ *  stats: pointer to the counters.
+ */
+void stats_register(ServerStats* stats) {
+    if (stats == NULL) return;
+    memset(stats, 0, sizeof(ServerStats));
+
+    pthread_mutex_lock(&stats_lock);
+    if (stats_started == 0) stats_started = monotonic_ms();
+    stats->next = stats_head;
+    stats_head = stats;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/*
+ * Function: stats_unregister
+ *
+ * --------------------------
+ *
+ *  Removes the counters from the registry. Their values are kept in the
+ *  registry totals.
+ *
+ *  stats: pointer to the counters.
+ */
+void stats_unregister(ServerStats* stats) {
+    if (stats == NULL) return;
+
+    pthread_mutex_lock(&stats_lock);
+    for (ServerStats** ptr = &stats_head; *ptr != NULL; ptr = &(*ptr)->next) {
+        if (*ptr == stats) {
+            *ptr = stats->next;
+            stats_add_all(&stats_retired, stats);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/*
+ * Function: stats_collect
+ *
+ * -----------------------
+ *
+ *  Sums every registered block.
+ *
+ *  total: pointer to the counters receiving the sum.
+ */
+void stats_collect(ServerStats* total) {
+    if (total == NULL) return;
+    memset(total, 0, sizeof(ServerStats));
+
+    pthread_mutex_lock(&stats_lock);
+    stats_add_all(total, &stats_retired);
+    for (ServerStats* stats = stats_head; stats != NULL; stats = stats->next) {
+        stats_add_all(total, stats);
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/*
+ * Function: stats_uptime_ms
+ *
+ * -------------------------
+ *
+ *  returns: milliseconds since the first block was registered.
+ */
+unsigned long long stats_uptime_ms(void) {
+    pthread_mutex_lock(&stats_lock);
+    unsigned long long started = stats_started;
+    pthread_mutex_unlock(&stats_lock);
+    return started > 0 ? monotonic_ms() - started : 0;
+}
+
+/*
+ * Function: read_listen_overflows
+ *
+ * -------------------------------
+ *
+ *  Reads the kernel's TcpExt ListenOverflows and ListenDrops counters.
+ *  They cover every listener of the network namespace.
+ *
+ *  overflows: accept queue overflows.
+ *  drops: SYNs dropped on listeners, overflows included.
+ *
+ *  returns: if failed or not available (-1), on success (1).
+ */
+int read_listen_overflows(unsigned long long* overflows, unsigned long long* drops) {
+    FILE* netstat = fopen("/proc/net/netstat", "r");
+    if (netstat == NULL) {
+        return -1;
+    }
+
+    // "TcpExt:" appears twice, a line of names followed by a line of values
+    char names[4096];
+    char values[4096];
+    int found = -1;
+    while (fgets(names, sizeof(names), netstat) != NULL) {
+        if (strncmp(names, "TcpExt:", 7) != 0) continue;
+        if (fgets(values, sizeof(values), netstat) == NULL) break;
+
+        char* name_ptr = NULL;
+        char* value_ptr = NULL;
+        char* name = strtok_r(names, " \n", &name_ptr);
+        char* value = strtok_r(values, " \n", &value_ptr);
+        while (name != NULL && value != NULL) {
+            if (strcmp(name, "ListenOverflows") == 0) {
+                *overflows = strtoull(value, NULL, 10);
+                found = 1;
+            } else if (strcmp(name, "ListenDrops") == 0) {
+                *drops = strtoull(value, NULL, 10);
+            }
+            name = strtok_r(NULL, " \n", &name_ptr);
+            value = strtok_r(NULL, " \n", &value_ptr);
+        }
+        break;
+    }
+    fclose(netstat);
+    return found;
+}
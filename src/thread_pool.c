@@ -0,0 +1,233 @@
+#include "../include/thread_pool.h"
+#include "../include/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int init_task_deque(TaskDeque* deque, ThreadPool* pool) {
+    deque->tasks = malloc(sizeof(Task) * TASK_DEQUE_INITIAL_SIZE);
+    if (deque->tasks == NULL) {
+        err("init_task_deque", "Unable to allocate memory for tasks!");
+        return -1;
+    }
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->pool = pool;
+    deque->head = 0;
+    deque->size = 0;
+    deque->max_size = TASK_DEQUE_INITIAL_SIZE;
+    return 1;
+}
+
+static int task_deque_push(TaskDeque* deque, Task task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->size == deque->max_size) {
+        size_t new_size = deque->max_size * 2;
+        Task* tasks = malloc(sizeof(Task) * new_size);
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            err("task_deque_push", "Unable to allocate memory for tasks!");
+            return -1;
+        }
+        // unwrap the ring while copying
+        for (size_t i = 0; i < deque->size; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->max_size];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->max_size = new_size;
+    }
+    deque->tasks[(deque->head + deque->size) % deque->max_size] = task;
+    deque->size++;
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+// newest task, used by the owning thread
+static int task_deque_pop(TaskDeque* deque, Task* task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->size == 0) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+    deque->size--;
+    *task = deque->tasks[(deque->head + deque->size) % deque->max_size];
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+// oldest task, used by the other threads
+static int task_deque_steal(TaskDeque* deque, Task* task) {
+    if (pthread_mutex_trylock(&deque->lock) != 0) {
+        return 0;
+    }
+    if (deque->size == 0) {
+        pthread_mutex_unlock(&deque->lock);
+        return 0;
+    }
+    *task = deque->tasks[deque->head];
+    deque->head = (deque->head + 1) % deque->max_size;
+    deque->size--;
+    pthread_mutex_unlock(&deque->lock);
+    return 1;
+}
+
+static int find_task(ThreadPool* pool, size_t index, Task* task) {
+    if (task_deque_pop(&pool->deques[index], task)) {
+        return 1;
+    }
+    for (size_t i = 1; i < pool->size; i++) {
+        if (task_deque_steal(&pool->deques[(index + i) % pool->size], task)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* run_pool_thread(void* arg) {
+    TaskDeque* deque = (TaskDeque*) arg;
+    ThreadPool* pool = deque->pool;
+    size_t index = deque - pool->deques;
+
+    while (1) {
+        Task task;
+        if (find_task(pool, index, &task)) {
+            atomic_fetch_sub(&pool->pending, 1);
+            task.run(task.arg);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        atomic_fetch_add(&pool->sleeping, 1);
+        while (atomic_load(&pool->pending) == 0 && !atomic_load(&pool->stopping)) {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        atomic_fetch_sub(&pool->sleeping, 1);
+        int done = atomic_load(&pool->pending) == 0 && atomic_load(&pool->stopping);
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (done) break;
+    }
+    return NULL;
+}
+
+/*
+ * Function: init_thread_pool
+ *
+ * --------------------------
+ *
+ *  Starts a work-stealing thread pool.
+ *
+ *  pool: pointer to the thread pool.
+ *  thread_count: number of threads.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int init_thread_pool(ThreadPool* pool, size_t thread_count) {
+    if (pool == NULL || thread_count == 0) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(ThreadPool));
+    pool->threads = malloc(sizeof(pthread_t) * thread_count);
+    pool->deques = malloc(sizeof(TaskDeque) * thread_count);
+    if (pool->threads == NULL || pool->deques == NULL) {
+        err("init_thread_pool", "Unable to allocate memory for the pool!");
+        free(pool->threads);
+        free(pool->deques);
+        return -1;
+    }
+
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    for (size_t i = 0; i < thread_count; i++) {
+        if (init_task_deque(&pool->deques[i], pool) == -1) {
+            free_thread_pool(pool);
+            return -1;
+        }
+        pool->size++;
+    }
+
+    // deques must all exist before any thread starts stealing
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, run_pool_thread, &pool->deques[i]) != 0) {
+            err("init_thread_pool", "Unable to start pool thread!");
+            free_thread_pool(pool);
+            return -1;
+        }
+        pool->running++;
+    }
+    return 1;
+}
+
+/*
+ * Function: thread_pool_submit
+ *
+ * ----------------------------
+ *
+ *  Queues a task on one of the pool's deques and wakes an idle thread.
+ *
+ *  pool: pointer to the thread pool.
+ *  run: task function.
+ *  arg: argument passed to the task function.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int thread_pool_submit(ThreadPool* pool, TaskFunction run, void* arg) {
+    if (pool == NULL || run == NULL || pool->running == 0) {
+        return -1;
+    }
+
+    // counted before it is visible, so a thread taking it never sees pending drop below zero
+    Task task = {run, arg};
+    size_t index = atomic_fetch_add(&pool->next_deque, 1) % pool->size;
+    atomic_fetch_add(&pool->pending, 1);
+    if (task_deque_push(&pool->deques[index], task) == -1) {
+        atomic_fetch_sub(&pool->pending, 1);
+        return -1;
+    }
+
+    // sleepers register before re-checking pending, so one side sees the other
+    if (atomic_load(&pool->sleeping) > 0) {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return 1;
+}
+
+/*
+ * Function: free_thread_pool
+ *
+ * --------------------------
+ *
+ *  Runs the queued tasks, stops and joins the threads and frees the pool.
+ *
+ *  pool: pointer to the thread pool.
+ */
+void free_thread_pool(ThreadPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    atomic_store(&pool->stopping, 1);
+    pthread_mutex_lock(&pool->idle_lock);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (size_t i = 0; i < pool->running; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (size_t i = 0; i < pool->size; i++) {
+        free(pool->deques[i].tasks);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    free(pool->threads);
+    free(pool->deques);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    pool->threads = NULL;
+    pool->deques = NULL;
+    pool->size = 0;
+    pool->running = 0;
+}
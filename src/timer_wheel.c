@@ -0,0 +1,224 @@
+#include "../include/timer_wheel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_BITS)
+#define MAX_DELTA ((1ULL << LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) - 1)
+
+/*
+ * Function: init_timer_wheel
+ *
+ * --------------------------
+ *
+ *  Initializes an empty wheel.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  now: current monotonic time in milliseconds.
+ */
+void init_timer_wheel(TimerWheel* wheel, unsigned long long now) {
+    memset(wheel, 0, sizeof(TimerWheel));
+    wheel->now = now;
+}
+
+/*
+ * Function: init_timer
+ *
+ * --------------------
+ *
+ *  Initializes an inactive timer.
+ *
+ *  timer: pointer to the timer.
+ *  data: owner of the timer.
+ */
+void init_timer(Timer* timer, void* data) {
+    memset(timer, 0, sizeof(Timer));
+    timer->data = data;
+}
+
+static void link_timer(TimerWheel* wheel, Timer* timer) {
+    unsigned long long expires = timer->expires < wheel->now ? wheel->now : timer->expires;
+    unsigned long long delta = expires - wheel->now;
+    if (delta > MAX_DELTA) {
+        expires = wheel->now + MAX_DELTA;
+        delta = MAX_DELTA;
+    }
+
+    // the lowest level whose span covers the delta
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+    int slot = (expires >> LEVEL_SHIFT(level)) & TIMER_WHEEL_MASK;
+
+    Timer** head = &wheel->slots[level][slot];
+    timer->level = level;
+    timer->slot = slot;
+    timer->next = *head;
+    if (*head != NULL) (*head)->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+static void unlink_timer(TimerWheel* wheel, Timer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) timer->next->pprev = timer->pprev;
+    if (wheel->slots[timer->level][timer->slot] == NULL) {
+        wheel->occupied[timer->level] &= ~(1ULL << timer->slot);
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/*
+ * Function: timer_wheel_add
+ *
+ * -------------------------
+ *
+ *  Schedules the timer, moving it if it is already scheduled. Expiries in
+ *  the past fire on the next advance.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  timer: pointer to the timer.
+ *  expires: monotonic time in milliseconds.
+ */
+void timer_wheel_add(TimerWheel* wheel, Timer* timer, unsigned long long expires) {
+    if (timer->active) {
+        unlink_timer(wheel, timer);
+    } else {
+        timer->active = 1;
+        wheel->count++;
+    }
+    timer->expires = expires;
+    link_timer(wheel, timer);
+}
+
+/*
+ * Function: timer_wheel_remove
+ *
+ * ----------------------------
+ *
+ *  Cancels the timer. Inactive timers are ignored.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  timer: pointer to the timer.
+ */
+void timer_wheel_remove(TimerWheel* wheel, Timer* timer) {
+    if (!timer->active) {
+        return;
+    }
+    unlink_timer(wheel, timer);
+    timer->active = 0;
+    wheel->count--;
+}
+
+// Moves every timer of the slot reached at this tick one level down or more.
+static void cascade(TimerWheel* wheel, int level) {
+    int slot = (wheel->now >> LEVEL_SHIFT(level)) & TIMER_WHEEL_MASK;
+    Timer* timer = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(1ULL << slot);
+
+    while (timer != NULL) {
+        Timer* next = timer->next;
+        link_timer(wheel, timer);
+        timer = next;
+    }
+}
+
+/*
+ * Function: timer_wheel_advance
+ *
+ * -----------------------------
+ *
+ *  Moves the wheel up to now and detaches every expired timer.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  now: current monotonic time in milliseconds.
+ *  expired: receives the expired timers, linked through next.
+ *
+ *  returns: number of expired timers.
+ */
+size_t timer_wheel_advance(TimerWheel* wheel, unsigned long long now, Timer** expired) {
+    size_t expired_count = 0;
+    *expired = NULL;
+
+    while (wheel->now <= now) {
+        if (wheel->count == 0) {
+            wheel->now = now + 1;
+            break;
+        }
+
+        // upper levels are only visited when the level below wraps around
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (wheel->now & ((1ULL << LEVEL_SHIFT(level)) - 1)) break;
+            cascade(wheel, level);
+        }
+
+        int slot = wheel->now & TIMER_WHEEL_MASK;
+        Timer* timer = wheel->slots[0][slot];
+        wheel->slots[0][slot] = NULL;
+        wheel->occupied[0] &= ~(1ULL << slot);
+        while (timer != NULL) {
+            Timer* next = timer->next;
+            timer->active = 0;
+            timer->pprev = NULL;
+            timer->next = *expired;
+            *expired = timer;
+            wheel->count--;
+            expired_count++;
+            timer = next;
+        }
+
+        // skip the empty ticks up to the next used slot or the next wrap
+        unsigned long long next_tick = (wheel->now | TIMER_WHEEL_MASK) + 1;
+        uint64_t ahead = slot == TIMER_WHEEL_MASK ? 0 : wheel->occupied[0] & (~0ULL << (slot + 1));
+        if (ahead != 0) {
+            next_tick = (wheel->now & ~(unsigned long long) TIMER_WHEEL_MASK) + __builtin_ctzll(ahead);
+        }
+        wheel->now = next_tick < now + 1 ? next_tick : now + 1;
+    }
+    return expired_count;
+}
+
+/*
+ * Function: timer_wheel_timeout
+ *
+ * -----------------------------
+ *
+ *  Computes how long the event loop may wait. Timers on the upper levels
+ *  wake the loop when they have to move down, which may be earlier than
+ *  their expiry.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  now: current monotonic time in milliseconds.
+ *
+ *  returns: milliseconds to wait, (-1) if no timer is scheduled.
+ */
+int timer_wheel_timeout(TimerWheel* wheel, unsigned long long now) {
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    unsigned long long next_tick = ULLONG_MAX;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t occupied = wheel->occupied[level];
+        if (occupied == 0) continue;
+
+        // first block of this level the wheel has not processed yet
+        int shift = LEVEL_SHIFT(level);
+        unsigned long long block = (wheel->now + (1ULL << shift) - 1) >> shift;
+        int start = block & TIMER_WHEEL_MASK;
+        uint64_t rotated = start == 0 ? occupied : (occupied >> start) | (occupied << (TIMER_WHEEL_SLOTS - start));
+        unsigned long long tick = (block + __builtin_ctzll(rotated)) << shift;
+        if (tick < next_tick) next_tick = tick;
+    }
+
+    if (next_tick <= now) {
+        return 0;
+    }
+    unsigned long long timeout = next_tick - now;
+    return timeout > INT_MAX ? INT_MAX : (int) timeout;
+}
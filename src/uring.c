@@ -0,0 +1,417 @@
+#include "../include/uring.h"
+#include "../include/utils.h"
+
+#ifdef __linux__
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// glibc has no wrappers, liburing is not a dependency of the server
+static int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags, void* arg, size_t arg_size) {
+    return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void* arg, unsigned arg_count) {
+    return (int) syscall(__NR_io_uring_register, ring_fd, opcode, arg, arg_count);
+}
+
+/*
+ * Function: init_uring
+ *
+ * --------------------
+ *
+ *  Creates an io_uring instance and maps its rings.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: if failed or not supported (-1), on success (1).
+ */
+int init_uring(Uring* ring) {
+    if (ring == NULL) {
+        return -1;
+    }
+    memset(ring, 0, sizeof(Uring));
+    ring->ring_fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+    int ring_fd = io_uring_setup(URING_SQ_ENTRIES, &params);
+    if (ring_fd == -1) {
+        err("init_uring", "Unable to create io_uring instance!");
+        return -1;
+    }
+    ring->ring_fd = ring_fd;
+    ring->features = params.features;
+
+    // timed waits go through the extended enter argument
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+        err("init_uring", "Kernel io_uring is too old!");
+        free_uring(ring);
+        return -1;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        err("init_uring", "Unable to map the submission ring!");
+        free_uring(ring);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            err("init_uring", "Unable to map the completion ring!");
+            free_uring(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        err("init_uring", "Unable to map the submission entries!");
+        free_uring(ring);
+        return -1;
+    }
+
+    char* sq = (char*) ring->sq_ring;
+    ring->sq_head = (unsigned*) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*) (sq + params.sq_off.tail);
+    ring->sq_array = (unsigned*) (sq + params.sq_off.array);
+    ring->sq_mask = *(unsigned*) (sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+
+    char* cq = (char*) ring->cq_ring;
+    ring->cq_head = (unsigned*) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*) (cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+    return 1;
+}
+
+static int uring_enter(Uring* ring, unsigned min_complete, int timeout) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (min_complete > 0 && timeout >= 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (long long) (timeout % 1000) * 1000000;
+        arg.ts = (unsigned long long) (uintptr_t) &ts;
+    }
+    flags |= IORING_ENTER_EXT_ARG;
+
+    unsigned to_submit = ring->sq_pending;
+    int result = io_uring_enter(ring->ring_fd, to_submit, min_complete, flags, &arg, sizeof(arg));
+    if (result >= 0) {
+        ring->sq_pending -= (unsigned) result < to_submit ? (unsigned) result : to_submit;
+    }
+    return result;
+}
+
+/*
+ * Function: uring_get_sqe
+ *
+ * -----------------------
+ *
+ *  Returns a cleared submission entry, submitting the queued ones first
+ *  if the ring is full.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: pointer to the entry. if failed, NULL.
+ */
+struct io_uring_sqe* uring_get_sqe(Uring* ring) {
+    unsigned tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (uring_enter(ring, 0, -1) == -1) {
+            err("uring_get_sqe", "Unable to submit io_uring entries!");
+            return NULL;
+        }
+        if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+            return NULL;
+        }
+    }
+
+    unsigned index = tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[index] = index;
+    // published right away, the kernel only reads it on the next enter
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->sq_pending++;
+    return sqe;
+}
+
+/*
+ * Function: uring_reserve
+ *
+ * -----------------------
+ *
+ *  Makes room for count submission entries, submitting the queued ones if
+ *  the ring has less, so linked entries go to the kernel together.
+ *
+ *  ring: pointer to the ring.
+ *  count: number of entries needed.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int uring_reserve(Uring* ring, unsigned count) {
+    if (*ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) + count <= ring->sq_entries) {
+        return 1;
+    }
+    if (uring_enter(ring, 0, -1) == -1) {
+        err("uring_reserve", "Unable to submit io_uring entries!");
+        return -1;
+    }
+    return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) + count <= ring->sq_entries ? 1 : -1;
+}
+
+/*
+ * Function: uring_submit
+ *
+ * ----------------------
+ *
+ *  Submits the queued entries without waiting for completions.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: if failed (-1), on success (1).
+ */
+int uring_submit(Uring* ring) {
+    if (ring->sq_pending == 0) {
+        return 1;
+    }
+    return uring_enter(ring, 0, -1) == -1 ? -1 : 1;
+}
+
+/*
+ * Function: uring_submit_and_wait
+ *
+ * -------------------------------
+ *
+ *  Submits the queued entries and waits for at least one completion with
+ *  a single io_uring_enter call.
+ *
+ *  ring: pointer to the ring.
+ *  timeout: timeout in milliseconds, (-1) waits forever.
+ *
+ *  returns: if failed (-1), timed out (0), on success (1).
+ */
+int uring_submit_and_wait(Uring* ring, int timeout) {
+    if (uring_enter(ring, 1, timeout) == -1) {
+        if (errno == ETIME) {
+            return 0;
+        } else if (errno == EBUSY) {
+            // completions are waiting to be reaped
+            return 1;
+        }
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Function: uring_peek_cqe
+ *
+ * ------------------------
+ *
+ *  Returns the oldest unseen completion without waiting.
+ *
+ *  ring: pointer to the ring.
+ *
+ *  returns: pointer to the completion. NULL if none is ready.
+ */
+struct io_uring_cqe* uring_peek_cqe(Uring* ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+/*
+ * Function: uring_cqe_seen
+ *
+ * ------------------------
+ *
+ *  Hands the completion returned by uring_peek_cqe back to the kernel.
+ *
+ *  ring: pointer to the ring.
+ */
+void uring_cqe_seen(Uring* ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Function: init_uring_buffers
+ *
+ * ----------------------------
+ *
+ *  Allocates receive buffers and registers them with the ring as a buffer
+ *  group. Needs Linux 5.19.
+ *
+ *  ring: pointer to the ring.
+ *  buffers: pointer to the buffers.
+ *  group: buffer group id.
+ *  count: number of buffers, a power of two.
+ *  size: bytes per buffer.
+ *
+ *  returns: if failed or not supported (-1), on success (1).
+ */
+int init_uring_buffers(Uring* ring, UringBuffers* buffers, unsigned short group, unsigned count, size_t size) {
+    if (ring == NULL || buffers == NULL || count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return -1;
+    }
+    memset(buffers, 0, sizeof(UringBuffers));
+
+    // the entries are mapped by the kernel, they start on a page
+    size_t ring_size = count * sizeof(struct io_uring_buf);
+    long page_size = sysconf(_SC_PAGESIZE);
+    void* entries = NULL;
+    if (posix_memalign(&entries, page_size > 0 ? (size_t) page_size : 4096, ring_size) != 0) {
+        err("init_uring_buffers", "Unable to allocate memory for the buffer ring!");
+        return -1;
+    }
+    memset(entries, 0, ring_size);
+    buffers->ring = (struct io_uring_buf_ring*) entries;
+    buffers->memory = malloc(count * size);
+    if (buffers->memory == NULL) {
+        err("init_uring_buffers", "Unable to allocate memory for receive buffers!");
+        free(entries);
+        buffers->ring = NULL;
+        return -1;
+    }
+    buffers->group = group;
+    buffers->count = count;
+    buffers->size = size;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long long) (uintptr_t) entries;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (io_uring_register(ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        free(buffers->memory);
+        free(entries);
+        memset(buffers, 0, sizeof(UringBuffers));
+        return -1;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        struct io_uring_buf* buf = &buffers->ring->bufs[i];
+        buf->addr = (unsigned long long) (uintptr_t) (buffers->memory + i * size);
+        buf->len = (unsigned) size;
+        buf->bid = (unsigned short) i;
+    }
+    buffers->tail = (unsigned short) count;
+    __atomic_store_n(&buffers->ring->tail, buffers->tail, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/*
+ * Function: uring_buffer
+ *
+ * ----------------------
+ *
+ *  Returns the buffer the kernel picked for a completion.
+ *
+ *  buffers: pointer to the buffers.
+ *  id: buffer id from the completion's flags.
+ *
+ *  returns: pointer to the buffer's data.
+ */
+char* uring_buffer(UringBuffers* buffers, unsigned short id) {
+    return buffers->memory + (size_t) id * buffers->size;
+}
+
+/*
+ * Function: uring_buffer_release
+ *
+ * ------------------------------
+ *
+ *  Hands a buffer back to the kernel once its data has been taken.
+ *
+ *  buffers: pointer to the buffers.
+ *  id: buffer id from the completion's flags.
+ */
+void uring_buffer_release(UringBuffers* buffers, unsigned short id) {
+    struct io_uring_buf* buf = &buffers->ring->bufs[buffers->tail & (buffers->count - 1)];
+    buf->addr = (unsigned long long) (uintptr_t) uring_buffer(buffers, id);
+    buf->len = (unsigned) buffers->size;
+    buf->bid = id;
+    buffers->tail++;
+    // the entry is written before the kernel can see the new tail
+    __atomic_store_n(&buffers->ring->tail, buffers->tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * Function: free_uring_buffers
+ *
+ * ----------------------------
+ *
+ *  Unregisters the buffer group and frees its buffers.
+ *
+ *  ring: pointer to the ring, NULL if it is already closed.
+ *  buffers: pointer to the buffers.
+ */
+void free_uring_buffers(Uring* ring, UringBuffers* buffers) {
+    if (buffers == NULL || buffers->ring == NULL) return;
+    if (ring != NULL && ring->ring_fd >= 0) {
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = buffers->group;
+        io_uring_register(ring->ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    free(buffers->memory);
+    free(buffers->ring);
+    memset(buffers, 0, sizeof(UringBuffers));
+}
+
+/*
+ * Function: free_uring
+ *
+ * --------------------
+ *
+ *  Unmaps the rings and closes the instance.
+ *
+ *  ring: pointer to the ring.
+ */
+void free_uring(Uring* ring) {
+    if (ring == NULL) return;
+    if (ring->sqes != NULL) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring != NULL) munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+    memset(ring, 0, sizeof(Uring));
+    ring->ring_fd = -1;
+}
+#endif
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 /*
 * Function err
@@ -210,3 +211,16 @@ ssize_t get_line(char **line_ptr, size_t *size, FILE *stream) {
 	// Return the size of string
 	return pos;
 }
+
+/*
+* Function monotonic_ms
+* ---------------------
+*  Returns a monotonic timestamp, unaffected by wall clock changes.
+*
+*  returns: Milliseconds since an unspecified starting point.
+*/
+unsigned long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
@@ -0,0 +1,135 @@
+#include "test.h"
+#include "../include/body.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TEST_MEMORY_LIMIT 1000
+#define TEST_TEMP_DIR "/tmp"
+
+// a body of size bytes that tells its offsets apart
+static void fill_pattern(char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (char) (i * 7 + i / 251);
+    }
+}
+
+/*
+ * Function: read_back
+ *
+ * -------------------
+ *
+ *  Reads the whole body in chunks of an odd size and compares it with
+ *  what was appended.
+ *
+ *  body: pointer to the body.
+ *  expected: bytes appended.
+ *  size: number of bytes appended.
+ *
+ *  returns: the body reads back unchanged (1), otherwise (0).
+ */
+static int read_back(RequestBody* body, const char* expected, size_t size) {
+    char chunk[333];
+    size_t offset = 0;
+    ssize_t read_bytes;
+    while ((read_bytes = request_body_read(body, chunk, sizeof(chunk))) > 0) {
+        if (offset + read_bytes > size || memcmp(chunk, expected + offset, read_bytes) != 0) {
+            return 0;
+        }
+        offset += read_bytes;
+    }
+    return read_bytes == 0 && offset == size;
+}
+
+// the spill file never has a name, so nothing is left behind by a crash
+static int spill_file_unlinked(const RequestBody* body) {
+    struct stat st;
+    return body->spilled && fstat(body->fd, &st) == 0 && st.st_nlink == 0;
+}
+
+static void test_declared_length(Arena* arena, const char* data) {
+    RequestBody body;
+    CHECK(init_request_body(&body, arena, TEST_MEMORY_LIMIT, TEST_MEMORY_LIMIT, TEST_TEMP_DIR) == 1);
+    CHECK(!body.spilled);
+    CHECK(body.capacity == TEST_MEMORY_LIMIT);
+    CHECK(request_body_append(&body, data, TEST_MEMORY_LIMIT) == 1);
+    CHECK(!body.spilled);
+    CHECK(read_back(&body, data, TEST_MEMORY_LIMIT));
+    free_request_body(&body);
+
+    // one byte over the limit goes to the file before anything arrives
+    CHECK(init_request_body(&body, arena, TEST_MEMORY_LIMIT + 1, TEST_MEMORY_LIMIT, TEST_TEMP_DIR) == 1);
+    CHECK(spill_file_unlinked(&body));
+    CHECK(request_body_append(&body, data, TEST_MEMORY_LIMIT + 1) == 1);
+    CHECK(body.size == TEST_MEMORY_LIMIT + 1);
+    CHECK(read_back(&body, data, TEST_MEMORY_LIMIT + 1));
+    int fd = body.fd;
+    free_request_body(&body);
+    CHECK(fcntl(fd, F_GETFD) == -1);
+}
+
+static void test_unknown_length(Arena* arena, const char* data) {
+    RequestBody body;
+    // chunks that land on the limit stay in memory
+    CHECK(init_request_body(&body, arena, 0, TEST_MEMORY_LIMIT, TEST_TEMP_DIR) == 1);
+    CHECK(!body.spilled && body.capacity == 0);
+    for (size_t offset = 0; offset < TEST_MEMORY_LIMIT; offset += 100) {
+        CHECK(request_body_append(&body, data + offset, 100) == 1);
+    }
+    CHECK(!body.spilled);
+    CHECK(body.capacity == TEST_MEMORY_LIMIT);
+    CHECK(request_body_append(&body, data, 0) == 1);
+    CHECK(!body.spilled);
+
+    // the next byte moves what was kept to the file along with it
+    CHECK(request_body_append(&body, data + TEST_MEMORY_LIMIT, 1) == 1);
+    CHECK(spill_file_unlinked(&body));
+    CHECK(body.data == NULL);
+    CHECK(request_body_append(&body, data + TEST_MEMORY_LIMIT + 1, 4000) == 1);
+    CHECK(body.size == TEST_MEMORY_LIMIT + 4001);
+    CHECK(read_back(&body, data, TEST_MEMORY_LIMIT + 4001));
+    free_request_body(&body);
+
+    // a single append past the limit
+    CHECK(init_request_body(&body, arena, 0, TEST_MEMORY_LIMIT, TEST_TEMP_DIR) == 1);
+    CHECK(request_body_append(&body, data, 10) == 1);
+    CHECK(request_body_append(&body, data + 10, TEST_MEMORY_LIMIT) == 1);
+    CHECK(spill_file_unlinked(&body));
+    CHECK(read_back(&body, data, TEST_MEMORY_LIMIT + 10));
+    free_request_body(&body);
+}
+
+static void test_spill_edges(Arena* arena, const char* data) {
+    RequestBody body;
+    // without an arena every byte goes to the file
+    CHECK(init_request_body(&body, NULL, 0, TEST_MEMORY_LIMIT, TEST_TEMP_DIR) == 1);
+    CHECK(request_body_append(&body, data, 1) == 1);
+    CHECK(spill_file_unlinked(&body));
+    CHECK(read_back(&body, data, 1));
+    free_request_body(&body);
+
+    // nothing to read from an empty body
+    char chunk[16];
+    CHECK(init_request_body(&body, arena, 0, TEST_MEMORY_LIMIT, TEST_TEMP_DIR) == 1);
+    CHECK(request_body_read(&body, chunk, sizeof(chunk)) == 0);
+    free_request_body(&body);
+
+    CHECK(init_request_body(&body, arena, TEST_MEMORY_LIMIT + 1, TEST_MEMORY_LIMIT, "/nonexistent-dir") == -1);
+    free_request_body(&body);
+}
+
+void test_body(void) {
+    static char data[TEST_MEMORY_LIMIT + 4001];
+    fill_pattern(data, sizeof(data));
+    char block[4096];
+    Arena arena;
+    init_arena(&arena, block, sizeof(block));
+
+    test_declared_length(&arena, data);
+    reset_arena(&arena);
+    test_unknown_length(&arena, data);
+    reset_arena(&arena);
+    test_spill_edges(&arena, data);
+    free_arena(&arena);
+}
@@ -0,0 +1,147 @@
+#include "test.h"
+#include "../include/chunked.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_BODY_MAX 8192
+
+// what a whole feed of a chunked body came to
+typedef struct {
+    char decoded[TEST_BODY_MAX];
+    size_t decoded_size;
+    size_t consumed; // received bytes used up, what follows is the next request
+    int status;      // complete (1), more to come (0), malformed (-1)
+} DecodeResult;
+
+/*
+ * Function: decode_in_pieces
+ *
+ * --------------------------
+ *
+ *  Feeds an encoded body to a fresh decoder in pieces of the given size,
+ *  the way reads hand it over, and joins the decoded bytes. Bytes a call
+ *  leaves unconsumed are passed again with the next piece.
+ *
+ *  raw: encoded body, possibly followed by another request.
+ *  size: number of bytes.
+ *  piece: bytes per read, size for a single read.
+ *  result: receives the decoded body.
+ */
+static void decode_in_pieces(const char* raw, size_t size, size_t piece, DecodeResult* result) {
+    static char buffer[TEST_BODY_MAX];
+    ChunkedDecoder decoder;
+    init_chunked_decoder(&decoder);
+    result->decoded_size = 0;
+    result->consumed = 0;
+    result->status = 0;
+
+    size_t offset = 0;
+    while (offset < size && !chunked_decoder_done(&decoder)) {
+        size_t length = size - offset < piece ? size - offset : piece;
+        memcpy(buffer, raw + offset, length);
+        size_t consumed = 0;
+        ssize_t decoded = chunked_decode(&decoder, buffer, length, &consumed);
+        if (decoded == -1) {
+            result->status = -1;
+            return;
+        }
+        memcpy(result->decoded + result->decoded_size, buffer, decoded);
+        result->decoded_size += decoded;
+        offset += consumed;
+    }
+    result->consumed = offset;
+    result->status = chunked_decoder_done(&decoder);
+}
+
+// decodes in reads of every size down to single bytes, expecting the same body each time
+static void check_decodes(const char* raw, const char* expected, size_t trailing) {
+    static DecodeResult result;
+    size_t size = strlen(raw);
+    size_t expected_size = strlen(expected);
+    int same = 1;
+    for (size_t piece = size; piece >= 1 && same; piece--) {
+        decode_in_pieces(raw, size, piece, &result);
+        same = result.status == 1 && result.consumed == size - trailing && result.decoded_size == expected_size &&
+               memcmp(result.decoded, expected, expected_size) == 0;
+        if (!same) {
+            printf("\t%zu byte reads of %.20s...: status %d\n", piece, raw, result.status);
+        }
+    }
+    CHECK(same);
+}
+
+static int decode_status(const char* raw) {
+    static DecodeResult result;
+    decode_in_pieces(raw, strlen(raw), strlen(raw), &result);
+    return result.status;
+}
+
+static void test_valid_bodies(void) {
+    check_decodes("5\r\nhello\r\n0\r\n\r\n", "hello", 0);
+    check_decodes("A\r\n0123456789\r\n1\r\n!\r\n0\r\n\r\n", "0123456789!", 0);
+    check_decodes("0\r\n\r\n", "", 0);
+    check_decodes("0005\r\nhello\r\n000\r\n\r\n", "hello", 0);
+
+    // extensions are skipped, with or without whitespace before them
+    check_decodes("3;foo=bar\r\nabc\r\n2 ; x\r\nde\r\n1\t;q=\"a;b\"\r\nf\r\n0;last\r\n\r\n", "abcdef", 0);
+
+    // trailer fields are read and dropped
+    check_decodes("3\r\nabc\r\n0\r\nX-Sum: 1\r\nY: 2\r\n\r\n", "abc", 0);
+
+    // the next pipelined request is left alone
+    check_decodes("3\r\nabc\r\n0\r\n\r\nGET / HTTP/1.1\r\n\r\n", "abc", strlen("GET / HTTP/1.1\r\n\r\n"));
+}
+
+static void test_malformed_bodies(void) {
+    CHECK(decode_status("zz\r\nhello\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("\r\nhello\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status(";ext\r\nhello\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("-5\r\nhello\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("0x5\r\nhello\r\n0\r\n\r\n") == -1);
+
+    // bare LF is read differently by some hops
+    CHECK(decode_status("5\nhello\n0\n\n") == -1);
+    CHECK(decode_status("5\r\nhello\n0\r\n\r\n") == -1);
+    CHECK(decode_status("5;ext\nhello\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("0\r\nX: 1\n\r\n") == -1);
+
+    // data has to end where its size says
+    CHECK(decode_status("5\r\nhelloX\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("5\r\nhell\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("0\r\nX: 1\r\nbroken\r\r\n") == -1);
+}
+
+static void test_limits(void) {
+    // sizes up to SIZE_MAX are taken, the body limit is the caller's
+    CHECK(decode_status("ffffffffffffffff\r\nabc") == 0);
+    CHECK(decode_status("10000000000000000\r\nhello\r\n0\r\n\r\n") == -1);
+    CHECK(decode_status("fffffffffffffffff\r\n") == -1);
+    CHECK(decode_status("00000000000000000000000001\r\na\r\n0\r\n\r\n") == 1);
+
+    // an endless size line or trailer
+    char* raw = malloc(CHUNKED_TRAILER_MAX + 64);
+    if (!CHECK(raw != NULL)) {
+        return;
+    }
+    strcpy(raw, "1;");
+    memset(raw + 2, 'e', CHUNKED_LINE_MAX);
+    strcpy(raw + 2 + CHUNKED_LINE_MAX, "\r\na\r\n0\r\n\r\n");
+    CHECK(decode_status(raw) == -1);
+    strcpy(raw, "1;");
+    memset(raw + 2, 'e', CHUNKED_LINE_MAX - 4);
+    strcpy(raw + CHUNKED_LINE_MAX - 2, "\r\na\r\n0\r\n\r\n");
+    CHECK(decode_status(raw) == 1);
+
+    strcpy(raw, "0\r\nX: ");
+    memset(raw + 6, 'v', CHUNKED_TRAILER_MAX);
+    strcpy(raw + 6 + CHUNKED_TRAILER_MAX, "\r\n\r\n");
+    CHECK(decode_status(raw) == -1);
+    free(raw);
+}
+
+void test_chunked(void) {
+    test_valid_bodies();
+    test_malformed_bodies();
+    test_limits();
+}
@@ -0,0 +1,104 @@
+#include "test.h"
+#include "../include/output_queue.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+// the iovecs of one gathered send, joined
+static size_t join_iov(const struct iovec* iov, size_t iov_count, char* out) {
+    size_t size = 0;
+    for (size_t i = 0; i < iov_count; i++) {
+        memcpy(out + size, iov[i].iov_base, iov[i].iov_len);
+        size += iov[i].iov_len;
+    }
+    out[size] = '\0';
+    return size;
+}
+
+/*
+ * Function: test_sealed_gather
+ *
+ * ----------------------------
+ *
+ *  Output appended while a gathered send is in flight goes to a new
+ *  segment, the bytes handed to the kernel stay where they were. The
+ *  send's partial completion leaves the rest for the next gather.
+ */
+static void test_sealed_gather(void) {
+    OutputQueue output;
+    init_output_queue(&output, NULL, NULL);
+    struct iovec iov[OUTPUT_IOV_MAX];
+    char joined[64];
+    size_t size;
+
+    output_queue_write(&output, "abc", 3);
+    CHECK(output_queue_gather(&output, iov, OUTPUT_IOV_MAX, &size) == 1);
+    CHECK(size == 3);
+    const char* in_flight = iov[0].iov_base;
+    output_queue_seal(&output);
+
+    output_queue_write(&output, "def", 3);
+    CHECK(memcmp(in_flight, "abc", 3) == 0);
+    CHECK(output_queue_pending(&output) == 6);
+
+    output_queue_advance(&output, 2);
+    size_t iov_count = output_queue_gather(&output, iov, OUTPUT_IOV_MAX, &size);
+    CHECK(iov_count == 2);
+    CHECK(size == 4);
+    join_iov(iov, iov_count, joined);
+    CHECK(strcmp(joined, "cdef") == 0);
+
+    output_queue_advance(&output, size);
+    CHECK(output_queue_pending(&output) == 0);
+    CHECK(output_queue_gather(&output, iov, OUTPUT_IOV_MAX, &size) == 0);
+    CHECK(size == 0);
+    free_output_queue(&output);
+}
+
+/*
+ * Function: test_file_advance
+ *
+ * ---------------------------
+ *
+ *  A gather stops at a file segment, whose range is then consumed by
+ *  the sends reading it in chunks, before the buffer behind it is
+ *  gathered.
+ */
+static void test_file_advance(void) {
+    OutputQueue output;
+    init_output_queue(&output, NULL, NULL);
+    struct iovec iov[OUTPUT_IOV_MAX];
+    char joined[64];
+    size_t size;
+
+    int fd = open("/dev/null", O_RDONLY);
+    if (!CHECK(fd != -1)) {
+        return;
+    }
+    output_queue_write(&output, "hdr", 3);
+    output_queue_file(&output, fd, 100, 10);
+    output_queue_write(&output, "tail", 4);
+    CHECK(output_queue_pending(&output) == 17);
+
+    CHECK(output_queue_gather(&output, iov, OUTPUT_IOV_MAX, &size) == 1);
+    CHECK(size == 3);
+    output_queue_advance(&output, 3);
+    CHECK(output_queue_gather(&output, iov, OUTPUT_IOV_MAX, &size) == 0);
+    if (CHECK(output.head != NULL && output.head->type == OUTPUT_SEGMENT_FILE)) {
+        output_queue_advance(&output, 4);
+        CHECK(output.head->offset == 104);
+        CHECK(output.head->length == 6);
+    }
+
+    output_queue_advance(&output, 6);
+    size_t iov_count = output_queue_gather(&output, iov, OUTPUT_IOV_MAX, &size);
+    CHECK(iov_count == 1);
+    join_iov(iov, iov_count, joined);
+    CHECK(strcmp(joined, "tail") == 0);
+    free_output_queue(&output);
+}
+
+void test_output_queue(void) {
+    test_sealed_gather();
+    test_file_advance();
+}
@@ -0,0 +1,72 @@
+#include "test.h"
+#include "../include/range.h"
+
+#include <stdint.h>
+
+/*
+ * Function: check_ranges
+ *
+ * ----------------------
+ *
+ *  Parses a Range value against a representation size and compares the
+ *  result with the expected ranges.
+ *
+ *  value: Range header value.
+ *  size: size of the representation.
+ *  expected_count: expected result of parse_byte_ranges.
+ *  expected: expected start and length pairs, expected_count of them.
+ */
+static void check_ranges(const char* value, size_t size, int expected_count, const size_t* expected) {
+    ByteRange ranges[MAX_BYTE_RANGES];
+    int count = parse_byte_ranges(value, size, ranges, MAX_BYTE_RANGES);
+    if (!CHECK(count == expected_count)) {
+        printf("\t%s on %zu bytes gave %d ranges\n", value, size, count);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        CHECK(ranges[i].start == expected[i * 2]);
+        CHECK(ranges[i].length == expected[i * 2 + 1]);
+    }
+}
+
+void test_range(void) {
+    // single, open ended, clamped and suffix ranges
+    check_ranges("bytes=0-99", 1000, 1, (size_t[]) {0, 100});
+    check_ranges("bytes=900-", 1000, 1, (size_t[]) {900, 100});
+    check_ranges("bytes=990-2000", 1000, 1, (size_t[]) {990, 10});
+    check_ranges("bytes=-100", 1000, 1, (size_t[]) {900, 100});
+    check_ranges("bytes=-5000", 1000, 1, (size_t[]) {0, 1000});
+    check_ranges("bytes=999-999", 1000, 1, (size_t[]) {999, 1});
+    check_ranges(" Bytes = 1-2 ", 1000, 1, (size_t[]) {1, 2});
+
+    // several, in request order, with empty list elements
+    check_ranges("bytes=500-599, 0-9,-10", 1000, 3, (size_t[]) {500, 100, 0, 10, 990, 10});
+    check_ranges("bytes=,0-0,,1-1,", 1000, 2, (size_t[]) {0, 1, 1, 1});
+
+    // unsatisfiable ones are dropped, none left is a 416
+    check_ranges("bytes=1000-", 1000, 0, NULL);
+    check_ranges("bytes=1000-1999, 0-0", 1000, 1, (size_t[]) {0, 1});
+    check_ranges("bytes=-0", 1000, 0, NULL);
+    check_ranges("bytes=0-", 0, 0, NULL);
+    check_ranges("bytes=-10", 0, 0, NULL);
+
+    // malformed headers are ignored
+    check_ranges("items=0-1", 1000, -1, NULL);
+    check_ranges("bytes 0-1", 1000, -1, NULL);
+    check_ranges("bytes=", 1000, -1, NULL);
+    check_ranges("bytes=,", 1000, -1, NULL);
+    check_ranges("bytes=-", 1000, -1, NULL);
+    check_ranges("bytes=5-1", 1000, -1, NULL);
+    check_ranges("bytes=1-2-3", 1000, -1, NULL);
+    check_ranges("bytes=a-b", 1000, -1, NULL);
+    check_ranges("bytes=99999999999999999999999-", 1000, -1, NULL);
+
+    // more ranges than fit, the whole file is sent instead
+    char many[256];
+    size_t used = snprintf(many, sizeof(many), "bytes=");
+    for (int i = 0; i <= MAX_BYTE_RANGES; i++) {
+        used += snprintf(many + used, sizeof(many) - used, i == 0 ? "%d-%d" : ",%d-%d", i * 2, i * 2);
+    }
+    check_ranges(many, 1000, -1, NULL);
+    CHECK(parse_byte_ranges(NULL, 1000, NULL, 0) == -1);
+}
@@ -0,0 +1,179 @@
+#include "test.h"
+#include "../include/request.h"
+#include "../include/scan.h"
+
+#include <string.h>
+
+// long enough that the vector scanners run over several blocks of every token
+static const char PIPELINED_REQUEST[] =
+    "\r\n"
+    "POST /a/fairly/long/path/to/cross/a/couple/of/vector/blocks?query=string&more=values HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "User-Agent: test-client/1.0 (a user agent long enough for two avx2 blocks)\r\n"
+    "Accept:text/html\r\n"
+    "X-Custom-Header-With-A-Long-Name:  padded value\t \r\n"
+    "Content-Length: 5\n"
+    "Empty:\r\n"
+    "\r\n"
+    "hello";
+
+// a request parsed from a private copy, the parser terminates tokens in place
+typedef struct {
+    char data[1024];
+    HTTPRequest req;
+    HTTPParser parser;
+} ParsedRequest;
+
+static int parse_request(ParsedRequest* parsed, const char* raw) {
+    size_t size = strlen(raw);
+    memcpy(parsed->data, raw, size + 1);
+    memset(&parsed->req, 0, sizeof(parsed->req));
+    init_http_parser(&parsed->parser);
+    return parse_header(&parsed->parser, &parsed->req, parsed->data, size);
+}
+
+// the parse of PIPELINED_REQUEST, however it was fed
+static void check_pipelined_request(const ParsedRequest* parsed) {
+    const HTTPRequest* req = &parsed->req;
+    CHECK(strcmp(http_req_method(req), "POST") == 0);
+    CHECK(strncmp(http_req_path(req), "/a/fairly/long/path", 19) == 0);
+    CHECK(strcmp(http_req_version(req), "HTTP/1.1") == 0);
+    CHECK(req->http_header.field_count == 6);
+    CHECK(strcmp(http_req_known_header(req, HTTP_HEADER_HOST), "example.com") == 0);
+    CHECK(strcmp(http_req_header(req, "accept"), "text/html") == 0);
+    CHECK(strcmp(http_req_header(req, "x-custom-header-with-a-long-name"), "padded value") == 0);
+    CHECK(strcmp(http_req_known_header(req, HTTP_HEADER_CONTENT_LENGTH), "5") == 0);
+    CHECK(strcmp(http_req_header(req, "Empty"), "") == 0);
+    CHECK(http_req_header(req, "Missing") == NULL);
+    // the body is left for the caller
+    CHECK(strcmp(parsed->data + parsed->parser.offset, "hello") == 0);
+}
+
+/*
+ * Function: test_split_points
+ *
+ * ---------------------------
+ *
+ *  Feeds the request in two reads at every possible split, and one byte
+ *  at a time, with every scanner this CPU has. Each feed has to end with
+ *  the same parse as a single read.
+ */
+static void test_split_points(void) {
+    static ParsedRequest parsed;
+    size_t size = strlen(PIPELINED_REQUEST);
+    size_t header_size = size - strlen("hello");
+    CHECK(parse_request(&parsed, PIPELINED_REQUEST) == 1);
+    CHECK(parsed.parser.offset == header_size);
+    check_pipelined_request(&parsed);
+
+    ScanLevel initial_level = get_scan_level();
+    for (int level = SCAN_SCALAR; level <= SCAN_AVX2; level++) {
+        if (set_scan_level((ScanLevel) level) == -1) {
+            continue;
+        }
+        int consistent = 1;
+        for (size_t split = 0; split <= header_size; split++) {
+            memcpy(parsed.data, PIPELINED_REQUEST, size + 1);
+            memset(&parsed.req, 0, sizeof(parsed.req));
+            init_http_parser(&parsed.parser);
+            int first = parse_header(&parsed.parser, &parsed.req, parsed.data, split);
+            int second = parse_header(&parsed.parser, &parsed.req, parsed.data, size);
+            if ((split < header_size ? first != 0 : first != 1) || second != 1 ||
+                parsed.parser.offset != header_size || parsed.req.http_header.field_count != 6) {
+                printf("\t%s scanner, split at %zu: %d then %d\n", scan_level_name((ScanLevel) level), split, first,
+                       second);
+                consistent = 0;
+            }
+        }
+        CHECK(consistent);
+
+        memcpy(parsed.data, PIPELINED_REQUEST, size + 1);
+        memset(&parsed.req, 0, sizeof(parsed.req));
+        init_http_parser(&parsed.parser);
+        int result = 0;
+        size_t fed = 0;
+        while (result == 0 && fed < size) {
+            result = parse_header(&parsed.parser, &parsed.req, parsed.data, ++fed);
+        }
+        CHECK(result == 1);
+        CHECK(fed == header_size);
+        check_pipelined_request(&parsed);
+    }
+    set_scan_level(initial_level);
+}
+
+static void test_line_endings(void) {
+    static ParsedRequest parsed;
+    // bare LF ends lines like CRLF does
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\nHost: a\n\n") == 1);
+    CHECK(strcmp(http_req_known_header(&parsed.req, HTTP_HEADER_HOST), "a") == 0);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nHost: a\n\r\n") == 1);
+    // a CR has to be followed by its LF
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\rHost: a\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nHost: a\r\n\rX") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n") == -1);
+
+    // empty lines ahead of the request line are skipped
+    CHECK(parse_request(&parsed, "\r\n\n\r\nGET / HTTP/1.1\r\n\r\n") == 1);
+    CHECK(strcmp(http_req_method(&parsed.req), "GET") == 0);
+    CHECK(parse_request(&parsed, "\r\n\r\n") == 0);
+    CHECK(parse_request(&parsed, " GET / HTTP/1.1\r\n\r\n") == -1);
+
+    // obsolete line folding is refused
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nX-A: one\r\n two\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nX-A: one\r\n\ttwo\r\n\r\n") == -1);
+}
+
+static void test_malformed(void) {
+    static ParsedRequest parsed;
+    CHECK(parse_request(&parsed, "GET  / HTTP/1.1\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET /a b HTTP/1.1\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / FTP/1.1\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "G(T / HTTP/1.1\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nNo Colon\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\n: empty name\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nName : space\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nX: bell\a\r\n\r\n") == -1);
+}
+
+static void test_duplicates(void) {
+    static ParsedRequest parsed;
+    // read differently by another hop, so refused
+    CHECK(parse_request(&parsed, "POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                                 "Transfer-Encoding: chunked\r\n\r\n") == -1);
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nHost: a\r\nHOST: b\r\n\r\n") == -1);
+
+    // other repeated headers are kept, the first one is the known one
+    CHECK(parse_request(&parsed, "GET / HTTP/1.1\r\nAccept: a\r\nAccept: b\r\nX: 1\r\nX: 2\r\n\r\n") == 1);
+    CHECK(parsed.req.http_header.field_count == 4);
+    CHECK(strcmp(http_req_known_header(&parsed.req, HTTP_HEADER_ACCEPT), "a") == 0);
+    CHECK(strcmp(http_req_header(&parsed.req, "x"), "1") == 0);
+}
+
+// a request with count fields named F0, F1, ...
+static int parse_with_fields(ParsedRequest* parsed, size_t count) {
+    static char raw[1024];
+    size_t used = snprintf(raw, sizeof(raw), "GET / HTTP/1.1\r\n");
+    for (size_t i = 0; i < count; i++) {
+        used += snprintf(raw + used, sizeof(raw) - used, "F%zu: v\r\n", i);
+    }
+    snprintf(raw + used, sizeof(raw) - used, "\r\n");
+    return parse_request(parsed, raw);
+}
+
+static void test_field_limit(void) {
+    static ParsedRequest parsed;
+    CHECK(parse_with_fields(&parsed, MAX_HEADER_FIELDS) == 1);
+    CHECK(parsed.req.http_header.field_count == MAX_HEADER_FIELDS);
+    CHECK(parse_with_fields(&parsed, MAX_HEADER_FIELDS + 1) == -1);
+}
+
+void test_request(void) {
+    test_split_points();
+    test_line_endings();
+    test_malformed();
+    test_duplicates();
+    test_field_limit();
+}
@@ -0,0 +1,416 @@
+#include "test.h"
+#include "../include/connection.h"
+#include "../include/request.h"
+#include "../include/router.h"
+#include "../include/file_manager.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TEST_RESPONSE_SIZE (256 * 1024)
+
+typedef struct {
+    List routes;
+    FileTable file_table;
+} RouterFixture;
+
+// the bytes a client reads for every request of the pipeline, in order
+typedef struct {
+    char data[TEST_RESPONSE_SIZE];
+    size_t size;
+} ClientView;
+
+/*
+ * Function: drain_output
+ *
+ * ----------------------
+ *
+ *  Sends the queue over a socket pair and collects what arrives on the other
+ *  end, sendfile segments included.
+ *
+ *  output: queue holding the serialized responses.
+ *  view: receives the bytes.
+ *
+ *  returns: if successful (1), otherwise (-1).
+ */
+static int drain_output(OutputQueue* output, ClientView* view) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        return -1;
+    }
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+    fcntl(sv[1], F_SETFL, O_NONBLOCK);
+    int status = 1;
+    while (output_queue_pending(output) > 0 || status == 1) {
+        if (output_queue_pending(output) > 0 && output_queue_send(output, sv[0]) == -1) {
+            status = -1;
+            break;
+        }
+        ssize_t received = read(sv[1], view->data + view->size, sizeof(view->data) - 1 - view->size);
+        if (received > 0) {
+            view->size += received;
+        } else if (output_queue_pending(output) == 0) {
+            break;
+        }
+    }
+    view->data[view->size] = '\0';
+    close(sv[0]);
+    close(sv[1]);
+    return status;
+}
+
+/*
+ * Function: serve_pipeline
+ *
+ * ------------------------
+ *
+ *  Parses and routes every request of a pipelined buffer into one output
+ *  queue, the way a worker answers them on a keep-alive connection.
+ *
+ *  fixture: routes and files.
+ *  raw: the requests back to back.
+ *  sendfile_threshold: file size from which bodies are sent with sendfile.
+ *  view: receives the responses.
+ *
+ *  returns: number of requests answered, -1 if one did not parse.
+ */
+static int serve_pipeline(RouterFixture* fixture, const char* raw, size_t sendfile_threshold, ClientView* view) {
+    size_t size = strlen(raw);
+    char* copy = malloc(size + 1);
+    memcpy(copy, raw, size + 1);
+    char arena_block[REQUEST_ARENA_SIZE];
+    Arena arena;
+    init_arena(&arena, arena_block, sizeof(arena_block));
+    OutputQueue output;
+    init_output_queue(&output, NULL, NULL);
+    DateCache date = {0};
+    update_date_cache(&date, 0);
+
+    int answered = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        HTTPRequest req;
+        memset(&req, 0, sizeof(req));
+        req.arena = &arena;
+        HTTPParser parser;
+        init_http_parser(&parser);
+        if (parse_header(&parser, &req, copy + offset, size - offset) != 1) {
+            answered = -1;
+            free_http_req(&req);
+            break;
+        }
+        offset += parser.offset;
+        ResponseWriter writer = {
+            .output = &output,
+            .keep_alive = 1,
+            .keep_alive_timeout = 5,
+            .keep_alive_max = 100,
+            .sendfile_threshold = sendfile_threshold,
+            .chunked = 1,
+            .date = &date,
+            .head = strcmp(http_req_method(&req), "HEAD") == 0,
+        };
+        router(&fixture->routes, &req, &writer, &fixture->file_table);
+        free_http_req(&req);
+        answered++;
+    }
+    view->size = 0;
+    if (drain_output(&output, view) == -1) {
+        answered = -1;
+    }
+    free_output_queue(&output);
+    free_arena(&arena);
+    free(copy);
+    return answered;
+}
+
+/*
+ * Function: content_length
+ *
+ * ------------------------
+ *
+ *  Reads the Content-Length of the response starting at a status line.
+ *
+ *  response: start of the response.
+ *
+ *  returns: the length, -1 without the header.
+ */
+static long content_length(const char* response) {
+    const char* header_end = strstr(response, "\r\n\r\n");
+    const char* field = strstr(response, "Content-Length: ");
+    if (header_end == NULL || field == NULL || field > header_end) {
+        return -1;
+    }
+    return strtol(field + strlen("Content-Length: "), NULL, 10);
+}
+
+// size of a file under the document root
+static long docs_file_size(const char* path) {
+    char full_path[256];
+    snprintf(full_path, sizeof(full_path), "%s%s", DEFAULT_SERVER_PATH, path);
+    struct stat st;
+    return stat(full_path, &st) == 0 ? (long) st.st_size : -1;
+}
+
+// contents of a file under the document root, NUL terminated, its size at most
+static long read_docs_file(const char* path, char* data, size_t size) {
+    char full_path[256];
+    snprintf(full_path, sizeof(full_path), "%s%s", DEFAULT_SERVER_PATH, path);
+    int fd = open(full_path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t read_size = read(fd, data, size - 1);
+    close(fd);
+    data[read_size > 0 ? read_size : 0] = '\0';
+    return read_size;
+}
+
+/*
+ * Function: header_value
+ *
+ * ----------------------
+ *
+ *  Copies a header of the response starting at a status line.
+ *
+ *  response: start of the response.
+ *  name: header name with its colon and space, e.g. "ETag: ".
+ *  value: receives the value.
+ *  size: capacity of value.
+ *
+ *  returns: if found (1), otherwise (0).
+ */
+static int header_value(const char* response, const char* name, char* value, size_t size) {
+    const char* header_end = strstr(response, "\r\n\r\n");
+    const char* field = strstr(response, name);
+    if (header_end == NULL || field == NULL || field > header_end) {
+        return 0;
+    }
+    field += strlen(name);
+    size_t length = strcspn(field, "\r");
+    if (length >= size) {
+        return 0;
+    }
+    memcpy(value, field, length);
+    value[length] = '\0';
+    return 1;
+}
+
+// the body of a single response
+static const char* response_body(const ClientView* view) {
+    const char* header_end = strstr(view->data, "\r\n\r\n");
+    return header_end != NULL ? header_end + 4 : view->data + view->size;
+}
+
+/*
+ * Function: check_head_then_get
+ *
+ * -----------------------------
+ *
+ *  Pipelines a HEAD and a GET for the same file. The HEAD response carries
+ *  the GET's Content-Length but no body, so the GET's status line follows
+ *  its empty line directly.
+ *
+ *  fixture: routes and files.
+ *  path: file or route to request.
+ *  sendfile_threshold: 1 to send the body with sendfile, else from memory.
+ */
+static void check_head_then_get(RouterFixture* fixture, const char* path, size_t sendfile_threshold) {
+    char raw[512];
+    snprintf(raw, sizeof(raw),
+             "HEAD %s HTTP/1.1\r\nHost: localhost\r\n\r\n"
+             "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n",
+             path, path);
+    static ClientView view;
+    if (!CHECK(serve_pipeline(fixture, raw, sendfile_threshold, &view) == 2)) {
+        return;
+    }
+    const char* head_response = view.data;
+    const char* head_end = strstr(head_response, "\r\n\r\n");
+    if (!CHECK(strncmp(head_response, "HTTP/1.1 200 OK\r\n", 17) == 0) || !CHECK(head_end != NULL)) {
+        return;
+    }
+    const char* get_response = head_end + 4;
+    CHECK(strncmp(get_response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    long length = content_length(get_response);
+    CHECK(length > 0);
+    CHECK(content_length(head_response) == length);
+    const char* get_end = strstr(get_response, "\r\n\r\n");
+    if (CHECK(get_end != NULL)) {
+        CHECK((long) (view.data + view.size - (get_end + 4)) == length);
+    }
+}
+
+static void test_head_pipeline(RouterFixture* fixture) {
+    long style_size = docs_file_size("/style.css");
+    CHECK(style_size > 0);
+    // from memory and with sendfile
+    check_head_then_get(fixture, "/style.css", 16 * 1024);
+    check_head_then_get(fixture, "/style.css", 1);
+    // a route handler's response
+    check_head_then_get(fixture, "/", 16 * 1024);
+
+    static ClientView view;
+    CHECK(serve_pipeline(fixture, "HEAD /style.css HTTP/1.1\r\nHost: localhost\r\n\r\n", 16 * 1024, &view) == 1);
+    CHECK(content_length(view.data) == style_size);
+    CHECK(strstr(view.data, "\r\n\r\n") + 4 == view.data + view.size);
+}
+
+// one GET for a file with extra request headers
+static int get_with_headers(RouterFixture* fixture, const char* path, const char* headers, ClientView* view) {
+    char raw[1024];
+    snprintf(raw, sizeof(raw), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", path, headers);
+    return serve_pipeline(fixture, raw, 16 * 1024, view);
+}
+
+/*
+ * Function: check_multipart
+ *
+ * -------------------------
+ *
+ *  Walks a multipart/byteranges body and compares every part with the
+ *  expected file range.
+ *
+ *  view: the response.
+ *  file: contents of the file.
+ *  file_size: size of the file.
+ *  expected: start and last byte of each part.
+ *  part_count: number of parts expected.
+ */
+static void check_multipart(const ClientView* view, const char* file, long file_size, const long* expected,
+                            size_t part_count) {
+    char content_type[128];
+    if (!CHECK(header_value(view->data, "Content-Type: ", content_type, sizeof(content_type))) ||
+        !CHECK(strncmp(content_type, "multipart/byteranges; boundary=", 31) == 0)) {
+        return;
+    }
+    char delimiter[160];
+    snprintf(delimiter, sizeof(delimiter), "\r\n--%s", content_type + 31);
+
+    const char* body = response_body(view);
+    CHECK(content_length(view->data) == (long) (view->data + view->size - body));
+    const char* cursor = body;
+    for (size_t i = 0; i < part_count; i++) {
+        if (!CHECK(strncmp(cursor, delimiter, strlen(delimiter)) == 0)) {
+            return;
+        }
+        char content_range[64];
+        char expected_range[64];
+        snprintf(expected_range, sizeof(expected_range), "bytes %ld-%ld/%ld", expected[i * 2],
+                 expected[i * 2 + 1], file_size);
+        const char* part = cursor + strlen(delimiter) + 2;
+        CHECK(header_value(part, "Content-Range: ", content_range, sizeof(content_range)) &&
+              strcmp(content_range, expected_range) == 0);
+        const char* part_body = strstr(part, "\r\n\r\n");
+        if (!CHECK(part_body != NULL)) {
+            return;
+        }
+        part_body += 4;
+        long length = expected[i * 2 + 1] - expected[i * 2] + 1;
+        CHECK(memcmp(part_body, file + expected[i * 2], length) == 0);
+        cursor = part_body + length;
+    }
+    char closing[170];
+    snprintf(closing, sizeof(closing), "%s--\r\n", delimiter);
+    CHECK(strcmp(cursor, closing) == 0);
+}
+
+/*
+ * Function: test_ranges
+ *
+ * ---------------------
+ *
+ *  Requests parts of a static file: one range, a suffix, an unsatisfiable
+ *  one, several at once, and ranges behind an If-Range that does or does
+ *  not match the file's validators.
+ */
+static void test_ranges(RouterFixture* fixture) {
+    static ClientView view;
+    char file[4096];
+    long file_size = read_docs_file("/style.css", file, sizeof(file));
+    if (!CHECK(file_size > 20)) {
+        return;
+    }
+    char value[128];
+    char expected[128];
+
+    CHECK(get_with_headers(fixture, "/style.css", "Range: bytes=0-9\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 206 Partial Content\r\n", 30) == 0);
+    snprintf(expected, sizeof(expected), "bytes 0-9/%ld", file_size);
+    CHECK(header_value(view.data, "Content-Range: ", value, sizeof(value)) && strcmp(value, expected) == 0);
+    CHECK(content_length(view.data) == 10);
+    CHECK(view.data + view.size - response_body(&view) == 10 && memcmp(response_body(&view), file, 10) == 0);
+
+    CHECK(get_with_headers(fixture, "/style.css", "Range: bytes=-5\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 206 ", 13) == 0);
+    snprintf(expected, sizeof(expected), "bytes %ld-%ld/%ld", file_size - 5, file_size - 1, file_size);
+    CHECK(header_value(view.data, "Content-Range: ", value, sizeof(value)) && strcmp(value, expected) == 0);
+    CHECK(view.data + view.size - response_body(&view) == 5 &&
+          memcmp(response_body(&view), file + file_size - 5, 5) == 0);
+
+    CHECK(get_with_headers(fixture, "/style.css", "Range: bytes=100000-\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 416 Range Not Satisfiable\r\n", 36) == 0);
+    snprintf(expected, sizeof(expected), "bytes */%ld", file_size);
+    CHECK(header_value(view.data, "Content-Range: ", value, sizeof(value)) && strcmp(value, expected) == 0);
+    CHECK(content_length(view.data) == 0);
+
+    // a malformed range is ignored
+    CHECK(get_with_headers(fixture, "/style.css", "Range: bytes=9-1\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    CHECK(content_length(view.data) == file_size);
+
+    CHECK(get_with_headers(fixture, "/style.css", "Range: bytes=0-1, 5-9,-3\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 206 ", 13) == 0);
+    CHECK(!header_value(view.data, "Content-Range: ", value, sizeof(value)));
+    check_multipart(&view, file, file_size, (long[]) {0, 1, 5, 9, file_size - 3, file_size - 1}, 3);
+
+    // the validators of a plain response make If-Range hold
+    char etag[64];
+    char last_modified[64];
+    CHECK(get_with_headers(fixture, "/style.css", "", &view) == 1);
+    if (!CHECK(header_value(view.data, "ETag: ", etag, sizeof(etag))) ||
+        !CHECK(header_value(view.data, "Last-Modified: ", last_modified, sizeof(last_modified)))) {
+        return;
+    }
+    char headers[256];
+    snprintf(headers, sizeof(headers), "Range: bytes=0-9\r\nIf-Range: %s\r\n", etag);
+    CHECK(get_with_headers(fixture, "/style.css", headers, &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 206 ", 13) == 0);
+    snprintf(headers, sizeof(headers), "Range: bytes=0-9\r\nIf-Range: %s\r\n", last_modified);
+    CHECK(get_with_headers(fixture, "/style.css", headers, &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 206 ", 13) == 0);
+
+    // a changed file gets sent whole
+    CHECK(get_with_headers(fixture, "/style.css", "Range: bytes=0-9\r\nIf-Range: \"0-0\"\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    CHECK(content_length(view.data) == file_size);
+    CHECK(view.data + view.size - response_body(&view) == file_size);
+    CHECK(get_with_headers(fixture, "/style.css",
+                           "Range: bytes=0-9\r\nIf-Range: Thu, 01 Jan 1970 00:00:00 GMT\r\n", &view) == 1);
+    CHECK(strncmp(view.data, "HTTP/1.1 200 OK\r\n", 17) == 0);
+}
+
+void test_router(void) {
+    RouterFixture fixture;
+    memset(&fixture, 0, sizeof(fixture));
+    Route route_arr[] = {
+        {"/", "GET", home_route_handler, 0},
+        {"/posts", "GET", posts_route_handler, 0},
+    };
+    size_t route_count = sizeof(route_arr) / sizeof(route_arr[0]);
+    if (!CHECK(setup_routes(&fixture.routes, route_arr, route_count) == (int) route_count) ||
+        !CHECK(init_hash_table(&fixture.file_table, FILE_TABLE_SIZE) != -1) ||
+        !CHECK(load_files(DEFAULT_SERVER_PATH, &fixture.file_table) != -1)) {
+        return;
+    }
+
+    test_head_pipeline(&fixture);
+    test_ranges(&fixture);
+
+    free_file_table(&fixture.file_table);
+    free_list(&fixture.routes);
+}
@@ -0,0 +1,121 @@
+#include "test.h"
+#include "../include/scan.h"
+
+#include <string.h>
+
+#define SCAN_TEST_SIZE 96 // three avx2 blocks, the tail included
+
+typedef size_t (*Scanner)(const char* data, size_t size);
+
+static const Scanner scanners[] = {scan_token_end, scan_field_end, scan_name_end};
+static const char* const scanner_names[] = {"token", "field", "name"};
+#define SCANNER_COUNT (sizeof(scanners) / sizeof(scanners[0]))
+
+/*
+ * Function: scan_results
+ *
+ * ----------------------
+ *
+ *  Runs every scanner over every start offset and length of the buffer
+ *  with the current scan level.
+ *
+ *  data: bytes to scan, SCAN_TEST_SIZE of them.
+ *  results: receives what each scanner found, by start offset and length.
+ */
+static void scan_results(const char* data, size_t results[SCANNER_COUNT][8][SCAN_TEST_SIZE + 1]) {
+    for (size_t s = 0; s < SCANNER_COUNT; s++) {
+        // unaligned starts and every length, the delimiter may lie past the end
+        for (size_t start = 0; start < 8; start++) {
+            for (size_t size = 0; size + start <= SCAN_TEST_SIZE; size++) {
+                results[s][start][size] = scanners[s](data + start, size);
+            }
+        }
+    }
+}
+
+/*
+ * Function: check_levels_agree
+ *
+ * ----------------------------
+ *
+ *  Compares what the vector scanners find in a buffer with the scalar
+ *  scanner, for each level the CPU supports.
+ *
+ *  data: bytes to scan, SCAN_TEST_SIZE of them.
+ *
+ *  returns: they agree (1), otherwise (0).
+ */
+static int check_levels_agree(const char* data) {
+    static size_t expected[SCANNER_COUNT][8][SCAN_TEST_SIZE + 1];
+    static size_t actual[SCANNER_COUNT][8][SCAN_TEST_SIZE + 1];
+    set_scan_level(SCAN_SCALAR);
+    scan_results(data, expected);
+
+    for (int level = SCAN_SSE2; level <= SCAN_AVX2; level++) {
+        if (set_scan_level((ScanLevel) level) == -1) {
+            continue;
+        }
+        scan_results(data, actual);
+        for (size_t s = 0; s < SCANNER_COUNT; s++) {
+            for (size_t start = 0; start < 8; start++) {
+                for (size_t size = 0; size + start <= SCAN_TEST_SIZE; size++) {
+                    if (actual[s][start][size] != expected[s][start][size]) {
+                        printf("\t%s %s scanner at %zu+%zu: %zu, scalar %zu\n", scan_level_name((ScanLevel) level),
+                               scanner_names[s], start, size, actual[s][start][size], expected[s][start][size]);
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+// a plain token, nothing in it ends any scan
+static void fill_token(char* data) {
+    for (size_t i = 0; i < SCAN_TEST_SIZE; i++) {
+        data[i] = "abcXYZ019-_.~!"[i % 14];
+    }
+}
+
+void test_scan(void) {
+    ScanLevel initial_level = get_scan_level();
+    char data[SCAN_TEST_SIZE];
+
+    fill_token(data);
+    CHECK(check_levels_agree(data));
+
+    // every byte value at a few positions around the block edges, high bytes and DEL included
+    static const size_t positions[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 95};
+    int agree = 1;
+    for (int byte = 0; byte < 256 && agree; byte++) {
+        for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]) && agree; p++) {
+            fill_token(data);
+            data[positions[p]] = (char) byte;
+            agree = check_levels_agree(data);
+        }
+    }
+    CHECK(agree);
+
+    // a header line with its delimiters where they would be
+    const char line[] = "Content-Type:\ttext/html; charset=utf-8 \r\nX: y\r\n\r\nGET /index.html HTTP/1.1\r\n";
+    memset(data, 'a', sizeof(data));
+    memcpy(data, line, sizeof(line) - 1);
+    CHECK(check_levels_agree(data));
+
+    // mixed random bytes
+    unsigned long long state = 7;
+    agree = 1;
+    for (int round = 0; round < 64 && agree; round++) {
+        for (size_t i = 0; i < SCAN_TEST_SIZE; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            // mostly token bytes, so the delimiters land anywhere
+            int byte = (int) (state >> 56);
+            data[i] = byte < 16 ? (char) (byte * 16) : "abcXYZ019-_.~!"[byte % 14];
+        }
+        agree = check_levels_agree(data);
+    }
+    CHECK(agree);
+
+    set_scan_level(initial_level);
+}
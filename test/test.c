@@ -0,0 +1,42 @@
+#include "test.h"
+
+static size_t checks;
+static size_t failures;
+
+/*
+ * Function: test_check
+ *
+ * --------------------
+ *
+ *  Counts an expectation and reports it when it does not hold.
+ *
+ *  passed: result of the expectation.
+ *  expression: source text of the expectation.
+ *  file: source file.
+ *  line: source line.
+ *
+ *  returns: the expectation holds (1), otherwise (0).
+ */
+int test_check(int passed, const char* expression, const char* file, int line) {
+    checks++;
+    if (!passed) {
+        failures++;
+        printf("FAILED %s:%d: %s\n", file, line, expression);
+    }
+    return passed;
+}
+
+// Run from the repository root, the router tests serve files from http_docs.
+int main(void) {
+    test_router();
+    test_output_queue();
+    test_timer_wheel();
+    test_range();
+    test_request();
+    test_scan();
+    test_body();
+    test_chunked();
+
+    printf("%zu checks, %zu failed\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
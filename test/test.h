@@ -0,0 +1,33 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+// Records a failed expectation with its location, the suite keeps going.
+#define CHECK(condition) test_check((condition), #condition, __FILE__, __LINE__)
+
+/*
+ * Function: test_check
+ *
+ * --------------------
+ *
+ *  Counts an expectation and reports it when it does not hold.
+ *
+ *  passed: result of the expectation.
+ *  expression: source text of the expectation.
+ *  file: source file.
+ *  line: source line.
+ *
+ *  returns: the expectation holds (1), otherwise (0).
+ */
+int test_check(int passed, const char* expression, const char* file, int line);
+
+void test_router(void);
+void test_output_queue(void);
+void test_timer_wheel(void);
+void test_range(void);
+void test_request(void);
+void test_scan(void);
+void test_body(void);
+void test_chunked(void);
+#endif
@@ -0,0 +1,174 @@
+#include "test.h"
+#include "../include/timer_wheel.h"
+
+#include <string.h>
+
+#define TEST_TIMER_COUNT 512
+
+// a fixed sequence, so a failure repeats
+static unsigned long long next_random(unsigned long long* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 33;
+}
+
+/*
+ * Function: check_advance
+ *
+ * -----------------------
+ *
+ *  Advances the wheel and checks that every timer it hands back was due
+ *  by now but not yet by the previous advance, and is no longer active.
+ *
+ *  wheel: pointer to the timer wheel.
+ *  previous: time of the previous advance.
+ *  now: time to advance to.
+ *  fired: per timer, counts how often it expired.
+ *  timers: the timers, fired is indexed like them.
+ *
+ *  returns: number of expired timers.
+ */
+static size_t check_advance(TimerWheel* wheel, unsigned long long previous, unsigned long long now, int* fired,
+                            Timer* timers) {
+    Timer* expired = NULL;
+    size_t count = timer_wheel_advance(wheel, now, &expired);
+    size_t listed = 0;
+    for (Timer* timer = expired; timer != NULL; timer = timer->next) {
+        listed++;
+        CHECK(timer->expires <= now);
+        CHECK(timer->expires > previous);
+        CHECK(!timer->active);
+        fired[timer - timers]++;
+    }
+    CHECK(listed == count);
+    return count;
+}
+
+static void test_levels(void) {
+    TimerWheel wheel;
+    init_timer_wheel(&wheel, 1000);
+    CHECK(timer_wheel_timeout(&wheel, 1000) == -1);
+
+    // the edges of every level
+    static const unsigned long long delays[] = {0, 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 300000};
+    size_t timer_count = sizeof(delays) / sizeof(delays[0]);
+    Timer timers[sizeof(delays) / sizeof(delays[0])];
+    int fired[sizeof(delays) / sizeof(delays[0])];
+    memset(fired, 0, sizeof(fired));
+    for (size_t i = 0; i < timer_count; i++) {
+        init_timer(&timers[i], NULL);
+        timer_wheel_add(&wheel, &timers[i], 1000 + delays[i]);
+    }
+    CHECK(wheel.count == timer_count);
+
+    // a timer due now fires with the next advance
+    CHECK(timer_wheel_timeout(&wheel, 1000) == 0);
+
+    // sleeping as long as the wheel asks never skips a timer
+    unsigned long long now = 1000;
+    unsigned long long previous = 999;
+    size_t expired = 0;
+    size_t wakeups = 0;
+    while (wheel.count > 0 && wakeups < 10000) {
+        int timeout = timer_wheel_timeout(&wheel, now);
+        if (!CHECK(timeout >= 0)) break;
+        now += (unsigned long long) timeout;
+        expired += check_advance(&wheel, previous, now, fired, timers);
+        previous = now;
+        wakeups++;
+    }
+    CHECK(expired == timer_count);
+    for (size_t i = 0; i < timer_count; i++) {
+        CHECK(fired[i] == 1);
+    }
+    // cascading down a level is a wakeup, but not one per tick
+    CHECK(wakeups < 100);
+    CHECK(timer_wheel_timeout(&wheel, now) == -1);
+}
+
+static void test_remove_and_readd(void) {
+    TimerWheel wheel;
+    init_timer_wheel(&wheel, 0);
+    Timer timers[3];
+    int fired[3] = {0, 0, 0};
+    for (size_t i = 0; i < 3; i++) {
+        init_timer(&timers[i], NULL);
+    }
+
+    timer_wheel_add(&wheel, &timers[0], 100);
+    timer_wheel_add(&wheel, &timers[1], 5000);
+    timer_wheel_add(&wheel, &timers[2], 200);
+    timer_wheel_remove(&wheel, &timers[2]);
+    CHECK(!timers[2].active);
+    CHECK(wheel.count == 2);
+    // removing twice is harmless
+    timer_wheel_remove(&wheel, &timers[2]);
+    CHECK(wheel.count == 2);
+
+    // moved earlier from an upper level, and later from the first
+    timer_wheel_add(&wheel, &timers[1], 50);
+    timer_wheel_add(&wheel, &timers[0], 70000);
+    CHECK(wheel.count == 2);
+
+    CHECK(check_advance(&wheel, 0, 49, fired, timers) == 0);
+    CHECK(check_advance(&wheel, 49, 50, fired, timers) == 1);
+    CHECK(fired[1] == 1);
+    CHECK(check_advance(&wheel, 50, 69999, fired, timers) == 0);
+    CHECK(check_advance(&wheel, 69999, 70000, fired, timers) == 1);
+    CHECK(fired[0] == 1 && fired[2] == 0);
+    CHECK(wheel.count == 0);
+}
+
+/*
+ * Function: test_random_schedule
+ *
+ * ------------------------------
+ *
+ *  Adds, moves and removes timers at random while advancing in uneven
+ *  steps, and checks that each timer still scheduled fires exactly once,
+ *  at the first advance reaching its expiry.
+ */
+static void test_random_schedule(void) {
+    static TimerWheel wheel;
+    static Timer timers[TEST_TIMER_COUNT];
+    static int fired[TEST_TIMER_COUNT];
+    static int removed[TEST_TIMER_COUNT];
+    memset(fired, 0, sizeof(fired));
+    memset(removed, 0, sizeof(removed));
+    unsigned long long state = 42;
+    unsigned long long now = 123456;
+    init_timer_wheel(&wheel, now);
+
+    for (size_t i = 0; i < TEST_TIMER_COUNT; i++) {
+        init_timer(&timers[i], NULL);
+        timer_wheel_add(&wheel, &timers[i], now + 1 + next_random(&state) % (1 << 20));
+    }
+    for (size_t i = 0; i < TEST_TIMER_COUNT; i += 7) {
+        if (i % 2 == 0) {
+            timer_wheel_remove(&wheel, &timers[i]);
+            removed[i] = 1;
+        } else {
+            timer_wheel_add(&wheel, &timers[i], now + 1 + next_random(&state) % 5000);
+        }
+    }
+
+    unsigned long long previous = now;
+    while (wheel.count > 0) {
+        // mostly short steps, now and then a long stall of the loop
+        unsigned long long step = next_random(&state) % 8 == 0 ? next_random(&state) % 100000
+                                                                  : next_random(&state) % 300;
+        now += step;
+        check_advance(&wheel, previous, now, fired, timers);
+        previous = now;
+    }
+    int exact = 1;
+    for (size_t i = 0; i < TEST_TIMER_COUNT; i++) {
+        if (fired[i] != (removed[i] ? 0 : 1)) exact = 0;
+    }
+    CHECK(exact);
+}
+
+void test_timer_wheel(void) {
+    test_levels();
+    test_remove_and_readd();
+    test_random_schedule();
+}